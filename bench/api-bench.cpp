@@ -0,0 +1,176 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "reverse-make/analysis.h"
+
+using namespace std;
+
+/**
+ * Runs 'fn' 'reps' times and returns the fastest run, in seconds.
+ */
+template <typename Fn>
+double time_min(int reps, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best;
+}
+
+/**
+ * Sends stderr to /dev/null while it is in scope, so that the messages about
+ * skipped commands don't swamp the results.
+ */
+class QuietStderr {
+ public:
+  QuietStderr() : saved_(dup(STDERR_FILENO)) {
+    fflush(stderr);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+  }
+  ~QuietStderr() {
+    fflush(stderr);
+    dup2(saved_, STDERR_FILENO);
+    close(saved_);
+  }
+
+ private:
+  int saved_;
+};
+
+/**
+ * Returns the number of dependency groups in a report.
+ */
+size_t count_groups(const Report& report) {
+  size_t groups = 0;
+  for (auto* targets : {&report.ar_targets, &report.link_targets}) {
+    for (const TargetReport& target : *targets) {
+      groups += target.groups.size();
+    }
+  }
+  return groups;
+}
+
+/**
+ * Runs the reverse-make command 'cli' on 'filename' and counts the dependency
+ * groups in what it prints, as a program that doesn't link libreverse-make
+ * has to.
+ *
+ * @return The number of groups, or -1 if the command failed.
+ */
+long fork_and_parse(const string& cli, const string& filename) {
+  string command = fmt::format("'{}' '{}' 2>/dev/null", cli, filename);
+  FILE* pipe = popen(command.c_str(), "r");
+  if (pipe == nullptr) {
+    return -1;
+  }
+  string output;
+  char block[64 * 1024];
+  for (size_t n; (n = fread(block, 1, sizeof(block), pipe)) > 0;) {
+    output.append(block, n);
+  }
+  if (pclose(pipe) != 0) {
+    return -1;
+  }
+  long groups = 0;
+  string_view rest = output;
+  while (!rest.empty()) {
+    size_t end = rest.find('\n');
+    string_view line = rest.substr(0, end);
+    rest.remove_prefix(end == string_view::npos ? rest.size() : end + 1);
+    if (line.substr(0, 10) == "    Group ") {
+      groups++;
+    }
+  }
+  return groups;
+}
+
+int main(int argc, const char** argv) {
+  string cli;
+  int reps = 3;
+  vector<string> logs;
+  for (int arg = 1; arg < argc; arg++) {
+    string_view option = argv[arg];
+    if (option == "--cli" && arg + 1 < argc) {
+      cli = argv[++arg];
+    } else if (option == "--reps" && arg + 1 < argc) {
+      reps = max(1, atoi(argv[++arg]));
+    } else {
+      logs.push_back(argv[arg]);
+    }
+  }
+  if (cli.empty() || logs.empty()) {
+    fmt::print(stderr,
+               "usage: {} --cli <reverse-make> [--reps N] <build-log>...\n",
+               argv[0]);
+    return 1;
+  }
+
+  for (const string& filename : logs) {
+    // The log as another program might already hold it in memory.
+    string log;
+    {
+      auto source = LogSource::Open(filename);
+      if (!source) {
+        fmt::print(stderr, "Unable to open file: {}\n", filename);
+        return 1;
+      }
+      LogChunk chunk;
+      while (source->NextChunk(&chunk)) {
+        log.append(chunk.data);
+      }
+    }
+
+    // Both in-process runs find every path and flag already interned after
+    // the first, as a long-running program analyzing the same build would.
+    size_t targets = 0;
+    size_t groups = 0;
+    double file = time_min(reps, [&]() {
+      QuietStderr quiet;
+      auto analysis = BuildAnalysis::FromFile(filename);
+      targets = analysis->report().ar_targets.size() +
+                analysis->report().link_targets.size();
+      groups = count_groups(analysis->report());
+    });
+    double buffer = time_min(reps, [&]() {
+      QuietStderr quiet;
+      auto analysis = BuildAnalysis::FromBuffer(log);
+      groups = count_groups(analysis->report());
+    });
+
+    long cli_groups = 0;
+    double fork = time_min(reps, [&]() {
+      cli_groups = fork_and_parse(cli, filename);
+    });
+    if (cli_groups != long(groups)) {
+      fmt::print(stderr, "{}: {} printed {} groups, but the library found {}\n",
+                 filename, cli, cli_groups, groups);
+      return 1;
+    }
+
+    fmt::print(
+        "{{\"log\": \"{}\", \"bytes\": {}, \"targets\": {}, \"groups\": {}, "
+        "\"seconds\": {{\"file\": {:.6f}, \"buffer\": {:.6f}, "
+        "\"fork_and_parse\": {:.6f}}}, \"speedup\": {:.1f}}}\n",
+        filename, log.size(), targets, groups, file, buffer, fork,
+        fork / buffer);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+using namespace std;
+
+/**
+ * Writes a synthetic build log in the style of a make-driven autotools or
+ * plain Makefile build: modules of C and C++ sources compiled into objects,
+ * each module archived into a static library, and a few executables linked
+ * against the libraries.
+ *
+ * Everything is driven by a seeded PRNG, so the same options always produce
+ * the same log.
+ */
+class LogGenerator {
+ public:
+  struct Options {
+    uint64_t commands = 1000;
+    int flag_sets = 8;
+    int objects_per_archive = 50;
+    int executables = 10;
+    bool libtool = false;
+    double quoting = 0.1;
+    double continuations = 0.1;
+    double noise = 0.05;
+    uint64_t seed = 1;
+  };
+
+  LogGenerator(const Options& options, FILE* out)
+      : options_(options), out_(out), rng_(options.seed) {
+    for (int set = 0; set < options_.flag_sets; set++) {
+      flag_sets_.push_back(MakeFlagSet(set));
+    }
+  }
+
+  ~LogGenerator() { Flush(); }
+
+  void Generate() {
+    // The top-level make runs in /build and a recursive make in each module's
+    // directory, so the paths of a module's commands are relative to it.
+    // Unlike the rest of make's chatter, the directory lines are always
+    // written, so that they pair up as they do in a real log.
+    Line("make: Entering directory '/build'");
+    vector<string> archives;
+    uint64_t object = 0;
+    for (int module = 0; object < options_.commands; module++) {
+      Line(fmt::format("make[1]: Entering directory '/build/mod{}'", module));
+      Noise(fmt::format("mkdir -p ../build/mod{}", module));
+      bool cxx = module % 3 == 2;
+      vector<string> objects, pic_objects;
+      for (int i = 0;
+           i < options_.objects_per_archive && object < options_.commands;
+           i++, object++) {
+        string source = fmt::format("../src/mod{}/file{}.{}", module, object,
+                                    cxx ? "cc" : "c");
+        string flags = FlagsFor(module);
+        Noise(fmt::format("echo \"  CC      {}\"", source));
+        if (options_.libtool) {
+          string pic_object =
+              fmt::format("../build/mod{}/.libs/file{}.o", module, object);
+          Command(fmt::format("{} {} -c {} -fPIC -DPIC -o {}", Compiler(cxx),
+                              flags, source, pic_object));
+          pic_objects.push_back(pic_object);
+        }
+        string object_file =
+            fmt::format("../build/mod{}/file{}.o", module, object);
+        Command(fmt::format("{} {} -c {} -o {}", Compiler(cxx), flags, source,
+                            object_file));
+        objects.push_back(object_file);
+      }
+
+      string archive = fmt::format("build/libmod{}.a", module);
+      Noise(fmt::format("rm -f ../{}", archive));
+      Command(fmt::format("ar cr ../{} {}", archive, fmt::join(objects, " ")));
+      Noise(fmt::format("ranlib ../{}", archive));
+      if (options_.libtool) {
+        Command(fmt::format(
+            "{} -shared {} -L../build -lm -o ../build/libmod{}.so",
+            Compiler(cxx), fmt::join(pic_objects, " "), module));
+      }
+      archives.push_back(archive);
+      Line(fmt::format("make[1]: Leaving directory '/build/mod{}'", module));
+    }
+
+    for (int tool = 0; tool < options_.executables && !archives.empty();
+         tool++) {
+      string object = fmt::format("build/tools/tool{}.o", tool);
+      Command(fmt::format("gcc {} -c tools/tool{}.c -o {}", FlagsFor(tool),
+                          tool, object));
+      // Each tool links a handful of the libraries.
+      vector<string> libraries;
+      uniform_int_distribution<size_t> pick(0, archives.size() - 1);
+      for (int i = 0; i < 4; i++) {
+        libraries.push_back(archives[pick(rng_)]);
+      }
+      Command(fmt::format("gcc -o bin/tool{} {} {} -Lbuild -lm -pthread", tool,
+                          object, fmt::join(libraries, " ")));
+    }
+    Line("make: Leaving directory '/build'");
+  }
+
+ private:
+  // Returns the compile flags of one of the flag sets. Sets differ in their
+  // defines and include directories, and some in warnings and standard.
+  string MakeFlagSet(int set) {
+    static const char* kOptimizations[] = {"-O2", "-O0", "-Os", "-O3"};
+    static const char* kStandards[] = {"-std=gnu11", "-std=c99"};
+    static const char* kWarnings[] = {"-Wall", "-Wall -Wextra",
+                                      "-Wall -Wno-unused-parameter", "-w"};
+    string flags = fmt::format(
+        "-DHAVE_CONFIG_H -I. -Iinclude -Isrc/common -Isrc/set{} -DSET_{} {} {} "
+        "-g {}",
+        set, set, kOptimizations[set % 4], kStandards[set / 4 % 2],
+        kWarnings[set / 2 % 4]);
+    if (set % 5 == 4) {
+      flags += " -fvisibility=hidden -mtune=generic";
+    }
+    return flags;
+  }
+
+  // Most objects in a module share a flag set, but now and then one is built
+  // differently.
+  string FlagsFor(int module) {
+    int set = module % options_.flag_sets;
+    if (Chance(0.05)) {
+      set = uniform_int_distribution<int>(0, options_.flag_sets - 1)(rng_);
+    }
+    string flags = flag_sets_[set];
+    if (Chance(options_.quoting)) {
+      flags += fmt::format(
+          " -DPACKAGE_VERSION=\\\"1.{}\\\" \"-DBUILD_HOST=\\\"build "
+          "host\\\"\"",
+          set);
+    }
+    return flags;
+  }
+
+  static const char* Compiler(bool cxx) { return cxx ? "g++" : "gcc"; }
+
+  bool Chance(double p) {
+    return p > 0 && uniform_real_distribution<>()(rng_) < p;
+  }
+
+  // Writes a command, sometimes broken across lines the way long make recipes
+  // are. Make strips the recipe's leading tab, so the continuation lines are
+  // indented with spaces.
+  void Command(const string& command) {
+    if (!Chance(options_.continuations)) {
+      Line(command);
+      return;
+    }
+    string wrapped;
+    size_t column = 0;
+    for (size_t i = 0; i < command.size(); i++) {
+      if (command[i] == ' ' && column > 60 && Chance(0.5)) {
+        wrapped += " \\\n  ";
+        column = 0;
+        continue;
+      }
+      wrapped += command[i];
+      column++;
+    }
+    Line(wrapped);
+  }
+
+  // Writes a line of make chatter, sometimes.
+  void Noise(const string& line) {
+    if (Chance(options_.noise)) {
+      Line(line);
+    }
+  }
+
+  void Line(const string& line) {
+    buffer_ += line;
+    buffer_ += '\n';
+    if (buffer_.size() > (1 << 20)) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    fwrite(buffer_.data(), 1, buffer_.size(), out_);
+    buffer_.clear();
+  }
+
+  Options options_;
+  FILE* out_;
+  mt19937_64 rng_;
+  vector<string> flag_sets_;
+  string buffer_;
+};
+
+int main(int argc, const char** argv) {
+  LogGenerator::Options options;
+  string output = "-";
+
+  CLI::App app{"gen-build-log: write a synthetic build log for benchmarking."};
+  app.add_option("-n,--commands", options.commands,
+                 "The number of objects to compile.");
+  app.add_option("--flag-sets", options.flag_sets,
+                 "The number of distinct sets of compile flags.")
+      ->check(CLI::Range(1, 1 << 20));
+  app.add_option("--objects-per-archive", options.objects_per_archive,
+                 "The number of objects in each static library.")
+      ->check(CLI::Range(1, 1 << 30));
+  app.add_option("--executables", options.executables,
+                 "The number of executables to link.")
+      ->check(CLI::Range(0, 1 << 20));
+  app.add_flag("--libtool", options.libtool,
+               "Compile every object twice, PIC and non-PIC, as libtool "
+               "does, and link a shared library from the PIC objects.");
+  app.add_option("--quoting", options.quoting,
+                 "The fraction of compiles with quoted defines.")
+      ->check(CLI::Range(0.0, 1.0));
+  app.add_option("--continuations", options.continuations,
+                 "The fraction of commands split across lines.")
+      ->check(CLI::Range(0.0, 1.0));
+  app.add_option("--noise", options.noise,
+                 "How often to write lines that aren't compiler commands.")
+      ->check(CLI::Range(0.0, 1.0));
+  app.add_option("--seed", options.seed, "The random seed.");
+  app.add_option("-o,--output", output, "The file to write, or - for stdout.");
+  CLI11_PARSE(app, argc, argv);
+
+  FILE* out = output == "-" ? stdout : fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    fmt::print(stderr, "Unable to open file: {}\n", output);
+    return 1;
+  }
+  LogGenerator(options, out).Generate();
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef REVERSE_MAKE_BENCH_LEGACY_H__
+#define REVERSE_MAKE_BENCH_LEGACY_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * The byte-at-a-time line splitter that LogicalLineSplitter replaced, kept
+ * here as the baseline.
+ */
+inline vector<string> legacy_split_unescaped_newlines(const string& str) {
+  vector<string> result;
+  string temp;
+  bool is_escaped = false;
+
+  for (const char& c : str) {
+    if (c == '\n' && !is_escaped) {
+      result.push_back(temp);
+      temp.clear();
+    } else if (c == '\\') {
+      if (is_escaped) {  // means '\\' is found
+        temp += c;
+        is_escaped = false;
+      } else {
+        is_escaped = true;
+      }
+    } else {
+      if (is_escaped) {
+        temp += '\\';
+        is_escaped = false;
+      }
+      temp += c;
+    }
+  }
+  result.push_back(temp);  // push the last part of the string
+
+  return result;
+}
+
+/**
+ * The string-building tokenizer that CommandTokenizer replaced, kept here as
+ * the baseline.
+ */
+inline vector<string> legacy_split_string_into_parts(string_view str) {
+  vector<string> result;
+  string arg;
+  bool in_quote = false;
+  bool is_escaped = false;
+
+  for (const char& c : str) {
+    if (c == '"' && !is_escaped) {
+      in_quote = !in_quote;
+      if (!in_quote && !arg.empty()) {  // end of a quoted string
+        result.push_back(arg);
+        arg.clear();
+      }
+    } else if (c == '\\' && !is_escaped) {  // start of an escape sequence
+      is_escaped = true;
+    } else if (c == ' ' && !in_quote) {  // a space outside of a quoted string
+      if (!arg.empty()) {
+        result.push_back(arg);
+        arg.clear();
+      }
+      is_escaped = false;
+    } else {  // a regular character, or a space inside a quoted string
+      if (is_escaped &&
+          c != '"') {  // add the escape character if it's not for a quote
+        arg += '\\';
+      }
+      arg += c;
+      is_escaped = false;
+    }
+  }
+  // add the last argument if it's not empty
+  if (!arg.empty()) {
+    result.push_back(arg);
+  }
+
+  // Strip out the outer quotes
+  for (auto& argument : result) {
+    if (argument.front() == '"' && argument.back() == '"') {
+      argument.erase(0, 1);  // remove first character
+      argument.pop_back();   // remove last character
+    }
+  }
+
+  return result;
+}
+
+#endif  // REVERSE_MAKE_BENCH_LEGACY_H__
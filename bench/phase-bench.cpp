@@ -0,0 +1,150 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/parse.h"
+#include "reverse-make/report.h"
+
+using namespace std;
+
+/**
+ * Runs 'fn' 'reps' times and returns the fastest run, in seconds.
+ */
+template <typename Fn>
+double time_min(int reps, Fn fn) {
+  double best = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (rep == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best;
+}
+
+/**
+ * Sends stderr to /dev/null while it is in scope, so that the messages about
+ * skipped commands don't swamp the results.
+ */
+class QuietStderr {
+ public:
+  QuietStderr() : saved_(dup(STDERR_FILENO)) {
+    fflush(stderr);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+  }
+  ~QuietStderr() {
+    fflush(stderr);
+    dup2(saved_, STDERR_FILENO);
+    close(saved_);
+  }
+
+ private:
+  int saved_;
+};
+
+int main(int argc, const char** argv) {
+  string label = "unlabelled";
+  int reps = 3;
+  vector<string> logs;
+  for (int arg = 1; arg < argc; arg++) {
+    string_view option = argv[arg];
+    if (option == "--label" && arg + 1 < argc) {
+      label = argv[++arg];
+    } else if (option == "--reps" && arg + 1 < argc) {
+      reps = max(1, atoi(argv[++arg]));
+    } else {
+      logs.push_back(argv[arg]);
+    }
+  }
+  if (logs.empty()) {
+    fmt::print(stderr, "usage: {} [--label L] [--reps N] <build-log>...\n",
+               argv[0]);
+    return 1;
+  }
+
+  FILE* null = fopen("/dev/null", "w");
+  for (const string& filename : logs) {
+    if (!LogSource::Open(filename)) {
+      fmt::print(stderr, "Unable to open file: {}\n", filename);
+      return 1;
+    }
+
+    // Each phase runs on the output of the one before, and is timed on its
+    // own. Later reps of 'parse' find every path and flag already interned,
+    // which is also the case for most lines of a real log.
+    size_t bytes = 0;
+    volatile char touched = 0;
+    double read = time_min(reps, [&]() {
+      bytes = 0;
+      auto source = LogSource::Open(filename);
+      LogChunk chunk;
+      while (source->NextChunk(&chunk)) {
+        // Touch every page, so mapped files are actually read.
+        for (size_t i = 0; i < chunk.data.size(); i += 4096) {
+          touched = touched + chunk.data[i];
+        }
+        bytes += chunk.data.size();
+      }
+    });
+
+    size_t lines = 0;
+    double split = time_min(reps, [&]() {
+      lines = 0;
+      auto source = LogSource::Open(filename);
+      LogChunk chunk;
+      while (source->NextChunk(&chunk)) {
+        LogicalLineSplitter splitter(chunk.data);
+        for (string_view line; splitter.Next(&line);) {
+          lines++;
+        }
+      }
+    });
+
+    CommandTable commands;
+    double parse = time_min(reps, [&]() {
+      QuietStderr quiet;
+      auto source = LogSource::Open(filename);
+      vector<SkippedCommand> skipped_commands;
+      commands = CommandTable();
+      parse_log(source.get(), 1, &commands, &skipped_commands, nullptr);
+    });
+    size_t parsed_commands = commands.size();
+
+    // build_report() may add a target to the table, so each rep gets a copy.
+    Report report;
+    CommandTable reported;
+    double group = time_min(reps, [&]() {
+      reported = CommandTable();
+      reported.Append(commands);
+      report = build_report(&reported);
+    });
+
+    double print =
+        time_min(reps, [&]() { print_report(reported, report, null); });
+
+    fmt::print(
+        "{{\"label\": \"{}\", \"log\": \"{}\", \"bytes\": {}, \"lines\": {}, "
+        "\"commands\": {}, \"seconds\": {{\"read\": {:.6f}, \"split\": {:.6f}, "
+        "\"parse\": {:.6f}, \"group\": {:.6f}, \"print\": {:.6f}}}}}\n",
+        label, filename, bytes, lines, parsed_commands, read, split, parse,
+        group, print);
+    fflush(stdout);
+  }
+  fclose(null);
+  return 0;
+}
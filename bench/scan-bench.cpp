@@ -0,0 +1,111 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "bench/legacy.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/scan.h"
+#include "reverse-make/tokenizer.h"
+
+using namespace std;
+
+/**
+ * Runs 'fn' 'reps' times over 'bytes' bytes of input and prints the
+ * throughput. 'fn' returns a count that is printed too, both as a sanity
+ * check and so the work can't be optimized away.
+ */
+template <typename Fn>
+void run(const string& name, size_t bytes, int reps, Fn fn) {
+  size_t count = 0;
+  auto start = chrono::steady_clock::now();
+  for (int rep = 0; rep < reps; rep++) {
+    count += fn();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  fmt::print("  {:<28} {:>6.2f} GB/s  ({} per pass)\n", name,
+             double(bytes) * reps / elapsed.count() / 1e9, count / reps);
+}
+
+int main(int argc, const char** argv) {
+  if (argc < 2) {
+    fmt::print(stderr, "usage: {} <build-log>...\n", argv[0]);
+    return 1;
+  }
+
+  // Repeat the logs until there is enough input to time meaningfully.
+  string log;
+  for (int arg = 1; arg < argc; arg++) {
+    auto source = LogSource::Open(argv[arg]);
+    if (!source) {
+      fmt::print(stderr, "Unable to open file: {}\n", argv[arg]);
+      return 1;
+    }
+    LogChunk chunk;
+    while (source->NextChunk(&chunk)) {
+      log.append(chunk.data);
+    }
+  }
+  if (log.empty()) {
+    fmt::print(stderr, "The input is empty.\n");
+    return 1;
+  }
+  const size_t kTargetSize = 64 << 20;
+  string input;
+  input.reserve(kTargetSize + log.size());
+  while (input.size() < kTargetSize) {
+    input += log;
+  }
+  vector<string_view> lines;
+  LogicalLineSplitter splitter(input);
+  for (string_view line; splitter.Next(&line);) {
+    lines.push_back(line);
+  }
+  const int kReps = 3;
+  fmt::print("{} MiB of input, {} lines\n", input.size() >> 20, lines.size());
+
+  fmt::print("line splitting:\n");
+  run("legacy", input.size(), kReps,
+      [&]() { return legacy_split_unescaped_newlines(input).size(); });
+  for (ScanIsa isa : {ScanIsa::SCALAR, ScanIsa::SSE2, ScanIsa::AVX2}) {
+    if (!set_scan_isa(isa)) {
+      continue;
+    }
+    run(fmt::format("LogicalLineSplitter/{}", scan_isa_name(isa)),
+        input.size(), kReps, [&]() {
+          size_t count = 0;
+          LogicalLineSplitter splitter(input);
+          for (string_view line; splitter.Next(&line);) {
+            count++;
+          }
+          return count;
+        });
+  }
+
+  fmt::print("tokenizing:\n");
+  run("legacy", input.size(), kReps, [&]() {
+    size_t count = 0;
+    for (auto line : lines) {
+      count += legacy_split_string_into_parts(line).size();
+    }
+    return count;
+  });
+  for (ScanIsa isa : {ScanIsa::SCALAR, ScanIsa::SSE2, ScanIsa::AVX2}) {
+    if (!set_scan_isa(isa)) {
+      continue;
+    }
+    run(fmt::format("CommandTokenizer/{}", scan_isa_name(isa)), input.size(),
+        kReps, [&]() {
+          size_t count = 0;
+          CommandTokenizer tokenizer;
+          for (auto line : lines) {
+            count += tokenizer.Tokenize(line).size();
+          }
+          return count;
+        });
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "bench/legacy.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/tokenizer.h"
+
+using namespace std;
+
+/* Count heap allocations so we can report them per command line.
+ */
+static atomic<size_t> allocation_count{0};
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, memory_order_relaxed);
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/**
+ * Runs 'tokenize' over every line 'reps' times and prints the time and the
+ * number of heap allocations per line.
+ */
+template <typename Tokenize>
+void run(const char* name, const vector<string>& lines, int reps,
+         Tokenize tokenize) {
+  size_t tokens = 0;
+  size_t allocations_before = allocation_count.load();
+  auto start = chrono::steady_clock::now();
+  for (int rep = 0; rep < reps; rep++) {
+    for (const auto& line : lines) {
+      tokens += tokenize(line);
+    }
+  }
+  auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() -
+                                                start);
+  size_t allocations = allocation_count.load() - allocations_before;
+  double line_count = double(lines.size()) * reps;
+  fmt::print("  {:<10} {:>10.1f} ns/line {:>8.2f} allocs/line {:>8.1f} tokens/line\n",
+             name, elapsed.count() / line_count, allocations / line_count,
+             tokens / line_count);
+}
+
+int main(int argc, const char** argv) {
+  if (argc < 2) {
+    fmt::print(stderr, "usage: {} <build-log>...\n", argv[0]);
+    return 1;
+  }
+
+  for (int arg = 1; arg < argc; arg++) {
+    auto source = LogSource::Open(argv[arg]);
+    if (!source) {
+      fmt::print(stderr, "Unable to open file: {}\n", argv[arg]);
+      return 1;
+    }
+    vector<string> lines;
+    LogChunk chunk;
+    while (source->NextChunk(&chunk)) {
+      LogicalLineSplitter splitter(chunk.data);
+      string_view line;
+      while (splitter.Next(&line)) {
+        lines.emplace_back(line);
+      }
+    }
+
+    // Aim for roughly the same amount of work regardless of the log's size.
+    int reps = max<size_t>(1, 200000 / (lines.size() + 1));
+    fmt::print("{}: {} lines x {} reps\n", argv[arg], lines.size(), reps);
+    run("legacy", lines, reps, [](const string& line) {
+      return legacy_split_string_into_parts(line).size();
+    });
+    CommandTokenizer tokenizer;
+    run("tokenizer", lines, reps, [&](const string& line) {
+      return tokenizer.Tokenize(line).size();
+    });
+  }
+  return 0;
+}
@@ -33,7 +33,7 @@ CFLAGS := ${CFLAGS.${COMPILER}}
 
 LDFLAGS.debug := -ggdb3
 LDFLAGS.release :=
-LDFLAGS := -g ${LDFLAGS.${BUILD}}
+LDFLAGS := -g -pthread ${LDFLAGS.${BUILD}}
 LDLIBS :=
 
 CLI_LIB_HEADERS := ${CURDIR}/external/CLI-2.3.2
@@ -0,0 +1,102 @@
+#include "reverse-make/analysis.h"
+
+#include <algorithm>
+
+#include "reverse-make/paths.h"
+#include "reverse-make/pic_twins.h"
+
+unique_ptr<BuildAnalysis> BuildAnalysis::FromBuffer(
+    string_view log, const AnalysisOptions& options) {
+  auto source = LogSource::FromBuffer(log);
+  return FromSource(source.get(), options);
+}
+
+unique_ptr<BuildAnalysis> BuildAnalysis::FromFile(
+    const string& filename, const AnalysisOptions& options) {
+  auto source = LogSource::Open(filename);
+  if (!source) {
+    return nullptr;
+  }
+  return FromSource(source.get(), options);
+}
+
+unique_ptr<BuildAnalysis> BuildAnalysis::FromFd(
+    int fd, const AnalysisOptions& options) {
+  auto source = LogSource::FromFd(fd, false);
+  return FromSource(source.get(), options);
+}
+
+unique_ptr<BuildAnalysis> BuildAnalysis::FromSource(
+    LogSource* source, const AnalysisOptions& options) {
+  unique_ptr<BuildAnalysis> analysis(new BuildAnalysis());
+  analysis->Analyze(source, options);
+  return analysis;
+}
+
+void BuildAnalysis::Analyze(LogSource* source,
+                            const AnalysisOptions& options) {
+  jobs_ = options.jobs;
+  // Problems are always collected, so that a bad log can't abort the program
+  // that embeds this.
+  parse_log(source, jobs_, &commands_, &skipped_commands_, nullptr, nullptr,
+            &diagnostics_);
+
+  unique_ptr<PicTwins> twins;
+  if (!options.pic_flags.empty()) {
+    twins = make_unique<PicTwins>(commands_, options.pic_flags);
+  }
+  if (!commands_.Count(CommandKind::LINK) &&
+      !commands_.Count(CommandKind::AR)) {
+    // build_report() makes up a target, so the flag groups can only be
+    // worked out after it.
+    report_ = build_report(&commands_, &diagnostics_, twins.get());
+    flag_groups_.Update(commands_);
+  } else {
+    flag_groups_.Update(commands_);
+    report_ = build_report(commands_, flag_groups_, &diagnostics_, twins.get());
+  }
+}
+
+BuildAnalysis::RowId BuildAnalysis::FindTarget(string_view path) const {
+  string scratch;
+  uint32_t id = PathTable::Global().Find(normalize_path(path, &scratch));
+  if (id == StringInterner::kNotFound) {
+    return CommandTable::kNoRow;
+  }
+  RowId row = commands_.Find(CommandKind::LINK, id);
+  if (row == CommandTable::kNoRow) {
+    row = commands_.Find(CommandKind::AR, id);
+  }
+  return row;
+}
+
+BuildAnalysis::RowId BuildAnalysis::FindObject(string_view path) const {
+  string scratch;
+  uint32_t id = PathTable::Global().Find(normalize_path(path, &scratch));
+  if (id == StringInterner::kNotFound) {
+    return CommandTable::kNoRow;
+  }
+  return commands_.Find(CommandKind::COMPILE, id);
+}
+
+const TargetReport* BuildAnalysis::FindTargetReport(RowId row) const {
+  if (row >= commands_.size() || commands_.kind(row) == CommandKind::COMPILE) {
+    return nullptr;
+  }
+  const vector<TargetReport>& targets = commands_.kind(row) == CommandKind::AR
+                                            ? report_.ar_targets
+                                            : report_.link_targets;
+  // The targets are ordered by output path, as SortedRows() orders them.
+  PathTable& paths = PathTable::Global();
+  string_view output = paths.Lookup(commands_.output(row));
+  auto it = lower_bound(targets.begin(), targets.end(), output,
+                        [&](const TargetReport& target, string_view output) {
+                          return paths.Lookup(commands_.output(target.target)) <
+                                 output;
+                        });
+  return it != targets.end() && it->target == row ? &*it : nullptr;
+}
+
+bool BuildAnalysis::Write(ReportFormat format, FILE* out) const {
+  return write_report(commands_, report_, format, jobs_, out);
+}
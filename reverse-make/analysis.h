@@ -0,0 +1,162 @@
+#ifndef REVERSE_MAKE_ANALYSIS_H__
+#define REVERSE_MAKE_ANALYSIS_H__
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/diagnostics.h"
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/parse.h"
+#include "reverse-make/report.h"
+
+using namespace std;
+
+/**
+ * How BuildAnalysis analyzes a log.
+ */
+struct AnalysisOptions {
+  // The number of threads to parse and report with.
+  int jobs = 1;
+  // If not empty, PIC twins are folded, with these as the PIC flags; see
+  // PicTwins.
+  vector<string> pic_flags;
+};
+
+/**
+ * A build log parsed and grouped in process. This is the entry point of
+ * libreverse-make, for programs that embed it rather than run the
+ * reverse-make command and parse what it prints.
+ *
+ * The log is read where it lies: a buffer is parsed in place and a file is
+ * mapped, and only a pipe or socket is read into blocks. Paths and flags are
+ * interned in the program-wide PathTable and FlagInterner, so what an
+ * analysis hands out is IDs and views, which stay valid for the life of the
+ * program, and analyses of several logs share their strings.
+ *
+ * Those tables only ever grow: destroying an analysis frees its commands and
+ * report, but not the paths and flags it interned. A long-running program
+ * that analyzes many different logs keeps every distinct path and flag it
+ * has seen until it exits, much as reverse-make --serve does across reloads.
+ *
+ * Whatever is wrong with a log, analyzing it doesn't abort or print the
+ * problem: it is worked around as with --keep-going, and recorded in
+ * diagnostics(). Unrecognized commands are still reported on stderr as they
+ * are skipped, as well as returned by skipped_commands().
+ *
+ * Example:
+ *   auto analysis = BuildAnalysis::FromFile("build.log");
+ *   for (const TargetReport& target : analysis->report().link_targets) {
+ *     for (const DependencyGroup& group : target.groups) {
+ *       ... analysis->commands().flag_set(group.example_gcc_command,
+ *                                         FlagField::DEFINES) ...
+ *     }
+ *   }
+ */
+class BuildAnalysis {
+ public:
+  using RowId = CommandTable::RowId;
+
+  /**
+   * Analyzes a log that is already in memory, without copying it.
+   *
+   * @param log The log. It is only read during the call.
+   */
+  static unique_ptr<BuildAnalysis> FromBuffer(
+      string_view log, const AnalysisOptions& options = AnalysisOptions());
+
+  /**
+   * Analyzes a log file, or stdin for "-".
+   *
+   * @return The analysis, or nullptr if the file can't be opened.
+   */
+  static unique_ptr<BuildAnalysis> FromFile(
+      const string& filename,
+      const AnalysisOptions& options = AnalysisOptions());
+
+  /**
+   * Analyzes the log read from a file descriptor, such as a pipe, until it
+   * ends. The descriptor is left open.
+   */
+  static unique_ptr<BuildAnalysis> FromFd(
+      int fd, const AnalysisOptions& options = AnalysisOptions());
+
+  /**
+   * Analyzes the log a source hands out.
+   */
+  static unique_ptr<BuildAnalysis> FromSource(
+      LogSource* source, const AnalysisOptions& options = AnalysisOptions());
+
+  /**
+   * Returns every command of the log. If it had no ar or link commands, an ar
+   * target that depends on every object is added; see build_report().
+   */
+  const CommandTable& commands() const { return commands_; }
+
+  /**
+   * Returns the flag group of each compile command.
+   */
+  const FlagGroups& flag_groups() const { return flag_groups_; }
+
+  /**
+   * Returns the dependency groups of every ar and link target.
+   */
+  const Report& report() const { return report_; }
+
+  /**
+   * Returns the commands that weren't recognized, by line.
+   */
+  const vector<SkippedCommand>& skipped_commands() const {
+    return skipped_commands_;
+  }
+
+  /**
+   * Returns the problems found in the log, which were worked around. A caller
+   * that wants the log to be well formed checks that this is empty.
+   */
+  const Diagnostics& diagnostics() const { return diagnostics_; }
+
+  /**
+   * Returns the row of the ar or link target whose output is 'path', or
+   * CommandTable::kNoRow. The path is normalized first; see normalize_path().
+   */
+  RowId FindTarget(string_view path) const;
+
+  /**
+   * Returns the compile command whose output is 'path', or
+   * CommandTable::kNoRow.
+   */
+  RowId FindObject(string_view path) const;
+
+  /**
+   * Returns the dependency groups of the target 'row', or nullptr if it isn't
+   * an ar or link target.
+   */
+  const TargetReport* FindTargetReport(RowId row) const;
+
+  /**
+   * Writes the report, as the reverse-make command does.
+   *
+   * @return false if writing to 'out' failed.
+   */
+  bool Write(ReportFormat format, FILE* out = stdout) const;
+
+ private:
+  BuildAnalysis() {}
+
+  // Parses the log, then groups and reports on its commands.
+  void Analyze(LogSource* source, const AnalysisOptions& options);
+
+  int jobs_ = 1;
+  CommandTable commands_;
+  vector<SkippedCommand> skipped_commands_;
+  Diagnostics diagnostics_;
+  FlagGroups flag_groups_;
+  Report report_;
+};
+
+#endif  // REVERSE_MAKE_ANALYSIS_H__
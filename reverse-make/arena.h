@@ -0,0 +1,165 @@
+#ifndef REVERSE_MAKE_ARENA_H__
+#define REVERSE_MAKE_ARENA_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+/**
+ * A bump allocator. Allocations are carved out of large blocks and are never
+ * freed individually; everything goes away at once when the arena is
+ * destroyed.
+ *
+ * Only trivially destructible objects belong in an arena, since no destructors
+ * are run.
+ */
+class Arena {
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() {
+    while (head_ != nullptr) {
+      Block* next = head_->next;
+      free(head_);
+      head_ = next;
+    }
+  }
+
+  /**
+   * Returns 'size' bytes aligned to 'align', which must be a power of two.
+   */
+  void* Allocate(size_t size, size_t align) {
+    uintptr_t p = AlignUp(pos_, align);
+    if (pos_ == nullptr || p + size > reinterpret_cast<uintptr_t>(end_)) {
+      NewBlock(size + align);
+      p = AlignUp(pos_, align);
+    }
+    pos_ = reinterpret_cast<char*>(p + size);
+    return reinterpret_cast<void*>(p);
+  }
+
+  /**
+   * Returns uninitialized storage for 'n' objects of type T.
+   */
+  template <typename T>
+  T* AllocateArray(size_t n) {
+    static_assert(is_trivially_destructible_v<T>);
+    return static_cast<T*>(Allocate(n * sizeof(T), alignof(T)));
+  }
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  // Blocks start small so that short-lived arenas stay cheap, and double up to
+  // kMaxBlockSize so that big ones don't make too many trips to malloc.
+  static constexpr size_t kMinBlockSize = 16 << 10;
+  static constexpr size_t kMaxBlockSize = 4 << 20;
+
+  static uintptr_t AlignUp(const char* p, size_t align) {
+    return (reinterpret_cast<uintptr_t>(p) + align - 1) & ~(align - 1);
+  }
+
+  void NewBlock(size_t min_size) {
+    size_t size = head_ == nullptr ? kMinBlockSize
+                                   : min(head_->size * 2, kMaxBlockSize);
+    size = max(size, min_size + sizeof(Block));
+    Block* block = static_cast<Block*>(malloc(size));
+    if (block == nullptr) {
+      abort();
+    }
+    block->next = head_;
+    block->size = size;
+    head_ = block;
+    pos_ = reinterpret_cast<char*>(block + 1);
+    end_ = reinterpret_cast<char*>(block) + size;
+  }
+
+  Block* head_ = nullptr;
+  char* pos_ = nullptr;
+  char* end_ = nullptr;
+};
+
+/**
+ * A growable array of trivially copyable objects whose storage lives in an
+ * Arena. Growing it leaves the old storage behind in the arena, so it suits
+ * arrays that are built once and then read.
+ */
+template <typename T>
+class ArenaVector {
+  static_assert(is_trivially_copyable_v<T>);
+
+ public:
+  ArenaVector() = default;
+  explicit ArenaVector(Arena* arena) : arena_(arena) {}
+
+  void push_back(const T& value) {
+    if (size_ == capacity_) {
+      reserve(capacity_ == 0 ? 16 : capacity_ * 2);
+    }
+    data_[size_++] = value;
+  }
+
+  /**
+   * Appends 'n' objects starting at 'values'.
+   */
+  void append(const T* values, size_t n) {
+    if (size_ + n > capacity_) {
+      reserve(max(size_ + n, capacity_ * 2));
+    }
+    if (n > 0) {
+      memcpy(data_ + size_, values, n * sizeof(T));
+    }
+    size_ += n;
+  }
+
+  /**
+   * Sets the size to 'n', filling any new elements with 'value'.
+   */
+  void assign(size_t n, const T& value) {
+    size_ = 0;
+    reserve(n);
+    for (; size_ < n; size_++) {
+      data_[size_] = value;
+    }
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    T* data = arena_->AllocateArray<T>(capacity);
+    if (size_ > 0) {
+      memcpy(data, data_, size_ * sizeof(T));
+    }
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  T& operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  Arena* arena_ = nullptr;
+  T* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+#endif  // REVERSE_MAKE_ARENA_H__
@@ -1,6 +1,8 @@
 #include "reverse-make/args.h"
 
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
 
 #include <CLI/App.hpp>
 #include <CLI/Config.hpp>
@@ -12,7 +14,222 @@ std::variant<Args, int> Args::ParseArgs(int argc, const char* argv[]) {
   CLI::App app{
       "reverse-make: partially generate makefiles from build logs."};
   args.filename_ = "input.td";
-  app.add_option("1, -f,--file", args.filename_, "The input file.");
+  app.add_option("1, -f,--file", args.filename_,
+                 "The input file, or - to read from stdin.");
+  args.jobs_ = 1;
+  app.add_option("-j,--jobs", args.jobs_,
+                 "The number of threads to parse the input with.")
+      ->check(CLI::Range(1, 1024));
+  auto index = app.add_option(
+      "--index", args.index_filename_,
+      "Write the parsed log to this index file, for --from-index to load.");
+  args.from_index_ = false;
+  auto from_index = app.add_flag("--from-index", args.from_index_,
+               "Load the parsed log from the --index file instead of parsing "
+               "it, unless the log has changed since the index was written.")
+      ->needs(index);
+  args.stats_ = false;
+  auto stats = app.add_flag(
+      "--stats", args.stats_,
+      "Print the time and memory each phase took, and what was seen in the "
+      "log, to stderr.");
+  args.stats_format_ = "text";
+  app.add_option("--stats-format", args.stats_format_,
+                 "The format of --stats: text or json.")
+      ->check(CLI::IsMember({"text", "json"}))
+      ->needs(stats);
+  args.follow_ = false;
+  auto follow = app.add_flag(
+      "--follow", args.follow_,
+      "Keep reading the log as it grows, and print the summary on SIGUSR1, "
+      "every --follow-interval seconds, and when the log ends or on SIGINT.");
+  follow->excludes(index)->excludes(from_index)->excludes(stats);
+  args.follow_interval_ = 30;
+  app.add_option("--follow-interval", args.follow_interval_,
+                 "How often --follow prints the summary when there is "
+                 "something new, in seconds; 0 for only on SIGUSR1.")
+      ->check(CLI::Range(0, 86400))
+      ->needs(follow);
+  args.depfiles_ = false;
+  auto depfiles = app.add_flag(
+      "--depfiles", args.depfiles_,
+      "Read the dependency files named with -MF, and report the headers of "
+      "each group and the most included headers.");
+  args.depfile_root_ = ".";
+  app.add_option("--depfile-root", args.depfile_root_,
+                 "The directory the build ran in, which relative dependency "
+                 "file paths are resolved against.")
+      ->needs(depfiles);
+  args.top_headers_ = 20;
+  app.add_option("--top-headers", args.top_headers_,
+                 "How many of the most included headers to list.")
+      ->check(CLI::Range(0, 1 << 30))
+      ->needs(depfiles);
+  args.transitive_ = false;
+  auto transitive = app.add_flag(
+      "--transitive", args.transitive_,
+      "After the report, list every final artifact with all the sources and "
+      "flag groups it is built from, through the libraries it uses.");
+  transitive->excludes(follow);
+  args.from_compdb_ = false;
+  auto from_compdb =
+      app.add_flag("--from-compdb", args.from_compdb_,
+                   "The input is a JSON compilation database "
+                   "(compile_commands.json) rather than a build log.");
+  from_compdb->excludes(index)
+      ->excludes(from_index)
+      ->excludes(follow);
+  auto write_compdb = app.add_option(
+      "--write-compdb", args.write_compdb_filename_,
+      "Write the compile commands as a JSON compilation database to this "
+      "file.");
+  app.add_option("--compdb-directory", args.compdb_directory_,
+                 "The directory to record in --write-compdb entries; the "
+                 "current directory by default.")
+      ->needs(write_compdb);
+  app.add_option("--compdb-flag-files", args.compdb_flag_files_dir_,
+                 "Write each distinct set of flags once, to a response file "
+                 "in this directory, and refer to it from --write-compdb "
+                 "entries.")
+      ->needs(write_compdb);
+  write_compdb->excludes(follow);
+  args.suggest_unity_ = false;
+  auto suggest_unity = app.add_flag(
+      "--suggest-unity", args.suggest_unity_,
+      "Instead of the report, suggest unity files that merge sources compiled "
+      "with the same flags, write them to --unity-dir, and predict the "
+      "speedup.");
+  suggest_unity->excludes(follow);
+  args.unity_max_sources_ = 8;
+  app.add_option("--unity-max-sources", args.unity_max_sources_,
+                 "The most sources one unity file may include.")
+      ->check(CLI::Range(2, 1 << 20))
+      ->needs(suggest_unity);
+  args.unity_dir_ = "unity";
+  app.add_option("--unity-dir", args.unity_dir_,
+                 "Where to write the unity files, relative to --unity-root.")
+      ->needs(suggest_unity);
+  args.unity_root_ = ".";
+  app.add_option("--unity-root", args.unity_root_,
+                 "The directory the build ran in, which --unity-dir and the "
+                 "sources the unity files include are relative to.")
+      ->needs(suggest_unity);
+  args.unity_overhead_ = 0.5;
+  app.add_option("--unity-overhead", args.unity_overhead_,
+                 "The fraction of the cheapest compile of a unity file that "
+                 "merging saves for every other compile in it.")
+      ->check(CLI::Range(0.0, 1.0))
+      ->needs(suggest_unity);
+  auto timings = app.add_option(
+      "--timings", args.timings_filename_,
+      "A .ninja_log with how long each command took, for --timing-report and "
+      "for --suggest-unity to balance unity files by.");
+  timings->excludes(follow);
+  args.timestamps_ = false;
+  auto timestamps = app.add_flag(
+      "--timestamps", args.timestamps_,
+      "The log's lines start with timestamps, as added by ts; time each "
+      "command until the next line starts. Only exact for serial builds.");
+  timestamps->excludes(from_index)->excludes(from_compdb)->excludes(follow);
+  args.timing_report_ = false;
+  auto timing_report = app.add_flag(
+      "--timing-report", args.timing_report_,
+      "After the report, print the build's critical path, its CPU time by "
+      "flag group, the speedup possible on --build-jobs jobs, and the slowest "
+      "commands, from --timings or --timestamps.");
+  timing_report->excludes(follow);
+  args.top_commands_ = 10;
+  app.add_option("--top-commands", args.top_commands_,
+                 "How many of the slowest compiles, latest targets and most "
+                 "expensive flag groups --timing-report lists.")
+      ->check(CLI::Range(0, 1 << 30))
+      ->needs(timing_report);
+  args.build_jobs_ = std::max(1u, std::thread::hardware_concurrency());
+  app.add_option("--build-jobs", args.build_jobs_,
+                 "The number of commands the build runs at once, for "
+                 "predicting its wall time with --timing-report and "
+                 "--suggest-unity.")
+      ->check(CLI::Range(1, 1 << 16));
+
+  auto batch = app.add_option(
+      "--batch", args.batch_inputs_,
+      "Report on many logs at once, instead of --file: each is a log, or a "
+      "directory to search for files ending in --batch-suffix. The reports "
+      "are followed by the sets of flags the logs share.");
+  batch->excludes(index)
+      ->excludes(from_index)
+      ->excludes(follow)
+      ->excludes(from_compdb)
+      ->excludes(write_compdb)
+      ->excludes(suggest_unity)
+      ->excludes(timestamps)
+      ->excludes(timing_report)
+      ->excludes(stats)
+      ->excludes(depfiles)
+      ->excludes(transitive);
+  args.batch_suffix_ = ".log";
+  app.add_option("--batch-suffix", args.batch_suffix_,
+                 "The ending of the names of the logs --batch finds in "
+                 "directories; empty for every file.")
+      ->needs(batch);
+  app.add_option("--batch-output", args.batch_output_dir_,
+                 "Write the report on each --batch log to <dir>/<log>.txt "
+                 "instead of printing it.")
+      ->needs(batch);
+  args.batch_top_groups_ = 20;
+  app.add_option("--batch-top-groups", args.batch_top_groups_,
+                 "How many of the sets of flags shared by most --batch logs "
+                 "to list.")
+      ->check(CLI::Range(0, 1 << 30))
+      ->needs(batch);
+  args.keep_going_ = false;
+  app.add_flag("--keep-going", args.keep_going_,
+               "Don't stop at the first unhandled option or command the log "
+               "has: skip or approximate it, finish the log, and print a "
+               "summary of every problem to stderr at the end.")
+      ->excludes(index)
+      ->excludes(from_index)
+      ->excludes(follow);
+  args.fold_pic_ = false;
+  auto fold_pic = app.add_flag(
+      "--fold-pic", args.fold_pic_,
+      "Fold the PIC twin of each compile, as libtool makes for shared "
+      "libraries, into it: report each group of twins as a reference to the "
+      "group of the compiles they are twins of, plus the PIC flags.");
+  fold_pic->excludes(follow);
+  args.format_ = "text";
+  app.add_option("--format", args.format_,
+                 "The format of the report: text, json, or binary, a compact "
+                 "encoding described in report.h.")
+      ->check(CLI::IsMember({"text", "json", "binary"}))
+      ->excludes(follow)
+      ->excludes(batch)
+      ->excludes(suggest_unity)
+      ->excludes(transitive)
+      ->excludes(timing_report);
+  args.pic_flags_ = {"-fPIC", "-fpic", "-DPIC"};
+  app.add_option("--pic-flags", args.pic_flags_,
+                 "The flags, separated by commas, that a PIC twin may have "
+                 "on top of its compile's.")
+      ->delimiter(',')
+      ->needs(fold_pic);
+
+  auto serve = app.add_option(
+      "--serve", args.serve_socket_,
+      "Parse the log once and answer JSON queries about it, one per line, "
+      "on a Unix domain socket at this path until SIGINT or SIGTERM, parsing "
+      "it again whenever it changes. See serve.h for the queries.");
+  serve->excludes(index)
+      ->excludes(from_index)
+      ->excludes(follow)
+      ->excludes(batch)
+      ->excludes(from_compdb);
+  args.serve_interval_ = 1;
+  app.add_option("--serve-interval", args.serve_interval_,
+                 "How often --serve checks whether the log changed, in "
+                 "seconds.")
+      ->check(CLI::Range(0.001, 86400.0))
+      ->needs(serve);
 
   try {
     app.parse(argc, argv);
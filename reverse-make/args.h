@@ -3,6 +3,7 @@
 
 #include <string>
 #include <variant>
+#include <vector>
 
 class Args {
  public:
@@ -10,10 +11,86 @@ class Args {
   static std::variant<Args, int> ParseArgs(int argc, const char* argv[]);
 
   const std::string& getInpuFilename() const { return filename_; }
+  int getJobs() const { return jobs_; }
+  const std::string& getIndexFilename() const { return index_filename_; }
+  bool getFromIndex() const { return from_index_; }
+  bool getStats() const { return stats_; }
+  const std::string& getStatsFormat() const { return stats_format_; }
+  bool getFollow() const { return follow_; }
+  int getFollowInterval() const { return follow_interval_; }
+  bool getDepfiles() const { return depfiles_; }
+  const std::string& getDepfileRoot() const { return depfile_root_; }
+  int getTopHeaders() const { return top_headers_; }
+  bool getTransitive() const { return transitive_; }
+  bool getFromCompdb() const { return from_compdb_; }
+  const std::string& getWriteCompdbFilename() const {
+    return write_compdb_filename_;
+  }
+  const std::string& getCompdbDirectory() const { return compdb_directory_; }
+  const std::string& getCompdbFlagFilesDir() const {
+    return compdb_flag_files_dir_;
+  }
+  bool getSuggestUnity() const { return suggest_unity_; }
+  int getUnityMaxSources() const { return unity_max_sources_; }
+  const std::string& getUnityDir() const { return unity_dir_; }
+  const std::string& getUnityRoot() const { return unity_root_; }
+  double getUnityOverhead() const { return unity_overhead_; }
+  const std::string& getTimingsFilename() const { return timings_filename_; }
+  bool getTimestamps() const { return timestamps_; }
+  bool getTimingReport() const { return timing_report_; }
+  int getTopCommands() const { return top_commands_; }
+  int getBuildJobs() const { return build_jobs_; }
+  const std::vector<std::string>& getBatchInputs() const {
+    return batch_inputs_;
+  }
+  const std::string& getBatchSuffix() const { return batch_suffix_; }
+  const std::string& getBatchOutputDir() const { return batch_output_dir_; }
+  int getBatchTopGroups() const { return batch_top_groups_; }
+  bool getKeepGoing() const { return keep_going_; }
+  bool getFoldPic() const { return fold_pic_; }
+  const std::vector<std::string>& getPicFlags() const { return pic_flags_; }
+  const std::string& getFormat() const { return format_; }
+  const std::string& getServeSocket() const { return serve_socket_; }
+  double getServeInterval() const { return serve_interval_; }
 
  private:
   Args() {}
   std::string filename_;
+  int jobs_;
+  std::string index_filename_;
+  bool from_index_;
+  bool stats_;
+  std::string stats_format_;
+  bool follow_;
+  int follow_interval_;
+  bool depfiles_;
+  std::string depfile_root_;
+  int top_headers_;
+  bool transitive_;
+  bool from_compdb_;
+  std::string write_compdb_filename_;
+  std::string compdb_directory_;
+  std::string compdb_flag_files_dir_;
+  bool suggest_unity_;
+  int unity_max_sources_;
+  std::string unity_dir_;
+  std::string unity_root_;
+  double unity_overhead_;
+  std::string timings_filename_;
+  bool timestamps_;
+  bool timing_report_;
+  int top_commands_;
+  int build_jobs_;
+  std::vector<std::string> batch_inputs_;
+  std::string batch_suffix_;
+  std::string batch_output_dir_;
+  int batch_top_groups_;
+  bool keep_going_;
+  bool fold_pic_;
+  std::vector<std::string> pic_flags_;
+  std::string format_;
+  std::string serve_socket_;
+  double serve_interval_;
 };
 
 #endif  // REVERSE_MAKE_ARGS_H__
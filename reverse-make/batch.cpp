@@ -0,0 +1,339 @@
+#include "reverse-make/batch.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/files.h"
+#include "reverse-make/hash.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/parallel.h"
+#include "reverse-make/parse.h"
+#include "reverse-make/pic_twins.h"
+#include "reverse-make/report.h"
+
+namespace {
+
+// The flag categories of a compile command.
+constexpr FlagField kCompileFields[] = {
+    FlagField::DEFINES,     FlagField::INCLUDES,      FlagField::CFLAGS,
+    FlagField::WARNS,       FlagField::TARGET_OPTS,   FlagField::OPTIMIZATIONS,
+    FlagField::DEBUG_INFO,
+};
+constexpr size_t kNumCompileFields = size(kCompileFields);
+
+// How many of the logs sharing a flag group to name.
+constexpr size_t kMaxLogNames = 10;
+
+/**
+ * Everything a compile is compiled with. Flag sets are interned in the global
+ * FlagSetTable, so the same flags have the same key in every log.
+ */
+struct FlagKey {
+  GccCommand::Compiler compiler;
+  array<FlagSetId, kNumCompileFields> flags;
+
+  bool operator==(const FlagKey& other) const {
+    return compiler == other.compiler && flags == other.flags;
+  }
+};
+
+struct FlagKeyHash {
+  size_t operator()(const FlagKey& key) const {
+    WordHash hash;
+    hash.Mix(key.compiler);
+    for (FlagSetId id : key.flags) {
+      hash.Mix(id);
+    }
+    return hash.hash();
+  }
+};
+
+/**
+ * What reporting on one log came to.
+ */
+struct LogResult {
+  bool ok = false;
+  int lines = 0;
+  // The report, when it is printed rather than written to a file.
+  string report;
+  // The number of compiles with each distinct set of flags.
+  vector<pair<FlagKey, size_t>> groups;
+};
+
+/**
+ * Returns the flags of 'key' as a command line.
+ */
+string flags_string(const FlagKey& key) {
+  string flags = GccCommand::CompilerAsString(key.compiler);
+  for (FlagSetId id : key.flags) {
+    // In order of the flags, not of their IDs, which depend on which thread
+    // interned them first.
+    vector<string_view> strings;
+    for (uint32_t flag : FlagSetTable::Global().Lookup(id).ids()) {
+      strings.push_back(FlagInterner::Global().Lookup(flag));
+    }
+    sort(strings.begin(), strings.end());
+    for (string_view flag : strings) {
+      flags += ' ';
+      flags += flag;
+    }
+  }
+  return flags;
+}
+
+/**
+ * Returns the path to write the report on 'log' to, under 'dir'.
+ */
+string report_filename(const BatchLog& log, const string& dir) {
+  // Keep the report under 'dir', whatever the log's name.
+  string_view name = log.name;
+  while (!name.empty() && (name[0] == '/' || name.substr(0, 3) == "../" ||
+                           name.substr(0, 2) == "./")) {
+    name.remove_prefix(name[0] == '/' ? 1 : name.find('/') + 1);
+  }
+  return fmt::format("{}/{}.txt", dir, name);
+}
+
+/**
+ * Returns the error for the first problem in 'diagnostics', on 'line' of 'log'
+ * or on none if it is 0.
+ */
+string problem_error(const BatchLog& log, const Diagnostics& diagnostics,
+                     int line) {
+  const auto* problem = diagnostics.first();
+  string where = line > 0 ? fmt::format("{}, line {}", log.name, line)
+                          : log.name;
+  return fmt::format("{}: {} (see --keep-going)", where,
+                     Diagnostics::Describe(problem->first, problem->second));
+}
+
+/**
+ * Parses one log, and prints its report or writes it to its file.
+ *
+ * Problems never abort, since this runs on one of run_batch()'s threads: with
+ * 'options.keep_going' they are worked around and summarized in the report,
+ * and otherwise the log fails, with the first as its error.
+ */
+bool report_log(const BatchLog& log, const BatchOptions& options,
+                LogResult* result, string* error) {
+  auto source = LogSource::Open(log.path);
+  if (!source) {
+    *error = fmt::format("Unable to open file: {}", log.path);
+    return false;
+  }
+
+  // Each log gets one thread, so the chunks are parsed one after another.
+  CommandTable commands;
+  vector<SkippedCommand> skipped_commands;
+  Diagnostics diagnostics;
+  ParseOptions parse_options;
+  parse_options.keep_going = options.keep_going;
+  DirectoryStack directories;
+  result->lines = 1;
+  LogChunk chunk;
+  while (source->NextChunk(&chunk)) {
+    ParsedChunk parsed = parse_chunk(chunk.data, parse_options, directories);
+    if (parsed.stopped) {
+      *error = problem_error(log, parsed.diagnostics,
+                             result->lines + parsed.lines);
+      return false;
+    }
+    directories = move(parsed.directories);
+    commands.Append(parsed.commands);
+    diagnostics.Merge(parsed.diagnostics, result->lines - 1);
+    for (auto& [chunk_line, command] : parsed.skipped_commands) {
+      skipped_commands.emplace_back(result->lines + chunk_line, command);
+    }
+    result->lines += parsed.lines;
+    source->DoneWith(chunk);
+  }
+  result->lines--;
+
+  unordered_map<FlagKey, size_t, FlagKeyHash> counts;
+  for (CommandTable::RowId row = 0; row < commands.size(); row++) {
+    if (commands.kind(row) != CommandKind::COMPILE) {
+      continue;
+    }
+    FlagKey key{commands.compiler(row), {}};
+    for (size_t i = 0; i < kNumCompileFields; i++) {
+      key.flags[i] = commands.flags(row, kCompileFields[i]);
+    }
+    counts[key]++;
+  }
+  result->groups.assign(counts.begin(), counts.end());
+
+  unique_ptr<PicTwins> twins;
+  if (!options.pic_flags.empty()) {
+    twins = make_unique<PicTwins>(commands, options.pic_flags);
+  }
+  Report report = build_report(&commands, &diagnostics, twins.get());
+  if (!options.keep_going && !diagnostics.empty()) {
+    *error = problem_error(log, diagnostics, 0);
+    return false;
+  }
+  char* buffer = nullptr;
+  size_t size = 0;
+  FILE* file;
+  string filename;
+  if (options.output_dir.empty()) {
+    file = open_memstream(&buffer, &size);
+  } else {
+    filename = report_filename(log, options.output_dir);
+    size_t slash = filename.rfind('/');
+    if (!make_directories(filename.substr(0, slash))) {
+      *error = fmt::format("Unable to create the directory of {}", filename);
+      return false;
+    }
+    file = fopen(filename.c_str(), "w");
+  }
+  if (file == nullptr) {
+    *error = fmt::format("Unable to write report: {}", filename);
+    return false;
+  }
+  for (const SkippedCommand& skipped : skipped_commands) {
+    fmt::print(file, "Skipping unrecognized command \"{}\" on line {}.\n",
+               skipped.second, skipped.first);
+  }
+  print_report(commands, report, file);
+  if (!diagnostics.empty()) {
+    diagnostics.Print(file);
+  }
+  bool ok = !ferror(file);
+  ok = fclose(file) == 0 && ok;
+  if (buffer != nullptr) {
+    result->report.assign(buffer, size);
+    free(buffer);
+  }
+  if (!ok) {
+    *error = fmt::format("Unable to write report: {}", filename);
+  }
+  return ok;
+}
+
+}  // namespace
+
+bool find_batch_logs(const vector<string>& inputs, const string& suffix,
+                     vector<BatchLog>* logs, string* error) {
+  for (const string& input : inputs) {
+    struct stat st;
+    if (stat(input.c_str(), &st) != 0) {
+      *error = fmt::format("Unable to open file: {}", input);
+      return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+      logs->push_back({input, input});
+      continue;
+    }
+    vector<string> files;
+    if (!list_files(input, suffix, &files)) {
+      *error = fmt::format("Unable to read directory: {}", input);
+      return false;
+    }
+    for (string& file : files) {
+      logs->push_back({fmt::format("{}/{}", input, file), move(file)});
+    }
+  }
+  return true;
+}
+
+size_t run_batch(const vector<BatchLog>& logs, const BatchOptions& options,
+                 FILE* out) {
+  vector<LogResult> results(logs.size());
+  // Reports are printed in the order of 'logs', as soon as every report
+  // before them is done.
+  mutex print_mutex;
+  vector<bool> done(logs.size(), false);
+  size_t next_to_print = 0;
+  size_t failures = 0;
+  parallel_for(logs.size(), options.jobs, [&](size_t i) {
+    string error;
+    bool ok = report_log(logs[i], options, &results[i], &error);
+    lock_guard<mutex> lock(print_mutex);
+    if (!ok) {
+      fmt::print(stderr, "{}\n", error);
+      failures++;
+    }
+    results[i].ok = ok;
+    done[i] = true;
+    if (!options.output_dir.empty()) {
+      return;
+    }
+    for (; next_to_print < logs.size() && done[next_to_print];
+         next_to_print++) {
+      LogResult& result = results[next_to_print];
+      if (result.ok) {
+        fmt::print(out, "==== {}: {} lines ====\n", logs[next_to_print].name,
+                   result.lines);
+        fwrite(result.report.data(), 1, result.report.size(), out);
+      }
+      result.report = string();
+    }
+  });
+
+  // Which logs use each set of flags.
+  struct Shared {
+    size_t compiles = 0;
+    vector<size_t> logs;
+  };
+  unordered_map<FlagKey, Shared, FlagKeyHash> shared;
+  size_t compiles = 0;
+  for (size_t i = 0; i < logs.size(); i++) {
+    for (auto& [key, count] : results[i].groups) {
+      Shared& entry = shared[key];
+      entry.compiles += count;
+      entry.logs.push_back(i);
+      compiles += count;
+    }
+  }
+  vector<pair<string, const Shared*>> by_logs;
+  for (auto& [key, entry] : shared) {
+    if (entry.logs.size() > 1) {
+      by_logs.emplace_back(flags_string(key), &entry);
+    }
+  }
+  sort(by_logs.begin(), by_logs.end(), [](const auto& a, const auto& b) {
+    if (a.second->logs.size() != b.second->logs.size()) {
+      return a.second->logs.size() > b.second->logs.size();
+    }
+    if (a.second->compiles != b.second->compiles) {
+      return a.second->compiles > b.second->compiles;
+    }
+    return a.first < b.first;
+  });
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out,
+             "Batch summary: {} logs, {} compiles with {} distinct sets of "
+             "flags, {} of them shared by several logs:\n",
+             logs.size() - failures, compiles, shared.size(), by_logs.size());
+  fmt::print(out, "----------------------------------------------------\n");
+  for (size_t i = 0; i < by_logs.size() && i < options.top_groups; i++) {
+    auto& [flags, entry] = by_logs[i];
+    string names;
+    for (size_t j = 0; j < entry->logs.size() && j < kMaxLogNames; j++) {
+      names += fmt::format("{}{}", j == 0 ? "" : ", ",
+                           logs[entry->logs[j]].name);
+    }
+    if (entry->logs.size() > kMaxLogNames) {
+      names += fmt::format(" and {} more",
+                           entry->logs.size() - kMaxLogNames);
+    }
+    fmt::print(out, "  Shared by {} logs, {} compiles: {}\n",
+               entry->logs.size(), entry->compiles, flags);
+    fmt::print(out, "    logs: {}\n", names);
+  }
+  return failures;
+}
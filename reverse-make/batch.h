@@ -0,0 +1,75 @@
+#ifndef REVERSE_MAKE_BATCH_H__
+#define REVERSE_MAKE_BATCH_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A build log of a batch.
+ */
+struct BatchLog {
+  // The path to read it from.
+  string path;
+  // What to call it in reports: its path relative to the directory it was
+  // found in, or the path it was given as.
+  string name;
+};
+
+/**
+ * How --batch runs.
+ */
+struct BatchOptions {
+  // The number of logs to work on at once.
+  int jobs = 1;
+  // The directory each log's report is written to, as <name>.txt; if empty,
+  // the reports are printed in order, each under a header.
+  string output_dir;
+  // How many of the flag groups shared by most logs to list.
+  size_t top_groups = 20;
+  // If true, problems in a log are worked around and summarized at the end of
+  // its report; see parse_log(). Otherwise a log with a problem fails, and
+  // the first is printed as its error.
+  bool keep_going = false;
+  // If not empty, the PIC twins of each log are folded, with these as the PIC
+  // flags; see PicTwins.
+  vector<string> pic_flags;
+};
+
+/**
+ * Finds the logs named by 'inputs'.
+ *
+ * @param inputs Logs, and directories to search recursively for logs.
+ * @param suffix The ending the names of the logs found in directories must
+ * have.
+ * @param logs Receives the logs, those of each directory ordered by path.
+ * @param error Set to why an input couldn't be read, if one couldn't.
+ *
+ * @return false if an input couldn't be read.
+ */
+bool find_batch_logs(const vector<string>& inputs, const string& suffix,
+                     vector<BatchLog>* logs, string* error);
+
+/**
+ * Reports on every log of a batch, then prints a summary of the flag groups
+ * that the logs share.
+ *
+ * Logs are parsed and reported on by a pool of 'options.jobs' threads, one
+ * log per thread at a time, all interning paths and flags into the same
+ * global tables. Identical flags therefore get the same FlagSetIds in every
+ * log, which is what lets the summary compare groups across logs cheaply.
+ *
+ * @param logs The logs.
+ * @param options How to run.
+ * @param out Where to print the reports, if they aren't written to files,
+ * and the summary.
+ *
+ * @return The number of logs that couldn't be read or reported on.
+ */
+size_t run_batch(const vector<BatchLog>& logs, const BatchOptions& options,
+                 FILE* out = stdout);
+
+#endif  // REVERSE_MAKE_BATCH_H__
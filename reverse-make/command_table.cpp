@@ -0,0 +1,191 @@
+#include "reverse-make/command_table.h"
+
+#include <algorithm>
+
+#include "reverse-make/hash.h"
+
+CommandTable::CommandTable()
+    : arena_(make_unique<Arena>()),
+      kinds_(arena_.get()),
+      compilers_(arena_.get()),
+      commands_(arena_.get()),
+      directories_(arena_.get()),
+      outputs_(arena_.get()),
+      depfiles_(arena_.get()),
+      input_offsets_(arena_.get()),
+      input_counts_(arena_.get()),
+      flags_in_order_(arena_.get()),
+      inputs_(arena_.get()),
+      slots_(arena_.get()) {
+  for (auto& column : flags_) {
+    column = ArenaVector<FlagSetId>(arena_.get());
+  }
+  slots_.assign(16, kNoRow);
+}
+
+CommandTable::RowId CommandTable::Add(const GccCommand& command) {
+  FlagSetTable& sets = FlagSetTable::Global();
+  FlagSetId flags[kNumFlagFields] = {
+      sets.Intern(command.defines),
+      sets.Intern(command.includes),
+      sets.Intern(command.cflags),
+      sets.Intern(command.warns),
+      sets.Intern(command.target_opts),
+      sets.Intern(command.optimizations),
+      sets.Intern(command.debug),
+      sets.Intern(command.linkopts),
+      sets.Intern(command.link_search_dirs),
+      sets.Intern(command.link_libs),
+  };
+  CommandKind kind = command.command == GccCommand::COMPILE
+                         ? CommandKind::COMPILE
+                         : CommandKind::LINK;
+  return AddRow(kind, command.compiler, command.command, command.directory,
+                command.output, command.depfile, command.inputs.data(),
+                command.inputs.size(), flags,
+                FlagListTable::Global().Intern(command.flags_in_order));
+}
+
+CommandTable::RowId CommandTable::Add(const ArCommand& command) {
+  static const FlagSetId kNoFlags[kNumFlagFields] = {};
+  return AddRow(CommandKind::AR, GccCommand::GCC, GccCommand::LINK,
+                command.directory, command.output,
+                PathTable::Global().Intern(""), command.inputs.data(),
+                command.inputs.size(), kNoFlags, 0);
+}
+
+void CommandTable::Append(const CommandTable& other) {
+  for (RowId row = 0; row < other.size(); row++) {
+    FlagSetId flags[kNumFlagFields];
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      flags[field] = other.flags_[field][row];
+    }
+    PathList inputs = other.inputs(row);
+    AddRow(other.kind(row), other.compiler(row), other.command(row),
+           other.directory(row), other.output(row), other.depfile(row),
+           inputs.begin(), inputs.size(), flags, other.flags_in_order(row));
+  }
+}
+
+CommandTable::RowId CommandTable::Find(CommandKind kind, PathId output) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t slot = Hash(kind, output) & mask;; slot = (slot + 1) & mask) {
+    RowId row = slots_[slot];
+    if (row == kNoRow || (outputs_[row] == output && kinds_[row] == kind)) {
+      return row;
+    }
+  }
+}
+
+vector<CommandTable::RowId> CommandTable::SortedRows(CommandKind kind) const {
+  PathTable& paths = PathTable::Global();
+  vector<pair<string_view, RowId>> keyed;
+  keyed.reserve(Count(kind));
+  for (RowId row = 0; row < size(); row++) {
+    if (kinds_[row] == kind) {
+      keyed.emplace_back(paths.Lookup(outputs_[row]), row);
+    }
+  }
+  // Outputs are unique within a kind, so the order is total.
+  sort(keyed.begin(), keyed.end());
+  vector<RowId> rows;
+  rows.reserve(keyed.size());
+  for (auto& [output, row] : keyed) {
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+bool CommandTable::FlagsMatch(RowId a, RowId b) const {
+  if (commands_[a] != commands_[b]) {
+    return false;
+  }
+  for (size_t field = 0; field < kNumFlagFields; field++) {
+    if (field != size_t(FlagField::OPTIMIZATIONS) &&
+        flags_[field][a] != flags_[field][b]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t CommandTable::FlagsFingerprint(RowId row) const {
+  // FNV-1a over the words, finished with a murmur3-style avalanche.
+  WordHash words;
+  words.Mix(commands_[row]);
+  for (size_t field = 0; field < kNumFlagFields; field++) {
+    if (field != size_t(FlagField::OPTIMIZATIONS)) {
+      words.Mix(flags_[field][row]);
+    }
+  }
+  uint64_t hash = words.hash();
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+CommandTable::RowId CommandTable::AddRow(CommandKind kind,
+                                         GccCommand::Compiler compiler,
+                                         GccCommand::Command command,
+                                         PathId directory, PathId output,
+                                         PathId depfile,
+                                         const PathId* inputs,
+                                         size_t num_inputs,
+                                         const FlagSetId* flags,
+                                         FlagListId flags_in_order) {
+  if (Find(kind, output) != kNoRow) {
+    return kNoRow;
+  }
+  if ((size() + 1) * 2 > slots_.size()) {
+    Rehash(slots_.size() * 2);
+  }
+
+  RowId row = size();
+  kinds_.push_back(kind);
+  compilers_.push_back(compiler);
+  commands_.push_back(command);
+  directories_.push_back(directory);
+  outputs_.push_back(output);
+  depfiles_.push_back(depfile);
+  input_offsets_.push_back(inputs_.size());
+  input_counts_.push_back(num_inputs);
+  inputs_.append(inputs, num_inputs);
+  for (size_t field = 0; field < kNumFlagFields; field++) {
+    flags_[field].push_back(flags[field]);
+  }
+  flags_in_order_.push_back(flags_in_order);
+  counts_[size_t(kind)]++;
+
+  size_t mask = slots_.size() - 1;
+  size_t slot = Hash(kind, output) & mask;
+  while (slots_[slot] != kNoRow) {
+    slot = (slot + 1) & mask;
+  }
+  slots_[slot] = row;
+  return row;
+}
+
+void CommandTable::Rehash(size_t num_slots) {
+  slots_ = ArenaVector<RowId>(arena_.get());
+  slots_.assign(num_slots, kNoRow);
+  size_t mask = num_slots - 1;
+  for (RowId row = 0; row < size(); row++) {
+    size_t slot = Hash(kinds_[row], outputs_[row]) & mask;
+    while (slots_[slot] != kNoRow) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = row;
+  }
+}
+
+size_t CommandTable::Hash(CommandKind kind, PathId output) {
+  // PathIds are dense, so scramble them before masking off the low bits.
+  uint64_t key = uint64_t(output) << 2 | uint64_t(kind);
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  return key;
+}
@@ -0,0 +1,206 @@
+#ifndef REVERSE_MAKE_COMMAND_TABLE_H__
+#define REVERSE_MAKE_COMMAND_TABLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "reverse-make/arena.h"
+#include "reverse-make/commands.h"
+#include "reverse-make/flags.h"
+#include "reverse-make/paths.h"
+
+using namespace std;
+
+/**
+ * What a row of a CommandTable builds.
+ */
+enum class CommandKind : uint8_t {
+  COMPILE,  // an object file, from gcc -c
+  LINK,     // an executable or shared library, from gcc
+  AR,       // a static library, from ar
+};
+
+/**
+ * The flag categories of a gcc command, in the order of GccCommand's fields.
+ */
+enum class FlagField : uint8_t {
+  DEFINES,
+  INCLUDES,
+  CFLAGS,
+  WARNS,
+  TARGET_OPTS,
+  OPTIMIZATIONS,
+  DEBUG_INFO,
+  LINKOPTS,
+  LINK_SEARCH_DIRS,
+  LINK_LIBS,
+};
+constexpr size_t kNumFlagFields = size_t(FlagField::LINK_LIBS) + 1;
+
+// The name of each FlagField, as reports show it.
+constexpr const char* kFlagFieldNames[kNumFlagFields] = {
+    "defines",     "includes",      "cflags", "warns",
+    "target_opts", "optimizations", "debug",  "linkopts",
+    "link_search_dirs", "link_libs",
+};
+
+/**
+ * A read-only view of a run of PathIds, such as a command's inputs.
+ */
+class PathList {
+ public:
+  PathList(const PathId* begin, const PathId* end)
+      : begin_(begin), end_(end) {}
+
+  const PathId* begin() const { return begin_; }
+  const PathId* end() const { return end_; }
+  size_t size() const { return end_ - begin_; }
+  bool empty() const { return begin_ == end_; }
+  PathId operator[](size_t i) const { return begin_[i]; }
+
+ private:
+  const PathId* begin_;
+  const PathId* end_;
+};
+
+/**
+ * Every command found in a build log, stored column by column.
+ *
+ * Each command is a row, and each property of a command is a contiguous
+ * column: its kind, compiler, directory, output path, dependency file, where its inputs
+ * start in a shared input array, one interned FlagSetId per flag category,
+ * and an interned FlagList of the flags in command-line order. Everything lives in one arena that is freed in one go with the
+ * table.
+ *
+ * Rows are unique by (kind, output); when the log builds the same output
+ * twice, the first command wins. An open-addressing hash index finds the row
+ * that builds a given output.
+ */
+class CommandTable {
+ public:
+  using RowId = uint32_t;
+  static constexpr RowId kNoRow = ~RowId(0);
+
+  CommandTable();
+  CommandTable(CommandTable&&) = default;
+  CommandTable& operator=(CommandTable&&) = default;
+
+  /**
+   * Adds a gcc command, which must be a COMPILE or LINK command.
+   *
+   * @return The new row, or kNoRow if the table already has a command of the
+   * same kind with the same output.
+   */
+  RowId Add(const GccCommand& command);
+
+  /**
+   * Adds an ar command.
+   *
+   * @return The new row, or kNoRow if the table already has an ar command with
+   * the same output.
+   */
+  RowId Add(const ArCommand& command);
+
+  /**
+   * Adds every row of 'other', in order, as if each had been added with Add().
+   */
+  void Append(const CommandTable& other);
+
+  /**
+   * Adds a row from its columns. 'directory' is where the command ran,
+   * relative to the build root. 'depfile' is the empty path if the command
+   * writes no dependency file. 'flags' holds a FlagSetId for each FlagField,
+   * and 'flags_in_order' the same flags as the command gave them.
+   *
+   * @return The new row, or kNoRow if the table already has a row of the same
+   * kind with the same output.
+   */
+  RowId AddRow(CommandKind kind, GccCommand::Compiler compiler,
+               GccCommand::Command command, PathId directory,
+               PathId output, PathId depfile, const PathId* inputs,
+               size_t num_inputs,
+               const FlagSetId* flags, FlagListId flags_in_order);
+
+  /**
+   * Returns the row of kind 'kind' that builds 'output', or kNoRow.
+   */
+  RowId Find(CommandKind kind, PathId output) const;
+
+  /**
+   * Returns the number of rows of kind 'kind'.
+   */
+  size_t Count(CommandKind kind) const { return counts_[size_t(kind)]; }
+
+  /**
+   * Returns the rows of kind 'kind', ordered by their output path.
+   */
+  vector<RowId> SortedRows(CommandKind kind) const;
+
+  size_t size() const { return kinds_.size(); }
+
+  CommandKind kind(RowId row) const { return kinds_[row]; }
+  GccCommand::Compiler compiler(RowId row) const {
+    return GccCommand::Compiler(compilers_[row]);
+  }
+  GccCommand::Command command(RowId row) const {
+    return GccCommand::Command(commands_[row]);
+  }
+  PathId directory(RowId row) const { return directories_[row]; }
+  PathId output(RowId row) const { return outputs_[row]; }
+  PathId depfile(RowId row) const { return depfiles_[row]; }
+  PathList inputs(RowId row) const {
+    const PathId* begin = inputs_.data() + input_offsets_[row];
+    return PathList(begin, begin + input_counts_[row]);
+  }
+  FlagSetId flags(RowId row, FlagField field) const {
+    return flags_[size_t(field)][row];
+  }
+  const FlagSet& flag_set(RowId row, FlagField field) const {
+    return FlagSetTable::Global().Lookup(flags(row, field));
+  }
+  FlagListId flags_in_order(RowId row) const { return flags_in_order_[row]; }
+  const FlagList& flag_list(RowId row) const {
+    return FlagListTable::Global().Lookup(flags_in_order(row));
+  }
+
+  /**
+   * Returns true if two gcc rows would be built the same way: the same command
+   * and the same flags in every category except optimizations.
+   */
+  bool FlagsMatch(RowId a, RowId b) const;
+
+  /**
+   * Returns a hash of the columns compared by FlagsMatch(). Rows whose flags
+   * match have the same fingerprint.
+   */
+  uint64_t FlagsFingerprint(RowId row) const;
+
+ private:
+  void Rehash(size_t num_slots);
+  static size_t Hash(CommandKind kind, PathId output);
+
+  // Behind a pointer so that the columns' storage survives moving the table.
+  unique_ptr<Arena> arena_;
+
+  ArenaVector<CommandKind> kinds_;
+  ArenaVector<uint8_t> compilers_;
+  ArenaVector<uint8_t> commands_;
+  ArenaVector<PathId> directories_;
+  ArenaVector<PathId> outputs_;
+  ArenaVector<PathId> depfiles_;
+  ArenaVector<uint32_t> input_offsets_;
+  ArenaVector<uint32_t> input_counts_;
+  ArenaVector<FlagSetId> flags_[kNumFlagFields];
+  ArenaVector<FlagListId> flags_in_order_;
+  // The inputs of every row, back to back.
+  ArenaVector<PathId> inputs_;
+
+  // Open-addressing index of rows by (kind, output), with linear probing. The
+  // number of slots is a power of two and at least twice the number of rows.
+  ArenaVector<RowId> slots_;
+  size_t counts_[3] = {};
+};
+
+#endif  // REVERSE_MAKE_COMMAND_TABLE_H__
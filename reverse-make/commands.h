@@ -1,11 +1,13 @@
 #ifndef REVERSE_MAKE_COMMANDS_H__
 #define REVERSE_MAKE_COMMANDS_H__
 
-#include <filesystem>
-#include <set>
+#include <cstdlib>
 #include <string>
 #include <vector>
 
+#include "reverse-make/flags.h"
+#include "reverse-make/paths.h"
+
 using namespace std;
 
 /**
@@ -13,7 +15,7 @@ using namespace std;
  * or G++ command.
  */
 struct GccCommand {
-  enum { GCC, GPP } compiler;
+  enum Compiler { GCC, GPP } compiler;
 
   enum Command {
     COMPILE,              // -c
@@ -22,24 +24,31 @@ struct GccCommand {
     LINK
   } command;
 
-  set<string> defines;   // -D
-  set<string> includes;  // -I
-  set<string> cflags;    // -fsomething, -std
+  FlagSet defines;   // -D, -U
+  FlagSet includes;  // -I
+  FlagSet cflags;    // -fsomething, -std
 
-  set<string> warns;          // -W
-  set<string> target_opts;    // -m
-  set<string> optimizations;  // -O
-  set<string> debug;          // -g
+  FlagSet warns;          // -W
+  FlagSet target_opts;    // -m
+  FlagSet optimizations;  // -O
+  FlagSet debug;          // -g
 
   // Link options
-  set<string> linkopts;
-  set<string> link_search_dirs;  // -Ldir
-  set<string> link_libs;         // -Ldir
+  FlagSet linkopts;
+  FlagSet link_search_dirs;  // -Ldir
+  FlagSet link_libs;         // -Ldir
+
+  // Every flag in the sets above, in the order the command gave them.
+  FlagList flags_in_order;
 
-  vector<filesystem::path> inputs;
-  filesystem::path output;
+  vector<PathId> inputs;
+  PathId output;
+  PathId depfile;  // -MF, or the empty path
+  // The directory the command ran in, relative to the build root; see
+  // DirectoryStack::current().
+  PathId directory;
 
-  std::string CompilerAsString() {
+  static std::string CompilerAsString(Compiler compiler) {
     switch (compiler) {
       case GCC:
         return "gcc";
@@ -50,7 +59,7 @@ struct GccCommand {
     }
   }
 
-  std::string CommandAsString() {
+  static std::string CommandAsString(Command command) {
     switch (command) {
       case COMPILE:
         return "COMPILE";
@@ -65,22 +74,17 @@ struct GccCommand {
     }
   }
 
-  bool FlagsMatch(const GccCommand& other) {
-    return other.command == command && other.defines == defines &&
-           other.includes == includes && other.cflags == cflags &&
-           other.warns == warns && other.target_opts == target_opts &&
-           other.debug == debug && other.linkopts == linkopts &&
-           other.link_search_dirs == link_search_dirs &&
-           other.link_libs == link_libs;
-  }
+  std::string CompilerAsString() const { return CompilerAsString(compiler); }
+  std::string CommandAsString() const { return CommandAsString(command); }
 };
 
 /**
  * Struct that holds the input and output file paths for an 'ar' command.
  */
 struct ArCommand {
-  vector<filesystem::path> inputs;
-  filesystem::path output;
+  vector<PathId> inputs;
+  PathId output;
+  PathId directory;  // as for GccCommand
 };
 
 #endif  // REVERSE_MAKE_COMMANDS_H__
@@ -0,0 +1,807 @@
+#include "reverse-make/compdb.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "reverse-make/gcc_options.h"
+#include "reverse-make/json.h"
+#include "reverse-make/parallel.h"
+#include "reverse-make/stats.h"
+#include "reverse-make/tokenizer.h"
+
+namespace {
+
+constexpr size_t kReadSize = 1 << 20;
+
+// How deeply objects and arrays may nest inside an entry.
+constexpr int kMaxDepth = 64;
+
+// How many entries each job gets per batch.
+constexpr size_t kEntriesPerJob = 512;
+
+// How many response files one command may expand, counting nested ones.
+constexpr int kMaxResponseFiles = 64;
+
+bool is_json_space(int c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+int hex_value(int c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void append_utf8(uint32_t code_point, string* str) {
+  if (code_point < 0x80) {
+    *str += char(code_point);
+  } else if (code_point < 0x800) {
+    *str += char(0xc0 | (code_point >> 6));
+    *str += char(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    *str += char(0xe0 | (code_point >> 12));
+    *str += char(0x80 | ((code_point >> 6) & 0x3f));
+    *str += char(0x80 | (code_point & 0x3f));
+  } else {
+    *str += char(0xf0 | (code_point >> 18));
+    *str += char(0x80 | ((code_point >> 12) & 0x3f));
+    *str += char(0x80 | ((code_point >> 6) & 0x3f));
+    *str += char(0x80 | (code_point & 0x3f));
+  }
+}
+
+string_view basename_of(string_view path) {
+  size_t slash = path.rfind('/');
+  return slash == string_view::npos ? path : path.substr(slash + 1);
+}
+
+bool ends_with(string_view str, string_view suffix) {
+  return str.size() >= suffix.size() &&
+         str.substr(str.size() - suffix.size()) == suffix;
+}
+
+/**
+ * Returns "gcc" or "g++" for the compilers that process_gcc_command()
+ * understands the options of, or "" for any other program.
+ */
+string_view compiler_name(string_view program) {
+  string_view name = basename_of(program);
+  // Drop a version suffix, as in "gcc-12" or "clang++-15".
+  size_t dash = name.rfind('-');
+  if (dash != string_view::npos && dash + 1 < name.size() &&
+      all_of(name.begin() + dash + 1, name.end(),
+             [](char c) { return (c >= '0' && c <= '9') || c == '.'; })) {
+    name = name.substr(0, dash);
+  }
+  if (name == "g++" || name == "c++" || name == "clang++" ||
+      ends_with(name, "-g++")) {
+    return "g++";
+  }
+  if (name == "gcc" || name == "cc" || name == "clang" ||
+      ends_with(name, "-gcc")) {
+    return "gcc";
+  }
+  return "";
+}
+
+bool is_wrapper(string_view program) {
+  string_view name = basename_of(program);
+  return name == "ccache" || name == "distcc" || name == "sccache";
+}
+
+}  // namespace
+
+void split_response_file(string_view contents, vector<string>* args) {
+  string arg;
+  bool in_arg = false;
+  char quote = 0;
+  for (size_t i = 0; i < contents.size(); i++) {
+    char c = contents[i];
+    if (c == '\\' && i + 1 < contents.size()) {
+      arg += contents[++i];
+      in_arg = true;
+    } else if (quote != 0) {
+      if (c == quote) {
+        quote = 0;
+      } else {
+        arg += c;
+      }
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      in_arg = true;
+    } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+               c == '\f' || c == '\v') {
+      if (in_arg) {
+        args->push_back(move(arg));
+        arg.clear();
+        in_arg = false;
+      }
+    } else {
+      arg += c;
+      in_arg = true;
+    }
+  }
+  if (in_arg) {
+    args->push_back(move(arg));
+  }
+}
+
+namespace {
+
+/**
+ * The response files read so far, shared by every thread. A database that
+ * uses them tends to refer to a handful of files from every entry, so each is
+ * read once.
+ */
+class ResponseFiles {
+ public:
+  /**
+   * Appends the arguments in the response file at 'path' to 'args'.
+   *
+   * @return false if the file can't be read.
+   */
+  bool Expand(const string& path, vector<string>* args) {
+    {
+      lock_guard<mutex> lock(mutex_);
+      auto it = files_.find(path);
+      if (it != files_.end()) {
+        args->insert(args->end(), it->second.begin(), it->second.end());
+        return true;
+      }
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+      return false;
+    }
+    string contents;
+    char block[4096];
+    size_t n;
+    while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+      contents.append(block, n);
+    }
+    fclose(file);
+    vector<string> file_args;
+    split_response_file(contents, &file_args);
+    args->insert(args->end(), file_args.begin(), file_args.end());
+
+    lock_guard<mutex> lock(mutex_);
+    files_.emplace(path, move(file_args));
+    return true;
+  }
+
+ private:
+  mutex mutex_;
+  unordered_map<string, vector<string>> files_;
+};
+
+/**
+ * Processes one entry of a compilation database into 'parsed', the way
+ * parse_chunk() processes a line of a build log. Its paths are resolved
+ * against its directory, as if make had entered it from 'root'. With
+ * 'keep_going', problems are recorded in parsed->diagnostics on the entry's
+ * line.
+ */
+void process_entry(const CompileDbEntry& entry, ResponseFiles* response_files,
+                   const DirectoryStack& root, bool keep_going,
+                   ParsedChunk* parsed, PhaseTimer* timer) {
+  static thread_local CommandTokenizer tokenizer;
+  static thread_local vector<string_view> parts;
+  static thread_local vector<string> args;
+  static thread_local vector<string> expanded;
+
+  parts.clear();
+  if (entry.has_arguments) {
+    parts.assign(entry.arguments.begin(), entry.arguments.end());
+  } else {
+    const auto& tokens = tokenizer.Tokenize(entry.command);
+    parts.assign(tokens.begin(), tokens.end());
+  }
+
+  // Arguments are used in place unless a response file has to be expanded,
+  // including any that the response file names itself.
+  if (any_of(parts.begin(), parts.end(), [](string_view part) {
+        return part.size() > 1 && part[0] == '@';
+      })) {
+    args.assign(parts.begin(), parts.end());
+    int num_expanded = 0;
+    for (size_t i = 0; i < args.size() && num_expanded < kMaxResponseFiles;
+         i++) {
+      if (args[i].size() < 2 || args[i][0] != '@') {
+        continue;
+      }
+      string path = args[i].substr(1);
+      if (path[0] != '/' && !entry.directory.empty()) {
+        path = entry.directory + "/" + path;
+      }
+      expanded.clear();
+      if (response_files->Expand(path, &expanded)) {
+        args.erase(args.begin() + i);
+        args.insert(args.begin() + i, expanded.begin(), expanded.end());
+        num_expanded++;
+        i--;
+      }
+    }
+    parts.assign(args.begin(), args.end());
+  }
+
+  size_t first = 0;
+  while (first + 1 < parts.size() && is_wrapper(parts[first])) {
+    first++;
+  }
+  parts.erase(parts.begin(), parts.begin() + first);
+  timer->Lap(Phase::TOKENIZE);
+
+  if (parts.empty()) {
+    return;
+  }
+  string_view compiler = compiler_name(parts[0]);
+  if (!compiler.empty()) {
+    parts[0] = compiler;
+  }
+  DirectoryStack directories = root;
+  if (!entry.directory.empty()) {
+    DirectoryChange change;
+    change.entering = true;
+    change.directory = entry.directory;
+    directories.Apply(change);
+  }
+  parsed->diagnostics.SetLine(entry.line);
+  if (compiler.empty() ||
+      !add_command(parts, &parsed->commands,
+                   keep_going ? &parsed->diagnostics : nullptr,
+                   &directories)) {
+    parsed->skipped_commands.emplace_back(entry.line, string(parts[0]));
+  }
+  timer->Lap(Phase::PROCESS);
+}
+
+/**
+ * Appends 'arg' to 'out' as one argument of a response file, escaping
+ * whatever split_response_file() would otherwise interpret.
+ */
+void append_response_file_arg(string_view arg, fmt::memory_buffer* out) {
+  for (char c : arg) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+        c == '\v' || c == '\'' || c == '"' || c == '\\') {
+      out->push_back('\\');
+    }
+    out->push_back(c);
+  }
+  out->push_back('\n');
+}
+
+/**
+ * Appends the flags of a row, in the order its command gave them, as the
+ * arguments that would give them. Options recorded together with their value,
+ * such as "-Xlinker x", are split back into two arguments.
+ */
+void append_flag_args(const CommandTable& commands, CommandTable::RowId row,
+                      vector<string_view>* args) {
+  FlagInterner& flags = FlagInterner::Global();
+  for (uint32_t id : commands.flag_list(row).ids()) {
+    string_view flag = flags.Lookup(id);
+    size_t space = flag.find(' ');
+    const GccOption* option = nullptr;
+    if (space != string_view::npos) {
+      option = classify_gcc_option(flag.substr(0, space));
+    }
+    if (option != nullptr && option->arity == GccOptionArity::JOINED_NEXT) {
+      args->push_back(flag.substr(0, space));
+      args->push_back(flag.substr(space + 1));
+    } else {
+      args->push_back(flag);
+    }
+  }
+}
+
+string current_directory() {
+  char cwd[PATH_MAX];
+  return getcwd(cwd, sizeof(cwd)) != nullptr ? string(cwd) : string(".");
+}
+
+bool write_buffer(const fmt::memory_buffer& buffer, FILE* file) {
+  return buffer.size() == 0 ||
+         fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+}
+
+}  // namespace
+
+CompileDbReader::CompileDbReader(int fd, bool owns_fd)
+    : fd_(fd), owns_fd_(owns_fd), buffer_(kReadSize) {}
+
+CompileDbReader::~CompileDbReader() {
+  if (owns_fd_) {
+    close(fd_);
+  }
+}
+
+unique_ptr<CompileDbReader> CompileDbReader::Open(const string& filename) {
+  if (filename == "-") {
+    return unique_ptr<CompileDbReader>(
+        new CompileDbReader(STDIN_FILENO, false));
+  }
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return unique_ptr<CompileDbReader>(new CompileDbReader(fd, true));
+}
+
+bool CompileDbReader::Fill() {
+  if (eof_) {
+    return false;
+  }
+  ssize_t n;
+  do {
+    n = read(fd_, buffer_.data(), buffer_.size());
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) {
+    eof_ = true;
+    if (n < 0) {
+      Fail("read failed");
+    }
+    return false;
+  }
+  pos_ = 0;
+  end_ = n;
+  bytes_read_ += n;
+  return true;
+}
+
+void CompileDbReader::SkipWhitespace() {
+  while (is_json_space(Peek())) {
+    Get();
+  }
+}
+
+bool CompileDbReader::Expect(char c) {
+  SkipWhitespace();
+  int got = Get();
+  if (got != c) {
+    return Fail(got < 0 ? fmt::format("expected '{}' but the file ended", c)
+                        : fmt::format("expected '{}' but got '{}'", c,
+                                      char(got)));
+  }
+  return true;
+}
+
+bool CompileDbReader::ReadString(string* str) {
+  str->clear();
+  if (!Expect('"')) {
+    return false;
+  }
+  while (true) {
+    // Copy the run up to the next quote or escape in one go.
+    if (pos_ == end_ && !Fill()) {
+      return Fail("unterminated string");
+    }
+    size_t run = pos_;
+    while (run < end_ && buffer_[run] != '"' && buffer_[run] != '\\') {
+      run++;
+    }
+    str->append(buffer_.data() + pos_, run - pos_);
+    pos_ = run;
+    if (pos_ == end_) {
+      continue;
+    }
+
+    if (Get() == '"') {
+      return true;
+    }
+    int c = Get();
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        *str += char(c);
+        break;
+      case 'b':
+        *str += '\b';
+        break;
+      case 'f':
+        *str += '\f';
+        break;
+      case 'n':
+        *str += '\n';
+        break;
+      case 'r':
+        *str += '\r';
+        break;
+      case 't':
+        *str += '\t';
+        break;
+      case 'u': {
+        uint32_t code_point = 0;
+        for (int i = 0; i < 4; i++) {
+          int digit = hex_value(Get());
+          if (digit < 0) {
+            return Fail("bad \\u escape");
+          }
+          code_point = code_point * 16 + digit;
+        }
+        // A high surrogate must be followed by a low one, and a low one
+        // can't stand alone.
+        if (code_point >= 0xdc00 && code_point < 0xe000) {
+          return Fail("bad surrogate pair");
+        }
+        if (code_point >= 0xd800 && code_point < 0xdc00) {
+          if (Get() != '\\' || Get() != 'u') {
+            return Fail("bad surrogate pair");
+          }
+          uint32_t low = 0;
+          for (int i = 0; i < 4; i++) {
+            int digit = hex_value(Get());
+            if (digit < 0) {
+              return Fail("bad \\u escape");
+            }
+            low = low * 16 + digit;
+          }
+          if (low < 0xdc00 || low >= 0xe000) {
+            return Fail("bad surrogate pair");
+          }
+          code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+        }
+        append_utf8(code_point, str);
+        break;
+      }
+      default:
+        return Fail("bad escape in string");
+    }
+  }
+}
+
+bool CompileDbReader::ReadStringArray(vector<string>* strings) {
+  size_t n = 0;
+  if (!Expect('[')) {
+    return false;
+  }
+  SkipWhitespace();
+  if (Peek() == ']') {
+    Get();
+    strings->clear();
+    return true;
+  }
+  while (true) {
+    // Reuse the strings already in the vector.
+    if (n == strings->size()) {
+      strings->emplace_back();
+    }
+    if (!ReadString(&(*strings)[n++])) {
+      return false;
+    }
+    SkipWhitespace();
+    int c = Get();
+    if (c == ']') {
+      break;
+    } else if (c != ',') {
+      return Fail("expected ',' or ']' in array");
+    }
+  }
+  strings->resize(n);
+  return true;
+}
+
+bool CompileDbReader::SkipValue(int depth) {
+  if (depth > kMaxDepth) {
+    return Fail("too deeply nested");
+  }
+  SkipWhitespace();
+  int c = Peek();
+  if (c == '"') {
+    return ReadString(&key_);
+  } else if (c == '[' || c == '{') {
+    char close = c == '[' ? ']' : '}';
+    Get();
+    SkipWhitespace();
+    if (Peek() == close) {
+      Get();
+      return true;
+    }
+    while (true) {
+      if (close == '}') {
+        if (!ReadString(&key_) || !Expect(':')) {
+          return false;
+        }
+      }
+      if (!SkipValue(depth + 1)) {
+        return false;
+      }
+      SkipWhitespace();
+      int next = Get();
+      if (next == close) {
+        return true;
+      } else if (next != ',') {
+        return Fail(fmt::format("expected ',' or '{}'", close));
+      }
+    }
+  }
+  // A number, true, false or null.
+  size_t length = 0;
+  while ((c = Peek()) >= 0 &&
+         (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+    Get();
+    length++;
+  }
+  return length > 0 || Fail("expected a value");
+}
+
+bool CompileDbReader::ReadEntry(CompileDbEntry* entry) {
+  SkipWhitespace();
+  entry->line = line_;
+  entry->directory.clear();
+  entry->file.clear();
+  entry->output.clear();
+  entry->command.clear();
+  entry->has_arguments = false;
+  bool has_command = false;
+  if (!Expect('{')) {
+    return false;
+  }
+  SkipWhitespace();
+  if (Peek() == '}') {
+    Get();
+  } else {
+    while (true) {
+      if (!ReadString(&key_) || !Expect(':')) {
+        return false;
+      }
+      bool ok;
+      if (key_ == "directory") {
+        ok = ReadString(&entry->directory);
+      } else if (key_ == "file") {
+        ok = ReadString(&entry->file);
+      } else if (key_ == "output") {
+        ok = ReadString(&entry->output);
+      } else if (key_ == "command") {
+        ok = ReadString(&entry->command);
+        has_command = true;
+      } else if (key_ == "arguments") {
+        ok = ReadStringArray(&entry->arguments);
+        entry->has_arguments = true;
+      } else {
+        ok = SkipValue(0);
+      }
+      if (!ok) {
+        return false;
+      }
+      SkipWhitespace();
+      int c = Get();
+      if (c == '}') {
+        break;
+      } else if (c != ',') {
+        return Fail("expected ',' or '}' in entry");
+      }
+    }
+  }
+  if (!entry->has_arguments && !has_command) {
+    return Fail("the entry has neither \"arguments\" nor \"command\"");
+  }
+  return true;
+}
+
+bool CompileDbReader::Next(CompileDbEntry* entry) {
+  if (done_ || !error_.empty()) {
+    return false;
+  }
+  SkipWhitespace();
+  if (!started_) {
+    if (!Expect('[')) {
+      return false;
+    }
+    started_ = true;
+    SkipWhitespace();
+    if (Peek() != ']') {
+      return ReadEntry(entry);
+    }
+  }
+  int c = Get();
+  if (c == ',') {
+    return ReadEntry(entry);
+  } else if (c != ']') {
+    return Fail("expected ',' or ']' after entry");
+  }
+  done_ = true;
+  SkipWhitespace();
+  if (Peek() >= 0) {
+    return Fail("unexpected data after the end of the database");
+  }
+  return false;
+}
+
+bool CompileDbReader::Fail(const string& what) {
+  if (error_.empty()) {
+    error_ = fmt::format("line {}: {}", line_, what);
+  }
+  return false;
+}
+
+bool parse_compdb(const string& filename, int jobs, CommandTable* commands,
+                  vector<SkippedCommand>* skipped_commands, string* error,
+                  Diagnostics* diagnostics) {
+  auto reader = CompileDbReader::Open(filename);
+  if (!reader) {
+    *error = fmt::format("Unable to open file: {}", filename);
+    return false;
+  }
+  ResponseFiles response_files;
+  vector<CompileDbEntry> entries(kEntriesPerJob * max(jobs, 1));
+  vector<ParsedChunk> parsed(max(jobs, 1) * 4);
+  // The directory of the first entry is taken to be the build's.
+  DirectoryStack root;
+  bool rooted = false;
+  bool more = true;
+  while (more) {
+    size_t n = 0;
+    {
+      ScopedPhase phase(Phase::READ);
+      while (n < entries.size() && (more = reader->Next(&entries[n]))) {
+        n++;
+      }
+    }
+    if (!reader->error().empty()) {
+      *error = fmt::format("Malformed compilation database {}, {}", filename,
+                           reader->error());
+      return false;
+    }
+
+    if (n > 0 && !rooted && !entries[0].directory.empty()) {
+      rooted = true;
+      DirectoryChange change;
+      change.entering = true;
+      change.directory = entries[0].directory;
+      root.Apply(change);
+    }
+
+    // Process the batch in slices, one per work item, and add the slices in
+    // order.
+    ScopedPhase phase(Phase::PARSE);
+    size_t per_slice = (n + parsed.size() - 1) / parsed.size();
+    parallel_for(parsed.size(), jobs, [&](size_t slice) {
+      PhaseTimer timer;
+      size_t end = min(n, (slice + 1) * per_slice);
+      for (size_t i = slice * per_slice; i < end; i++) {
+        process_entry(entries[i], &response_files, root,
+                      diagnostics != nullptr, &parsed[slice], &timer);
+      }
+    });
+    for (ParsedChunk& slice : parsed) {
+      commands->Append(slice.commands);
+      if (diagnostics != nullptr) {
+        diagnostics->Merge(slice.diagnostics, 0);
+      }
+      for (auto& skipped : slice.skipped_commands) {
+        skipped_commands->push_back(skipped);
+        print_skipped_command(skipped);
+      }
+      slice = ParsedChunk();
+    }
+  }
+
+  if (Stats* stats = Stats::Active()) {
+    stats->counts().bytes += reader->bytes_read();
+    stats->counts().lines += reader->lines() - 1;
+  }
+  return true;
+}
+
+bool write_compdb(const CommandTable& commands, const string& filename,
+                  const string& directory, const string& flag_files_dir) {
+  PathTable& paths = PathTable::Global();
+  string cwd = current_directory();
+  const string& entry_directory = directory.empty() ? cwd : directory;
+
+  // Response files are written relative to here, but referred to from
+  // commands that run in 'directory'.
+  string flag_files_path;
+  if (!flag_files_dir.empty()) {
+    if (mkdir(flag_files_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+      return false;
+    }
+    flag_files_path = flag_files_dir[0] == '/'
+                          ? flag_files_dir
+                          : cwd + "/" + flag_files_dir;
+  }
+  unordered_map<FlagListId, string> flag_files;
+
+  string temp_filename = filename + ".tmp";
+  FILE* file = fopen(temp_filename.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = fputs("[", file) >= 0;
+  bool first = true;
+  fmt::memory_buffer entry;
+  vector<string_view> args;
+  for (CommandTable::RowId row = 0; ok && row < commands.size(); row++) {
+    if (commands.kind(row) != CommandKind::COMPILE) {
+      continue;
+    }
+    string compiler = commands.compiler(row) == GccCommand::GPP ? "g++" : "gcc";
+    args.clear();
+    args.push_back(compiler);
+
+    string response_file;
+    if (flag_files_dir.empty()) {
+      append_flag_args(commands, row, &args);
+    } else {
+      // Rows share a file when they give the same flags in the same order.
+      FlagListId key = commands.flags_in_order(row);
+      bool any = key != 0;
+      auto it = flag_files.find(key);
+      if (any && it == flag_files.end()) {
+        // The first command with these flags; write them out.
+        string name = fmt::format("flags-{}.rsp", flag_files.size());
+        vector<string_view> flag_args;
+        append_flag_args(commands, row, &flag_args);
+        fmt::memory_buffer contents;
+        for (string_view arg : flag_args) {
+          append_response_file_arg(arg, &contents);
+        }
+        FILE* flag_file = fopen((flag_files_dir + "/" + name).c_str(), "wb");
+        ok = flag_file != nullptr && write_buffer(contents, flag_file);
+        if (flag_file != nullptr) {
+          ok = fclose(flag_file) == 0 && ok;
+        }
+        it = flag_files.emplace(key, "@" + flag_files_path + "/" + name).first;
+      }
+      if (any) {
+        args.push_back(it->second);
+      }
+    }
+    args.push_back("-c");
+    args.push_back("-o");
+    args.push_back(paths.Lookup(commands.output(row)));
+    PathList inputs = commands.inputs(row);
+    for (PathId input : inputs) {
+      args.push_back(paths.Lookup(input));
+    }
+
+    for (PathId input : inputs) {
+      entry.clear();
+      fmt::format_to(back_inserter(entry), "{}\n  {{\"directory\": ",
+                     first ? "" : ",");
+      append_json_string(entry_directory, &entry);
+      fmt::format_to(back_inserter(entry), ", \"file\": ");
+      append_json_string(paths.Lookup(input), &entry);
+      fmt::format_to(back_inserter(entry), ", \"output\": ");
+      append_json_string(paths.Lookup(commands.output(row)), &entry);
+      fmt::format_to(back_inserter(entry), ", \"arguments\": [");
+      for (size_t i = 0; i < args.size(); i++) {
+        if (i > 0) {
+          fmt::format_to(back_inserter(entry), ", ");
+        }
+        append_json_string(args[i], &entry);
+      }
+      fmt::format_to(back_inserter(entry), "]}}");
+      ok = ok && write_buffer(entry, file);
+      first = false;
+    }
+  }
+  ok = ok && fputs("\n]\n", file) >= 0;
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,188 @@
+#ifndef REVERSE_MAKE_COMPDB_H__
+#define REVERSE_MAKE_COMPDB_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/parse.h"
+
+using namespace std;
+
+/**
+ * One entry of a JSON compilation database (compile_commands.json): how one
+ * source file is compiled.
+ */
+struct CompileDbEntry {
+  // The line of the file the entry starts on.
+  int line = 0;
+  string directory;
+  string file;
+  string output;
+  // The command as one shell-escaped string, if the entry has "command".
+  string command;
+  // The command split into arguments, if the entry has "arguments", which
+  // takes precedence over "command".
+  bool has_arguments = false;
+  vector<string> arguments;
+};
+
+/**
+ * Reads the entries of a compilation database one at a time, without ever
+ * holding the whole file in memory.
+ *
+ * The file is read in fixed-size blocks and parsed by a small pull parser
+ * that understands just enough JSON for a compilation database: a top-level
+ * array of objects. The "directory", "file", "output", "command" and
+ * "arguments" members of each object are kept; any other member is skipped,
+ * whatever its value.
+ */
+class CompileDbReader {
+ public:
+  ~CompileDbReader();
+
+  /**
+   * Opens the given file for reading. The filename "-" means stdin.
+   *
+   * @return The opened reader, or nullptr if the file can't be opened.
+   */
+  static unique_ptr<CompileDbReader> Open(const string& filename);
+
+  /**
+   * Reads the next entry. The strings of 'entry' are reused, so passing the
+   * same entry again and again avoids allocating.
+   *
+   * @return false at the end of the database, or if it is malformed, in which
+   * case error() says why.
+   */
+  bool Next(CompileDbEntry* entry);
+
+  /**
+   * Returns why the database couldn't be read, or "" if it could.
+   */
+  const string& error() const { return error_; }
+
+  uint64_t bytes_read() const { return bytes_read_; }
+  int lines() const { return line_; }
+
+  CompileDbReader(const CompileDbReader&) = delete;
+  CompileDbReader& operator=(const CompileDbReader&) = delete;
+
+ private:
+  CompileDbReader(int fd, bool owns_fd);
+
+  // Returns the next character without consuming it, or -1 at the end.
+  int Peek() {
+    if (pos_ == end_ && !Fill()) {
+      return -1;
+    }
+    return static_cast<unsigned char>(buffer_[pos_]);
+  }
+
+  // Consumes and returns the next character, or -1 at the end.
+  int Get() {
+    int c = Peek();
+    if (c >= 0) {
+      pos_++;
+      if (c == '\n') {
+        line_++;
+      }
+    }
+    return c;
+  }
+
+  bool Fill();
+  void SkipWhitespace();
+  bool Expect(char c);
+  bool ReadString(string* str);
+  bool ReadStringArray(vector<string>* strings);
+  bool SkipValue(int depth);
+  bool ReadEntry(CompileDbEntry* entry);
+  bool Fail(const string& what);
+
+  int fd_;
+  bool owns_fd_;
+  vector<char> buffer_;
+  size_t pos_ = 0;
+  size_t end_ = 0;
+  bool eof_ = false;
+  bool started_ = false;
+  bool done_ = false;
+  int line_ = 1;
+  uint64_t bytes_read_ = 0;
+  string key_;
+  string error_;
+};
+
+/**
+ * Reads a compilation database into a CommandTable.
+ *
+ * Each entry's arguments, or its command split the way a build log line is,
+ * go through add_command(), as if the command had been found in a build log.
+ * Response files ("@file" arguments) are expanded, relative to the entry's
+ * directory. Compiler wrappers such as ccache are dropped, and compilers are
+ * recognized by name: "cc", "clang" and "*-gcc" count as gcc, and "c++",
+ * "clang++" and "*-g++" as g++. Entries with any other program are skipped.
+ *
+ * Entries are read a batch at a time and processed in parallel, then added in
+ * file order, so the result doesn't depend on the number of jobs. Paths are
+ * resolved against their entry's directory and canonicalized, relative to the
+ * directory of the first entry, which is taken to be the build's (see
+ * DirectoryStack); paths outside it stay absolute.
+ *
+ * @param filename The compilation database, or "-" for stdin.
+ * @param jobs The number of threads to process entries with.
+ * @param commands Receives the commands.
+ * @param skipped_commands Receives the entries that weren't gcc or g++
+ * commands, by the line each starts on.
+ * @param error Set to why the database couldn't be read, if it couldn't.
+ * @param diagnostics If not null, problems with entries that would abort are
+ * collected here instead, by the line each entry starts on; see parse_log().
+ *
+ * @return false if the database couldn't be opened or is malformed.
+ */
+bool parse_compdb(const string& filename, int jobs, CommandTable* commands,
+                  vector<SkippedCommand>* skipped_commands, string* error,
+                  Diagnostics* diagnostics = nullptr);
+
+/**
+ * Splits the contents of a response file into arguments, the way gcc does:
+ * whitespace separates arguments, single and double quotes group them, and a
+ * backslash escapes the next character anywhere. The arguments are appended
+ * to 'args'.
+ */
+void split_response_file(string_view contents, vector<string>* args);
+
+/**
+ * Writes the compile commands of 'commands' as a compilation database, with
+ * an entry for each input of each compile command, in log order.
+ *
+ * Entries are formatted and written one at a time, so memory use doesn't grow
+ * with the number of commands. The file is written under a temporary name and
+ * renamed into place.
+ *
+ * Each command's flags are written in the order the command gave them, since
+ * the order of -I, -isystem, -D and -U matters to the compiler.
+ *
+ * If 'flag_files_dir' isn't empty, each distinct list of flags is written
+ * once, to a response file in that directory, and entries refer to it with an
+ * "@file" argument instead of repeating the flags. Files are numbered in the
+ * order their flags are first used. gcc, clang and parse_compdb() all expand
+ * response files.
+ *
+ * @param commands The commands parsed from a build log.
+ * @param filename The file to write.
+ * @param directory The directory the commands ran in, recorded in every
+ * entry; the current directory if empty.
+ * @param flag_files_dir Where to write shared response files, or "".
+ *
+ * @return false if a file couldn't be written.
+ */
+bool write_compdb(const CommandTable& commands, const string& filename,
+                  const string& directory, const string& flag_files_dir);
+
+#endif  // REVERSE_MAKE_COMPDB_H__
@@ -0,0 +1,235 @@
+#include "reverse-make/depfiles.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "reverse-make/parallel.h"
+
+namespace {
+
+/**
+ * Calls fn(contents) with the contents of the file at 'path', mapped into
+ * memory for the duration of the call.
+ *
+ * @return false if the file can't be read.
+ */
+template <typename Fn>
+bool with_mapped_file(const string& path, Fn fn) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    fn(string_view());
+    return true;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  fn(string_view(static_cast<const char*>(data), st.st_size));
+  munmap(data, st.st_size);
+  return true;
+}
+
+/**
+ * Returns the paths to try for the dependency file 'depfile': the file
+ * itself, and for an automake ".Tpo" file, what it is renamed to.
+ */
+vector<string> depfile_candidates(string_view depfile, const string& root) {
+  string path(depfile);
+  if (!path.empty() && path[0] != '/' && !root.empty() && root != ".") {
+    path = root + "/" + path;
+  }
+  vector<string> candidates = {path};
+  const string kTemp = ".Tpo";
+  if (path.size() > kTemp.size() &&
+      path.compare(path.size() - kTemp.size(), kTemp.size(), kTemp) == 0) {
+    string stem = path.substr(0, path.size() - kTemp.size());
+    candidates.push_back(stem + ".Plo");
+    candidates.push_back(stem + ".Po");
+  }
+  return candidates;
+}
+
+}  // namespace
+
+void HeaderGraph::Add(PathId source, const vector<PathId>& headers) {
+  if (headers.empty()) {
+    return;
+  }
+  vector<PathId>& existing = headers_[source];
+  size_t before = existing.size();
+  existing.insert(existing.end(), headers.begin(), headers.end());
+  sort(existing.begin(), existing.end());
+  existing.erase(unique(existing.begin(), existing.end()), existing.end());
+  num_edges_ += existing.size() - before;
+}
+
+const vector<PathId>& HeaderGraph::headers(PathId source) const {
+  static const vector<PathId> kNone;
+  auto it = headers_.find(source);
+  return it == headers_.end() ? kNone : it->second;
+}
+
+vector<pair<PathId, size_t>> HeaderGraph::MostIncluded(size_t n) const {
+  unordered_map<PathId, size_t> counts;
+  for (auto& [source, headers] : headers_) {
+    for (PathId header : headers) {
+      counts[header]++;
+    }
+  }
+  PathTable& paths = PathTable::Global();
+  vector<pair<PathId, size_t>> most(counts.begin(), counts.end());
+  auto more_included = [&](const pair<PathId, size_t>& a,
+                           const pair<PathId, size_t>& b) {
+    if (a.second != b.second) {
+      return a.second > b.second;
+    }
+    return paths.Lookup(a.first) < paths.Lookup(b.first);
+  };
+  if (most.size() > n) {
+    partial_sort(most.begin(), most.begin() + n, most.end(), more_included);
+    most.resize(n);
+  } else {
+    sort(most.begin(), most.end(), more_included);
+  }
+  return most;
+}
+
+void parse_depfile(string_view contents, vector<string>* prerequisites) {
+  string word;
+  bool in_prerequisites = false;
+  auto end_word = [&]() {
+    if (!word.empty() && in_prerequisites) {
+      prerequisites->push_back(word);
+    }
+    word.clear();
+  };
+
+  size_t n = contents.size();
+  for (size_t i = 0; i < n; i++) {
+    char c = contents[i];
+    char next = i + 1 < n ? contents[i + 1] : '\0';
+    if (c == '\\' && (next == '\n' || next == '\r')) {
+      // A continuation; the rule goes on.
+      end_word();
+      i++;
+      if (next == '\r' && i + 1 < n && contents[i + 1] == '\n') {
+        i++;
+      }
+    } else if (c == '\\' && (next == ' ' || next == '#')) {
+      word += next;
+      i++;
+    } else if (c == '$' && next == '$') {
+      word += '$';
+      i++;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      end_word();
+    } else if (c == '\n') {
+      end_word();
+      in_prerequisites = false;
+    } else if (c == ':' && !in_prerequisites &&
+               (next == ' ' || next == '\t' || next == '\n' || next == '\r' ||
+                next == '\0')) {
+      // The targets end here. A colon followed by anything else, as in
+      // "C:\dir", is part of a file name.
+      word.clear();
+      in_prerequisites = true;
+    } else {
+      word += c;
+    }
+  }
+  end_word();
+}
+
+HeaderGraph read_depfiles(const CommandTable& commands, const string& root,
+                          int jobs, vector<string>* missing) {
+  PathTable& paths = PathTable::Global();
+
+  // Each distinct dependency file, and the compile rows that name it. The
+  // PIC and non-PIC compiles of libtool, for one, share a file. gcc writes
+  // relative prerequisites as seen from the directory it ran in, which is
+  // taken from the first row.
+  vector<PathId> depfiles;
+  vector<PathId> directories;
+  vector<vector<CommandTable::RowId>> rows_of;
+  unordered_map<PathId, size_t> index_of;
+  for (CommandTable::RowId row = 0; row < commands.size(); row++) {
+    if (commands.kind(row) != CommandKind::COMPILE ||
+        paths.Lookup(commands.depfile(row)).empty()) {
+      continue;
+    }
+    auto [it, is_new] =
+        index_of.emplace(commands.depfile(row), depfiles.size());
+    if (is_new) {
+      depfiles.push_back(commands.depfile(row));
+      directories.push_back(commands.directory(row));
+      rows_of.emplace_back();
+    }
+    rows_of[it->second].push_back(row);
+  }
+
+  // Read and parse them in parallel.
+  vector<vector<PathId>> prerequisites(depfiles.size());
+  vector<char> found(depfiles.size(), false);
+  parallel_for(depfiles.size(), jobs, [&](size_t i) {
+    vector<string> words;
+    string scratch, joined;
+    string_view directory = paths.Lookup(directories[i]);
+    for (const string& path :
+         depfile_candidates(paths.Lookup(depfiles[i]), root)) {
+      if (with_mapped_file(path, [&](string_view contents) {
+            parse_depfile(contents, &words);
+          })) {
+        found[i] = true;
+        break;
+      }
+    }
+    prerequisites[i].reserve(words.size());
+    for (const string& word : words) {
+      string_view path = word;
+      if (word[0] != '/' && directory != ".") {
+        joined.assign(directory);
+        joined.push_back('/');
+        joined.append(word);
+        path = joined;
+      }
+      prerequisites[i].push_back(paths.Intern(normalize_path(path, &scratch)));
+    }
+  });
+
+  // Everything a compile depends on but its own inputs is a header.
+  HeaderGraph graph;
+  vector<PathId> headers;
+  for (size_t i = 0; i < depfiles.size(); i++) {
+    if (!found[i]) {
+      missing->emplace_back(paths.Lookup(depfiles[i]));
+      continue;
+    }
+    for (CommandTable::RowId row : rows_of[i]) {
+      PathList inputs = commands.inputs(row);
+      headers.clear();
+      for (PathId prerequisite : prerequisites[i]) {
+        if (find(inputs.begin(), inputs.end(), prerequisite) == inputs.end()) {
+          headers.push_back(prerequisite);
+        }
+      }
+      for (PathId input : inputs) {
+        graph.Add(input, headers);
+      }
+    }
+  }
+  return graph;
+}
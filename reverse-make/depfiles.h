@@ -0,0 +1,92 @@
+#ifndef REVERSE_MAKE_DEPFILES_H__
+#define REVERSE_MAKE_DEPFILES_H__
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/paths.h"
+
+using namespace std;
+
+/**
+ * The headers that each compiled source depends on, as recorded in the
+ * dependency files gcc writes with -MD or -MMD and -MF.
+ */
+class HeaderGraph {
+ public:
+  /**
+   * Records that 'source' depends on each of 'headers'. Duplicates, of
+   * headers already recorded for 'source' or within 'headers', are dropped.
+   */
+  void Add(PathId source, const vector<PathId>& headers);
+
+  /**
+   * Returns the headers of 'source', in increasing order of ID, or nothing if
+   * no dependency file named any.
+   */
+  const vector<PathId>& headers(PathId source) const;
+
+  /**
+   * Returns the number of sources with at least one header.
+   */
+  size_t num_sources() const { return headers_.size(); }
+
+  /**
+   * Returns the number of (source, header) pairs.
+   */
+  size_t num_edges() const { return num_edges_; }
+
+  /**
+   * Returns the 'n' headers that the most sources depend on, with the number
+   * of sources for each, most first. Ties are ordered by path.
+   */
+  vector<pair<PathId, size_t>> MostIncluded(size_t n) const;
+
+ private:
+  unordered_map<PathId, vector<PathId>> headers_;
+  size_t num_edges_ = 0;
+};
+
+/**
+ * Parses the Make-syntax rules of a dependency file, as written by gcc -M,
+ * and returns the prerequisites of every rule, in order.
+ *
+ * Rules are continued across lines with a backslash-newline. In file names,
+ * "\ " and "\#" stand for a space and a '#', and "$$" for a '$'. Targets, the
+ * words before a rule's colon, are dropped, so the phony rules that -MP adds
+ * contribute nothing.
+ *
+ * @param contents The dependency file.
+ * @param prerequisites Receives the prerequisites. It is not cleared first.
+ */
+void parse_depfile(string_view contents, vector<string>* prerequisites);
+
+/**
+ * Reads the dependency file of every compile command in 'commands' that
+ * names one with -MF, and records each source's headers: the prerequisites
+ * other than the command's own inputs.
+ *
+ * Each distinct dependency file is read once, memory-mapped, with the files
+ * spread over 'jobs' threads. Relative paths are resolved against 'root',
+ * the directory the build ran in. Automake compiles to a ".Tpo" file and then
+ * renames it to ".Plo" or ".Po", so those are tried when the ".Tpo" is gone.
+ *
+ * @param commands The commands parsed from the build log.
+ * @param root The directory relative dependency file paths are resolved in.
+ * @param jobs The number of threads to read with.
+ * @param missing Receives the dependency files that couldn't be read.
+ *
+ * @return The headers of every source with a readable dependency file.
+ * Relative header paths are resolved against the directory their compile ran
+ * in, so that they are relative to the build root like the sources are;
+ * absolute ones are kept as written.
+ */
+HeaderGraph read_depfiles(const CommandTable& commands, const string& root,
+                          int jobs, vector<string>* missing);
+
+#endif  // REVERSE_MAKE_DEPFILES_H__
@@ -0,0 +1,102 @@
+#include "reverse-make/diagnostics.h"
+
+#include <algorithm>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+namespace {
+
+struct KindInfo {
+  // What the problem is, with "{}" for its token.
+  const char* message;
+  // What was done about it.
+  const char* action;
+};
+
+const KindInfo kKindInfo[kNumDiagnosticKinds] = {
+    {"Unhandled argument type: \"{}\"", "ignored"},
+    {"No argument after '{}'", "ignored"},
+    {"Unsupported gcc/g++ command type: {}", "command skipped"},
+    {"Unsupported form of ar command: ar {}", "command skipped"},
+    {"No compile command for dependency {}", "left out of its target"},
+    {"Compile command without a source: {}", "left out of its target"},
+    {"Compile command with several sources: {}", "first source used"},
+};
+
+}  // namespace
+
+void Diagnostics::Add(DiagnosticKind kind, string_view token) {
+  if (!has_first_) {
+    first_ = {kind, string(token)};
+    has_first_ = true;
+  }
+  Add(kind, token, 1, line_ == 0 ? vector<int>() : vector<int>{line_}, 0);
+}
+
+void Diagnostics::Merge(const Diagnostics& other, int line_offset) {
+  for (auto& [key, cause] : other.causes_) {
+    Add(key.first, key.second, cause.count, cause.lines, line_offset);
+  }
+  for (size_t i = 0; i < kNumDiagnosticKinds; i++) {
+    overflow_[i] += other.overflow_[i];
+    size_ += other.overflow_[i];
+  }
+}
+
+void Diagnostics::Add(DiagnosticKind kind, string_view token, size_t count,
+                      const vector<int>& lines, int line_offset) {
+  size_ += count;
+  auto it = causes_.find({kind, string(token)});
+  if (it == causes_.end()) {
+    if (causes_.size() == kMaxCauses) {
+      overflow_[size_t(kind)] += count;
+      return;
+    }
+    it = causes_.emplace(make_pair(kind, string(token)), Cause()).first;
+  }
+  Cause& cause = it->second;
+  cause.count += count;
+  for (size_t i = 0; i < lines.size() && cause.lines.size() < kMaxLines;
+       i++) {
+    cause.lines.push_back(lines[i] + line_offset);
+  }
+}
+
+string Diagnostics::Describe(DiagnosticKind kind, string_view token) {
+  return fmt::format(fmt::runtime(kKindInfo[size_t(kind)].message), token);
+}
+
+void Diagnostics::Print(FILE* out) const {
+  vector<pair<const pair<DiagnosticKind, string>*, const Cause*>> sorted;
+  for (auto& [key, cause] : causes_) {
+    sorted.emplace_back(&key, &cause);
+  }
+  stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a.second->count > b.second->count;
+  });
+
+  fmt::print(out, "{} problems with {} causes were worked around:\n", size_,
+             causes_.size());
+  for (auto& [key, cause] : sorted) {
+    const KindInfo& info = kKindInfo[size_t(key->first)];
+    string lines;
+    if (!cause->lines.empty()) {
+      lines = fmt::format(", first on line{} {}",
+                          cause->lines.size() == 1 ? "" : "s",
+                          fmt::join(cause->lines, ", "));
+    }
+    fmt::print(out, "  {:>6}x {} ({}){}\n", cause->count,
+               Describe(key->first, key->second), info.action, lines);
+  }
+  for (size_t i = 0; i < kNumDiagnosticKinds; i++) {
+    if (overflow_[i] > 0) {
+      const KindInfo& info = kKindInfo[i];
+      fmt::print(out, "  {:>6}x {} ({})\n", overflow_[i],
+                 fmt::format(fmt::runtime(info.message), "<other causes>"),
+                 info.action);
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#ifndef REVERSE_MAKE_DIAGNOSTICS_H__
+#define REVERSE_MAKE_DIAGNOSTICS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * The problems --keep-going works around, each with what is done about it.
+ */
+enum class DiagnosticKind : uint8_t {
+  UNHANDLED_OPTION,         // the option is ignored
+  MISSING_ARGUMENT,         // the option is ignored
+  UNSUPPORTED_GCC_COMMAND,  // gcc -S or -E; the command is skipped
+  UNSUPPORTED_AR_MODE,      // the command is skipped
+  MISSING_COMPILE_COMMAND,  // the dependency is left out of its target
+  COMPILE_WITHOUT_SOURCE,   // the dependency is left out of its target
+  COMPILE_WITH_SOURCES,     // only the first source is counted
+};
+constexpr size_t kNumDiagnosticKinds =
+    size_t(DiagnosticKind::COMPILE_WITH_SOURCES) + 1;
+
+/**
+ * Collects the problems found in a log instead of aborting on the first one.
+ *
+ * Problems are deduplicated by their cause, i.e. their kind and the token
+ * they are about, such as the unhandled option, and each cause keeps its
+ * count and the first few lines it was seen on. Memory is bounded: past
+ * kMaxCauses distinct causes, new ones are only counted by kind.
+ *
+ * A collector isn't safe to use from several threads; each thread collects
+ * its own, and they are merged in log order.
+ */
+class Diagnostics {
+ public:
+  static constexpr size_t kMaxCauses = 1000;
+  static constexpr size_t kMaxLines = 5;
+
+  /**
+   * Sets the line that Add() records problems on.
+   */
+  void SetLine(int line) { line_ = line; }
+
+  /**
+   * Records a problem about 'token' on the current line, or on no line in
+   * particular if the line is 0.
+   */
+  void Add(DiagnosticKind kind, string_view token);
+
+  /**
+   * Adds the problems of 'other', with their lines moved on by 'line_offset'.
+   */
+  void Merge(const Diagnostics& other, int line_offset);
+
+  /**
+   * Returns the number of problems recorded.
+   */
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  /**
+   * Returns the kind and token of the first problem recorded with Add(), or
+   * nullptr if there is none. Problems added by Merge() don't count.
+   */
+  const pair<DiagnosticKind, string>* first() const {
+    return has_first_ ? &first_ : nullptr;
+  }
+
+  /**
+   * Returns what a problem of 'kind' about 'token' is, as Print() puts it.
+   */
+  static string Describe(DiagnosticKind kind, string_view token);
+
+  /**
+   * Prints the causes, most frequent first, with their counts.
+   */
+  void Print(FILE* out) const;
+
+ private:
+  struct Cause {
+    size_t count = 0;
+    // The first lines the cause was seen on.
+    vector<int> lines;
+  };
+
+  void Add(DiagnosticKind kind, string_view token, size_t count,
+           const vector<int>& lines, int line_offset);
+
+  int line_ = 0;
+  size_t size_ = 0;
+  bool has_first_ = false;
+  pair<DiagnosticKind, string> first_;
+  map<pair<DiagnosticKind, string>, Cause> causes_;
+  // The problems whose causes didn't fit, by kind.
+  size_t overflow_[kNumDiagnosticKinds] = {};
+};
+
+#endif  // REVERSE_MAKE_DIAGNOSTICS_H__
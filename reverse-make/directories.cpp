@@ -0,0 +1,165 @@
+#include "reverse-make/directories.h"
+
+#include <cctype>
+
+#include "reverse-make/paths.h"
+#include "reverse-make/timings.h"
+
+namespace {
+
+/**
+ * Removes whitespace from both ends of 'str'.
+ */
+string_view trim(string_view str) {
+  while (!str.empty() && isspace(static_cast<unsigned char>(str.front()))) {
+    str.remove_prefix(1);
+  }
+  while (!str.empty() && isspace(static_cast<unsigned char>(str.back()))) {
+    str.remove_suffix(1);
+  }
+  return str;
+}
+
+/**
+ * Returns the parent of the normalized absolute path 'path'.
+ */
+string_view parent_directory(string_view path) {
+  size_t slash = path.rfind('/');
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+}  // namespace
+
+bool parse_directory_change(string_view line, DirectoryChange* change) {
+  constexpr string_view kEntering = ": Entering directory ";
+  constexpr string_view kLeaving = ": Leaving directory ";
+  size_t pos = line.find(kEntering);
+  change->entering = pos != string_view::npos;
+  if (!change->entering) {
+    pos = line.find(kLeaving);
+    if (pos == string_view::npos) {
+      return false;
+    }
+  }
+
+  // "make", "gmake" or "/usr/bin/make", with an optional "[level]".
+  string_view name = trim(line.substr(0, pos));
+  change->level = 0;
+  if (!name.empty() && name.back() == ']') {
+    size_t open = name.rfind('[');
+    if (open == string_view::npos || open + 2 == name.size()) {
+      return false;
+    }
+    for (char c : name.substr(open + 1, name.size() - open - 2)) {
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      change->level = change->level * 10 + (c - '0');
+    }
+    name = name.substr(0, open);
+  }
+  if (name.size() < 4 || name.substr(name.size() - 4) != "make" ||
+      name.find(' ') != string_view::npos) {
+    return false;
+  }
+
+  // The directory is quoted as '/dir', or as `/dir' by older makes.
+  string_view directory = trim(
+      line.substr(pos + (change->entering ? kEntering : kLeaving).size()));
+  if (!directory.empty() && (directory.front() == '\'' ||
+                             directory.front() == '`' ||
+                             directory.front() == '"')) {
+    directory.remove_prefix(1);
+  }
+  if (!directory.empty() &&
+      (directory.back() == '\'' || directory.back() == '"')) {
+    directory.remove_suffix(1);
+  }
+  if (directory.empty()) {
+    return false;
+  }
+  change->directory = directory;
+  return true;
+}
+
+void find_directory_changes(string_view chunk, bool timestamped,
+                            vector<DirectoryChange>* changes) {
+  size_t pos = 0;
+  while ((pos = chunk.find("ing directory ", pos)) != string_view::npos) {
+    size_t start = chunk.rfind('\n', pos);
+    start = start == string_view::npos ? 0 : start + 1;
+    size_t end = chunk.find('\n', pos);
+    if (end == string_view::npos) {
+      end = chunk.size();
+    }
+    string_view line = chunk.substr(start, end - start);
+    double ignored;
+    if (timestamped) {
+      strip_timestamp(&line, &ignored);
+    }
+    DirectoryChange change;
+    if (parse_directory_change(line, &change)) {
+      changes->push_back(change);
+    }
+    pos = end;
+  }
+}
+
+void DirectoryStack::Apply(const DirectoryChange& change) {
+  if (!change.entering) {
+    if (!stack_.empty()) {
+      stack_.pop_back();
+    }
+    return;
+  }
+  string scratch;
+  if (root_.empty() && change.directory[0] == '/') {
+    string_view directory = normalize_path(change.directory, &scratch);
+    string_view root = directory;
+    for (int i = 0; i < change.level && root != "/"; i++) {
+      root = parent_directory(root);
+    }
+    // Every path is under "/", so it would make a poor root.
+    if (root == "/") {
+      root = directory;
+    }
+    if (root != "/") {
+      root_ = string(root);
+    }
+  }
+  stack_.emplace_back(Resolve(change.directory, &scratch));
+}
+
+string_view DirectoryStack::Resolve(string_view path, string* scratch) const {
+  if (path.empty()) {
+    return path;
+  }
+  static thread_local string joined;
+  if (path[0] == '/') {
+    string_view normal = normalize_path(path, scratch);
+    if (root_.empty() || normal.substr(0, root_.size()) != root_) {
+      return normal;
+    }
+    if (normal.size() == root_.size()) {
+      return ".";
+    }
+    if (normal[root_.size()] != '/') {
+      return normal;
+    }
+    normal.remove_prefix(root_.size() + 1);
+    return normal;
+  }
+  string_view directory = current();
+  if (directory == ".") {
+    return normalize_path(path, scratch);
+  }
+  joined.assign(directory);
+  joined.push_back('/');
+  joined.append(path);
+  string_view normal = normalize_path(joined, scratch);
+  if (normal.data() == joined.data()) {
+    *scratch = joined;
+    return *scratch;
+  }
+  return normal;
+}
@@ -0,0 +1,99 @@
+#ifndef REVERSE_MAKE_DIRECTORIES_H__
+#define REVERSE_MAKE_DIRECTORIES_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A change of directory that make announced, with a line like
+ * "make[1]: Entering directory '/src/lib'".
+ */
+struct DirectoryChange {
+  // Entering the directory, or leaving it.
+  bool entering = false;
+  // How deep the make that changed directory was: 1 for "make[1]", 0 for a
+  // top-level "make".
+  int level = 0;
+  // The directory, without its quotes.
+  string_view directory;
+};
+
+/**
+ * Parses a line make prints when it enters or leaves a directory, as GNU make
+ * does for recursive makes, and with -w or -C.
+ *
+ * @param line A line of the build log.
+ * @param change Set to the change 'line' announces, pointing into 'line'.
+ *
+ * @return false if 'line' isn't such a line.
+ */
+bool parse_directory_change(string_view line, DirectoryChange* change);
+
+/**
+ * Finds every line of a chunk of the build log that announces a change of
+ * directory, in order.
+ *
+ * This is a quick scan for the phrase make uses, so that the directory each
+ * chunk starts in can be known before the chunks are parsed in parallel.
+ *
+ * @param chunk A chunk of the build log.
+ * @param timestamped If true, lines may start with a timestamp; see
+ * strip_timestamp().
+ * @param changes Receives the changes, pointing into 'chunk'.
+ */
+void find_directory_changes(string_view chunk, bool timestamped,
+                            vector<DirectoryChange>* changes);
+
+/**
+ * The directories a recursive make is in, and the canonical form of paths
+ * relative to them.
+ *
+ * The root is the directory the build ran in, which paths are made relative
+ * to. It is taken from the first directory entered: the directory itself for
+ * a top-level make, and its parent for make[1], which is how recursive makes
+ * are usually run ("$(MAKE) -C lib"), unless that is "/". Paths outside the
+ * root stay absolute. Until a directory is entered the root is unknown, and
+ * relative paths are taken to be relative to it.
+ */
+class DirectoryStack {
+ public:
+  /**
+   * Enters or leaves a directory.
+   */
+  void Apply(const DirectoryChange& change);
+
+  /**
+   * Returns the canonical form of 'path', as seen from the current
+   * directory: relative to the root if it is under it, and normalized; see
+   * normalize_path().
+   *
+   * @param path The path.
+   * @param scratch Holds the result if it differs from 'path'.
+   *
+   * @return 'path' itself, or a view of 'scratch'.
+   */
+  string_view Resolve(string_view path, string* scratch) const;
+
+  /**
+   * Returns the directory the build ran in, or "" if it isn't known.
+   */
+  const string& root() const { return root_; }
+
+  /**
+   * Returns the current directory, relative to the root if it is under it.
+   */
+  string_view current() const {
+    return stack_.empty() ? string_view(".") : string_view(stack_.back());
+  }
+
+ private:
+  string root_;
+  // The directories entered and not left yet, innermost last, each in
+  // canonical form.
+  vector<string> stack_;
+};
+
+#endif  // REVERSE_MAKE_DIRECTORIES_H__
@@ -0,0 +1,61 @@
+#include "reverse-make/files.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace {
+
+bool list_files_under(const string& root, const string& relative,
+                      const string& suffix, vector<string>* files) {
+  string dir = relative.empty() ? root : root + "/" + relative;
+  DIR* handle = opendir(dir.c_str());
+  if (handle == nullptr) {
+    return false;
+  }
+  bool ok = true;
+  while (dirent* entry = readdir(handle)) {
+    string name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+    string path = relative.empty() ? name : relative + "/" + name;
+    struct stat st;
+    if (stat((root + "/" + path).c_str(), &st) != 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      ok = list_files_under(root, path, suffix, files) && ok;
+    } else if (S_ISREG(st.st_mode) && name.size() >= suffix.size() &&
+               name.compare(name.size() - suffix.size(), suffix.size(),
+                            suffix) == 0) {
+      files->push_back(path);
+    }
+  }
+  closedir(handle);
+  return ok;
+}
+
+}  // namespace
+
+bool make_directories(const string& dir) {
+  for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+    string prefix = dir.substr(0, slash);
+    if (mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (slash == string::npos) {
+      return true;
+    }
+  }
+}
+
+bool list_files(const string& dir, const string& suffix,
+                vector<string>* files) {
+  size_t first = files->size();
+  bool ok = list_files_under(dir, "", suffix, files);
+  sort(files->begin() + first, files->end());
+  return ok;
+}
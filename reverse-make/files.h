@@ -0,0 +1,29 @@
+#ifndef REVERSE_MAKE_FILES_H__
+#define REVERSE_MAKE_FILES_H__
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Creates 'dir' and any of its parents that don't exist yet, like mkdir -p.
+ *
+ * @return false if a directory couldn't be created.
+ */
+bool make_directories(const string& dir);
+
+/**
+ * Finds every regular file under 'dir', recursively, whose name ends with
+ * 'suffix'.
+ *
+ * @param dir The directory to search.
+ * @param suffix The ending the files' names must have; empty for any.
+ * @param files Receives the files' paths relative to 'dir', sorted.
+ *
+ * @return false if 'dir' or one of its subdirectories couldn't be read.
+ */
+bool list_files(const string& dir, const string& suffix,
+                vector<string>* files);
+
+#endif  // REVERSE_MAKE_FILES_H__
@@ -0,0 +1,22 @@
+#include "reverse-make/flag_groups.h"
+
+void FlagGroups::Update(const CommandTable& commands) {
+  CommandTable::RowId row = groups_.size();
+  groups_.resize(commands.size(), kNoGroup);
+  for (; row < commands.size(); row++) {
+    if (commands.kind(row) != CommandKind::COMPILE) {
+      continue;
+    }
+    auto& candidates = firsts_[commands.FlagsFingerprint(row)];
+    for (CommandTable::RowId first : candidates) {
+      if (commands.FlagsMatch(first, row)) {
+        groups_[row] = groups_[first];
+        break;
+      }
+    }
+    if (groups_[row] == kNoGroup) {
+      groups_[row] = num_groups_++;
+      candidates.push_back(row);
+    }
+  }
+}
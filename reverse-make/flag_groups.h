@@ -0,0 +1,56 @@
+#ifndef REVERSE_MAKE_FLAG_GROUPS_H__
+#define REVERSE_MAKE_FLAG_GROUPS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+
+using namespace std;
+
+/**
+ * The partition of every compile command in a CommandTable into groups of
+ * commands whose flags match, as decided by CommandTable::FlagsMatch().
+ *
+ * It is built once for the whole table, so reporting on a target only has to
+ * look up the group of each of its inputs rather than compare flags again. As
+ * rows are added to the table, Update() extends it to cover them.
+ */
+class FlagGroups {
+ public:
+  using GroupId = uint32_t;
+  static constexpr GroupId kNoGroup = ~GroupId(0);
+
+  FlagGroups() {}
+  explicit FlagGroups(const CommandTable& commands) { Update(commands); }
+
+  /**
+   * Groups the rows of 'commands' that were added since the last update. The
+   * rows already grouped must not have changed, so the cost is proportional
+   * to the number of new rows.
+   */
+  void Update(const CommandTable& commands);
+
+  /**
+   * Returns the group of 'row', or kNoGroup if it isn't a compile command.
+   * Groups are numbered from 0 in order of their first row.
+   */
+  GroupId group(CommandTable::RowId row) const { return groups_[row]; }
+
+  /**
+   * Returns the number of groups.
+   */
+  size_t size() const { return num_groups_; }
+
+ private:
+  vector<GroupId> groups_;
+  size_t num_groups_ = 0;
+  // The first row of each group, by the fingerprint of its flags. Rows with
+  // the same fingerprint are checked with FlagsMatch() in case of a hash
+  // collision.
+  unordered_map<uint64_t, vector<CommandTable::RowId>> firsts_;
+};
+
+#endif  // REVERSE_MAKE_FLAG_GROUPS_H__
@@ -0,0 +1,37 @@
+#include "reverse-make/flags.h"
+
+#include <algorithm>
+
+FlagInterner& FlagInterner::Global() {
+  static FlagInterner interner;
+  return interner;
+}
+
+uint32_t FlagInterner::Intern(string_view flag) {
+  // Most lookups hit flags this thread has already seen, so keep a private
+  // cache in front of the shared table and only lock on a miss. Only the
+  // global interner exists, so the cache never mixes up two interners.
+  static thread_local unordered_map<string_view, uint32_t> cache;
+  if (auto it = cache.find(flag); it != cache.end()) {
+    return it->second;
+  }
+
+  uint32_t id = StringInterner::Intern(flag);
+  cache.emplace(Lookup(id), id);
+  return id;
+}
+
+void FlagSet::insert(string_view flag) {
+  insert(FlagInterner::Global().Intern(flag));
+}
+
+void FlagSet::insert(uint32_t id) {
+  auto it = lower_bound(ids_.begin(), ids_.end(), id);
+  if (it == ids_.end() || *it != id) {
+    ids_.insert(it, id);
+  }
+}
+
+void FlagList::push_back(string_view flag) {
+  ids_.push_back(FlagInterner::Global().Intern(flag));
+}
@@ -0,0 +1,196 @@
+#ifndef REVERSE_MAKE_FLAGS_H__
+#define REVERSE_MAKE_FLAGS_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "reverse-make/hash.h"
+#include "reverse-make/interner.h"
+
+using namespace std;
+
+/**
+ * Maps each distinct flag string to a dense integer ID.
+ *
+ * Real build logs repeat the same few hundred flags across every command, so
+ * each string is stored once here and commands only hold IDs.
+ */
+class FlagInterner : public StringInterner {
+ public:
+  /**
+   * Returns the interner shared by the whole program.
+   */
+  static FlagInterner& Global();
+
+  /**
+   * Like StringInterner::Intern(), but with a per-thread cache in front of the
+   * shared table, since nearly every flag has been seen before.
+   */
+  uint32_t Intern(string_view flag);
+};
+
+/**
+ * A set of flags, stored as the sorted IDs of their interned strings.
+ *
+ * Two FlagSets are equal exactly when they hold the same flags, and comparing
+ * them compares a few words rather than walking strings.
+ */
+class FlagSet {
+ public:
+  /**
+   * Adds 'flag' to the set, if it isn't already there.
+   */
+  void insert(string_view flag);
+  void insert(uint32_t id);
+
+  /**
+   * Removes every flag from the set.
+   */
+  void clear() { ids_.clear(); }
+
+  bool empty() const { return ids_.empty(); }
+  size_t size() const { return ids_.size(); }
+
+  /**
+   * The interned IDs of the flags in the set, in increasing order.
+   */
+  const vector<uint32_t>& ids() const { return ids_; }
+
+  bool operator==(const FlagSet& other) const { return ids_ == other.ids_; }
+  bool operator!=(const FlagSet& other) const { return ids_ != other.ids_; }
+
+ private:
+  vector<uint32_t> ids_;
+};
+
+/**
+ * The flags a command gave, stored as the IDs of their interned strings in
+ * command-line order, repeats included.
+ *
+ * FlagSet forgets the order, which is right for comparing commands but not for
+ * running them again: -I, -isystem, -D and -U all depend on it.
+ */
+class FlagList {
+ public:
+  /**
+   * Appends 'flag' to the list.
+   */
+  void push_back(string_view flag);
+  void push_back(uint32_t id) { ids_.push_back(id); }
+
+  /**
+   * Removes every flag from the list.
+   */
+  void clear() { ids_.clear(); }
+
+  bool empty() const { return ids_.empty(); }
+  size_t size() const { return ids_.size(); }
+
+  /**
+   * The interned IDs of the flags, in the order they were added.
+   */
+  const vector<uint32_t>& ids() const { return ids_; }
+
+  bool operator==(const FlagList& other) const { return ids_ == other.ids_; }
+  bool operator!=(const FlagList& other) const { return ids_ != other.ids_; }
+
+ private:
+  vector<uint32_t> ids_;
+};
+
+/**
+ * The ID of a FlagSet interned in a FlagSetTable. Two commands have equal
+ * flags in some category exactly when they have the same FlagSetId for it.
+ */
+using FlagSetId = uint32_t;
+
+/**
+ * The ID of a FlagList interned in a FlagListTable.
+ */
+using FlagListId = uint32_t;
+
+/**
+ * Maps each distinct FlagSet, or FlagList, to a dense ID, so that whole sets
+ * can be stored and compared as one word. The empty one is always ID 0. The
+ * table is safe to use from several threads at once; like StringInterner, it
+ * is split into independently locked shards, and Lookup() takes no lock.
+ */
+template <typename Flags>
+class FlagsTable {
+ public:
+  /**
+   * Returns the table shared by the whole program.
+   */
+  static FlagsTable& Global() {
+    static FlagsTable table;
+    return table;
+  }
+
+  FlagsTable() { Intern(Flags()); }
+
+  /**
+   * Returns the ID of 'flags', assigning it a new one if it hasn't been seen
+   * before.
+   */
+  uint32_t Intern(const Flags& flags) {
+    Shard& shard = shards_[Hash()(&flags) % kNumShards];
+    lock_guard<mutex> lock(shard.shard_mutex);
+    auto it = shard.ids.find(&flags);
+    if (it == shard.ids.end()) {
+      const Flags& stored = shard.sets.emplace_back(flags);
+      uint32_t id = size_.fetch_add(1, memory_order_acq_rel);
+      sets_.Set(id, &stored);
+      it = shard.ids.emplace(&stored, id).first;
+    }
+    return it->second;
+  }
+
+  /**
+   * Returns the flags with the given ID. The reference stays valid for the
+   * lifetime of the table.
+   */
+  const Flags& Lookup(uint32_t id) const { return *sets_[id]; }
+
+  /**
+   * Returns the number of distinct entries interned so far.
+   */
+  size_t size() const { return size_.load(memory_order_acquire); }
+
+ private:
+  struct Hash {
+    size_t operator()(const Flags* flags) const {
+      WordHash hash;
+      for (uint32_t id : flags->ids()) {
+        hash.Mix(id);
+      }
+      return hash.hash();
+    }
+  };
+  struct Equal {
+    bool operator()(const Flags* a, const Flags* b) const { return *a == *b; }
+  };
+
+  static constexpr size_t kNumShards = 16;
+
+  // The entries whose hashes fall in one shard.
+  struct alignas(64) Shard {
+    mutex shard_mutex;
+    deque<Flags> sets;
+    unordered_map<const Flags*, uint32_t, Hash, Equal> ids;
+  };
+
+  Shard shards_[kNumShards];
+  atomic<uint32_t> size_{0};
+  AppendOnlyArray<const Flags*> sets_;
+};
+
+using FlagSetTable = FlagsTable<FlagSet>;
+using FlagListTable = FlagsTable<FlagList>;
+
+#endif  // REVERSE_MAKE_FLAGS_H__
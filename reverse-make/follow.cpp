@@ -0,0 +1,301 @@
+#include "reverse-make/follow.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/parallel.h"
+#include "reverse-make/parse.h"
+#include "reverse-make/report.h"
+#include "reverse-make/signals.h"
+
+namespace {
+
+// How often a file is checked for new data when inotify isn't available.
+constexpr int kPollIntervalMs = 250;
+
+volatile sig_atomic_t summary_requested = 0;
+volatile sig_atomic_t stop_requested = 0;
+
+void request_summary(int) { summary_requested = 1; }
+void request_stop(int) { stop_requested = 1; }
+
+/**
+ * Prints the summary of everything parsed so far.
+ */
+void print_summary(const string& filename, int lines,
+                   const CommandTable& commands,
+                   const FlagGroups& flag_groups) {
+  fmt::print("==== {}: {} lines ====\n", filename, lines);
+  if (!commands.Count(CommandKind::LINK) && !commands.Count(CommandKind::AR)) {
+    // build_report() makes up a target, which mustn't stay in the table once
+    // real targets turn up, so it gets a copy.
+    CommandTable snapshot;
+    snapshot.Append(commands);
+    Report report = build_report(&snapshot);
+    print_report(snapshot, report);
+  } else {
+    print_report(commands, build_report(commands, flag_groups));
+  }
+  fflush(stdout);
+}
+
+}  // namespace
+
+LogFollower::LogFollower(int fd, bool owns_fd, bool is_file, int inotify_fd,
+                         size_t chunk_size)
+    : fd_(fd),
+      owns_fd_(owns_fd),
+      is_file_(is_file),
+      inotify_fd_(inotify_fd),
+      chunk_size_(chunk_size) {}
+
+LogFollower::~LogFollower() {
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  if (owns_fd_) {
+    close(fd_);
+  }
+}
+
+unique_ptr<LogFollower> LogFollower::Open(const string& filename,
+                                          size_t chunk_size) {
+  int fd = STDIN_FILENO;
+  bool owns_fd = false;
+  if (filename != "-") {
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return nullptr;
+    }
+    owns_fd = true;
+  }
+
+  struct stat st;
+  bool is_file = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  // Elsewhere than Linux, files are always polled.
+  int inotify_fd = -1;
+#ifdef __linux__
+  if (is_file && filename != "-") {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0 &&
+        inotify_add_watch(inotify_fd, filename.c_str(),
+                          IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE) < 0) {
+      // Fall back to polling.
+      close(inotify_fd);
+      inotify_fd = -1;
+    }
+  }
+#endif
+  return unique_ptr<LogFollower>(
+      new LogFollower(fd, owns_fd, is_file, inotify_fd, chunk_size));
+}
+
+LogFollower::Status LogFollower::Next(int timeout_ms, LogChunk* chunk) {
+  auto deadline =
+      chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+  while (true) {
+    bool full = ReadAvailable();
+    if (truncated_) {
+      truncated_ = false;
+      filled_ = 0;
+      scanned_ = 0;
+      offset_ = 0;
+      lseek(fd_, 0, SEEK_SET);
+      return Status::TRUNCATED;
+    }
+
+    size_t boundary =
+        rfind_line_end(string_view(buffer_.data(), filled_), scanned_);
+    if (boundary != string_view::npos && boundary > 0) {
+      Emit(boundary, chunk);
+      return Status::DATA;
+    }
+    scanned_ = filled_;
+    if (eof_) {
+      if (filled_ == 0) {
+        return Status::END;
+      }
+      // The last line has no newline.
+      Emit(filled_, chunk);
+      return Status::DATA;
+    }
+    if (full) {
+      // The pending logical line is longer than a chunk; keep reading.
+      continue;
+    }
+
+    auto remaining = chrono::duration_cast<chrono::milliseconds>(
+        deadline - chrono::steady_clock::now());
+    if (remaining.count() <= 0 || !Wait(remaining.count())) {
+      return Status::TIMEOUT;
+    }
+  }
+}
+
+bool LogFollower::ReadAvailable() {
+  size_t limit = filled_ + chunk_size_;
+  if (buffer_.size() < limit) {
+    buffer_.resize(limit);
+  }
+  while (filled_ < limit) {
+    if (!is_file_) {
+      // Don't block on a pipe that has nothing for us yet.
+      struct pollfd pfd = {fd_, POLLIN, 0};
+      if (poll(&pfd, 1, 0) <= 0) {
+        return false;
+      }
+    }
+    ssize_t n = read(fd_, buffer_.data() + filled_, limit - filled_);
+    if (n > 0) {
+      filled_ += n;
+      offset_ += n;
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    // The end, for now if this is a file.
+    if (!is_file_) {
+      eof_ = true;
+    } else {
+      struct stat st;
+      if (fstat(fd_, &st) == 0 && uint64_t(st.st_size) < offset_) {
+        truncated_ = true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool LogFollower::Wait(int timeout_ms) {
+  int ready;
+  if (!is_file_) {
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    ready = poll(&pfd, 1, timeout_ms);
+  } else if (inotify_fd_ >= 0) {
+    struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    ready = poll(&pfd, 1, timeout_ms);
+    if (ready > 0) {
+      // The events only say that the file changed; drain them.
+      char events[4096];
+      while (read(inotify_fd_, events, sizeof(events)) > 0) {
+      }
+    }
+  } else {
+    ready = poll(nullptr, 0, min(timeout_ms, kPollIntervalMs));
+  }
+  return ready >= 0 || errno != EINTR;
+}
+
+void LogFollower::Emit(size_t boundary, LogChunk* chunk) {
+  chunk->storage.assign(buffer_.data(), buffer_.data() + boundary);
+  memmove(buffer_.data(), buffer_.data() + boundary, filled_ - boundary);
+  filled_ -= boundary;
+  scanned_ = 0;
+  chunk->data = string_view(chunk->storage.data(), boundary);
+}
+
+int follow_log(const string& filename, int jobs, int interval_s) {
+  auto follower = LogFollower::Open(filename);
+  if (!follower) {
+    fmt::print(stderr, "Unable to open file: {}\n", filename);
+    return 1;
+  }
+  install_handler(SIGUSR1, request_summary);
+  install_handler(SIGINT, request_stop);
+  install_handler(SIGTERM, request_stop);
+
+  CommandTable commands;
+  FlagGroups flag_groups;
+  vector<SkippedCommand> skipped_commands;
+  int line = 1;
+
+  vector<LogChunk> chunks(max(jobs, 1) * 4);
+  vector<ParsedChunk> parsed_chunks(chunks.size());
+  // The directories make is in where the log has been read up to.
+  DirectoryStack directories;
+  vector<DirectoryStack> starts;
+  ThreadPool pool(jobs);
+  auto interval = chrono::seconds(interval_s);
+  auto last_summary = chrono::steady_clock::now();
+  bool changed = false;
+  bool done = false;
+  while (!done && !stop_requested) {
+    // Wake up at least once a second, in case a signal arrived just before
+    // the wait started.
+    int timeout_ms = 1000;
+    if (interval_s > 0 && changed) {
+      auto until = chrono::duration_cast<chrono::milliseconds>(
+          last_summary + interval - chrono::steady_clock::now());
+      timeout_ms = max<int>(0, min<int>(timeout_ms, until.count()));
+    }
+
+    // Take the first chunk as it comes, and then whatever else is ready.
+    size_t n = 0;
+    LogFollower::Status status = follower->Next(timeout_ms, &chunks[0]);
+    while (status == LogFollower::Status::DATA) {
+      n++;
+      if (n == chunks.size()) {
+        break;
+      }
+      status = follower->Next(0, &chunks[n]);
+    }
+
+    // Parse the new lines only, and bring the flag groups up to date.
+    if (n > 0) {
+      chunk_directories(chunks.data(), n, &pool, false, &directories,
+                        &starts);
+      parallel_for(n, &pool, [&](size_t i) {
+        parsed_chunks[i] = parse_chunk(chunks[i].data, ParseOptions(),
+                                       starts[i]);
+      });
+      for (size_t i = 0; i < n; i++) {
+        merge_chunk(&parsed_chunks[i], &line, &commands, &skipped_commands);
+      }
+      flag_groups.Update(commands);
+      changed = true;
+    }
+
+    if (status == LogFollower::Status::TRUNCATED) {
+      fmt::print(stderr, "{} was truncated; starting over.\n", filename);
+      commands = CommandTable();
+      flag_groups = FlagGroups();
+      skipped_commands.clear();
+      directories = DirectoryStack();
+      line = 1;
+      changed = true;
+    } else if (status == LogFollower::Status::END) {
+      done = true;
+    }
+
+    auto now = chrono::steady_clock::now();
+    if (summary_requested ||
+        (interval_s > 0 && changed && now - last_summary >= interval)) {
+      summary_requested = 0;
+      print_summary(filename, line - 1, commands, flag_groups);
+      last_summary = now;
+      changed = false;
+    }
+  }
+
+  print_summary(filename, line - 1, commands, flag_groups);
+  return 0;
+}
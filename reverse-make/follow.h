@@ -0,0 +1,97 @@
+#ifndef REVERSE_MAKE_FOLLOW_H__
+#define REVERSE_MAKE_FOLLOW_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "reverse-make/log_reader.h"
+
+using namespace std;
+
+/**
+ * Reads a build log that is still being written, handing out the logical
+ * lines that have been completed since the last call.
+ *
+ * A regular file is read from where the last read stopped, and never ends; it
+ * is watched with inotify on Linux, and polled elsewhere or where inotify
+ * fails. A pipe (e.g. stdin) ends when its writer closes it. Only complete
+ * logical lines are handed out, so a line that is still being written, or one
+ * that ends with an escaped newline, is held back until the rest of it
+ * arrives.
+ */
+class LogFollower {
+ public:
+  enum class Status {
+    DATA,       // the chunk holds new lines
+    TIMEOUT,    // nothing new arrived in time, or a signal arrived
+    TRUNCATED,  // the file shrank; it will be read again from the start
+    END,        // the pipe was closed, and all of it has been handed out
+  };
+
+  /**
+   * Opens the given file for following. The filename "-" means stdin.
+   *
+   * @return The follower, or nullptr if the file can't be opened.
+   */
+  static unique_ptr<LogFollower> Open(
+      const string& filename, size_t chunk_size = LogSource::kDefaultChunkSize);
+
+  ~LogFollower();
+
+  /**
+   * Waits up to 'timeout_ms' for new lines and hands them out. Returns early,
+   * with TIMEOUT, if a signal interrupts the wait.
+   *
+   * @param timeout_ms How long to wait; 0 only takes what is already there.
+   * @param chunk Receives the new lines when DATA is returned. It stays valid
+   * until it is passed to Next() again.
+   */
+  Status Next(int timeout_ms, LogChunk* chunk);
+
+ private:
+  LogFollower(int fd, bool owns_fd, bool is_file, int inotify_fd,
+              size_t chunk_size);
+
+  // Reads what is available without blocking, up to a chunk's worth. Returns
+  // true if it stopped because it read that much.
+  bool ReadAvailable();
+
+  // Blocks until there may be more to read, or for up to 'timeout_ms'.
+  // Returns false if a signal interrupted it.
+  bool Wait(int timeout_ms);
+
+  // Hands buffer_[0, boundary) to 'chunk', keeping the rest.
+  void Emit(size_t boundary, LogChunk* chunk);
+
+  int fd_;
+  bool owns_fd_;
+  bool is_file_;
+  int inotify_fd_;
+  size_t chunk_size_;
+  vector<char> buffer_;
+  size_t filled_ = 0;
+  // Everything in buffer_ before 'scanned_' is known not to hold a line end.
+  size_t scanned_ = 0;
+  // How far into the file we have read.
+  uint64_t offset_ = 0;
+  bool eof_ = false;
+  bool truncated_ = false;
+};
+
+/**
+ * Follows a growing build log, parsing only the lines appended to it, and
+ * keeps its commands and flag groups up to date as they arrive. The summary
+ * is printed when SIGUSR1 is received, every 'interval_s' seconds if there
+ * is anything new, and once more at the end: when a followed pipe is closed,
+ * or on SIGINT or SIGTERM.
+ *
+ * @param filename The build log, or "-" for stdin.
+ * @param jobs The number of threads to parse with.
+ * @param interval_s How often to print the summary; 0 for only on SIGUSR1.
+ *
+ * @return The exit code for main().
+ */
+int follow_log(const string& filename, int jobs, int interval_s);
+
+#endif  // REVERSE_MAKE_FOLLOW_H__
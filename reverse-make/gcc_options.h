@@ -0,0 +1,345 @@
+#ifndef REVERSE_MAKE_GCC_OPTIONS_H__
+#define REVERSE_MAKE_GCC_OPTIONS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * What process_gcc_command does with an option.
+ */
+enum class GccOptionKind : uint8_t {
+  COMPILE,              // -c
+  COMPILE_NO_ASSEMBLE,  // -S
+  PREPROCESS_ONLY,      // -E
+  DEFINE,
+  INCLUDE,
+  CFLAG,
+  WARN,
+  TARGET_OPT,
+  OPTIMIZATION,
+  DEBUG_INFO,
+  LINK_SEARCH_DIR,
+  LINKOPT,
+  LINK_LIB,
+  OUTPUT,
+  DEPFILE,  // -MF
+  IGNORED,
+  UNHANDLED,
+};
+
+/**
+ * How an option relates to the argument that follows it.
+ */
+enum class GccOptionArity : uint8_t {
+  NONE,         // the option stands alone
+  JOINED_NEXT,  // recorded together with the next argument, e.g. "-Xlinker x"
+  NEXT,         // the next argument is the option's value, e.g. "-o out"
+  SKIP_NEXT,    // the next argument is dropped along with the option
+};
+
+/**
+ * One entry of the option table. A prefix entry matches any argument starting
+ * with 'name'; other entries match 'name' exactly.
+ */
+struct GccOption {
+  string_view name;
+  bool is_prefix;
+  GccOptionKind kind;
+  GccOptionArity arity;
+};
+
+/**
+ * Every gcc/g++ option process_gcc_command knows about.
+ *
+ * When several entries match an argument, the one that comes first wins, so
+ * more specific prefixes ("-fuse") must come before more general ones ("-f").
+ * Arguments that match nothing are inputs.
+ */
+// clang-format off
+inline constexpr GccOption kGccOptions[] = {
+    // note I'm completely ignoring "GCC Developer Options"
+    {"-c", false, GccOptionKind::COMPILE, GccOptionArity::NONE},
+    {"-S", false, GccOptionKind::COMPILE_NO_ASSEMBLE, GccOptionArity::NONE},
+    // TODO check other flags (go through the man page...)
+    {"-E", false, GccOptionKind::PREPROCESS_ONLY, GccOptionArity::NONE},
+    // but we *should* handle these! just need some examples...
+    {"-D", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-D", true, GccOptionKind::DEFINE, GccOptionArity::NONE},
+    {"-U", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-U", true, GccOptionKind::DEFINE, GccOptionArity::NONE},
+    // includes (does this actually work? we tend to recreate these anyway...)
+    {"-I", true, GccOptionKind::INCLUDE, GccOptionArity::NONE},
+    // "-isystem dir" is recorded as one include, "-isystemdir" as another.
+    {"-iquote", false, GccOptionKind::INCLUDE, GccOptionArity::JOINED_NEXT},
+    {"-iquote", true, GccOptionKind::INCLUDE, GccOptionArity::NONE},
+    {"-isystem", false, GccOptionKind::INCLUDE, GccOptionArity::JOINED_NEXT},
+    {"-isystem", true, GccOptionKind::INCLUDE, GccOptionArity::NONE},
+    {"-idirafter", false, GccOptionKind::INCLUDE, GccOptionArity::JOINED_NEXT},
+    {"-idirafter", true, GccOptionKind::INCLUDE, GccOptionArity::NONE},
+    {"-fuse", true, GccOptionKind::LINKOPT, GccOptionArity::JOINED_NEXT},
+    {"-f", true, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-p", false, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-pg", false, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"--coverage", false, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-undef", false, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-W", true, GccOptionKind::WARN, GccOptionArity::NONE},
+    {"-w", false, GccOptionKind::WARN, GccOptionArity::NONE},
+    {"-pedantic", false, GccOptionKind::WARN, GccOptionArity::NONE},
+    {"-pedantic-errors", false, GccOptionKind::WARN, GccOptionArity::NONE},
+    {"-m", true, GccOptionKind::TARGET_OPT, GccOptionArity::NONE},
+    {"-O", true, GccOptionKind::OPTIMIZATION, GccOptionArity::NONE},
+    {"-L", true, GccOptionKind::LINK_SEARCH_DIR, GccOptionArity::NONE},
+    {"-lobj", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-nodefaultlibs", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-nolibc", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-nostdlib", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-pie", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-no-pie", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-static-pie", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-pthread", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-r", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-rdynamic", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-s", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-shared", true, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-static", true, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-symbolic", false, GccOptionKind::LINKOPT, GccOptionArity::NONE},
+    {"-Xlinker", false, GccOptionKind::LINKOPT, GccOptionArity::JOINED_NEXT},
+    {"-l", false, GccOptionKind::LINKOPT, GccOptionArity::JOINED_NEXT},
+    // Note that we're losing positional information. According to the gcc man
+    // file:
+    // "It makes a difference where in the command you write this option;
+    // the linker searches and processes libraries and object files in the
+    // order they are specified."
+    // Unclear to me how much of a problem this is in practice.
+    {"-l", true, GccOptionKind::LINK_LIB, GccOptionArity::NONE},
+    {"-std", true, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-ansi", false, GccOptionKind::CFLAG, GccOptionArity::NONE},
+    {"-g", true, GccOptionKind::DEBUG_INFO, GccOptionArity::NONE},
+    // also skip the target, unless it is joined on
+    {"-MT", false, GccOptionKind::IGNORED, GccOptionArity::SKIP_NEXT},
+    {"-MT", true, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"-MQ", false, GccOptionKind::IGNORED, GccOptionArity::SKIP_NEXT},
+    {"-MQ", true, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"-MF", false, GccOptionKind::DEPFILE, GccOptionArity::NEXT},
+    {"-MF", true, GccOptionKind::DEPFILE, GccOptionArity::NONE},
+    // skip the other dependency generation rules
+    {"-M", true, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"-v", false, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"-###", false, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"-pipe", false, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    // The unhandled options below that take their argument separately skip
+    // it, so that it isn't taken for an input when they are worked around.
+    {"-x", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-x", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--version", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-pass-exit-codes", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--help", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--target-help", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-specs", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-wrapper", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"@", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-aux-info", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-gen-decls", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-print-objc-runtime-info", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--param", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-include", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-imacros", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-A", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-C", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-CC", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-P", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-traditional", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-traditional-cpp", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-trigraphs", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-remap", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-H", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-d", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-Xpreprocessor", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-no-integrated-cpp", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-Xassembler", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-T", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-e", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"--entry", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"--entry", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-u", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-z", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-I-", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-iprefix", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-iwithprefix", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-iwithprefixbefore", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-isysroot", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-imultilib", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-nostdinc", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-nostdinc++", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-iplugindir", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-B", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"-B", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-no-canonical-prefixes", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--sysroot", false, GccOptionKind::UNHANDLED, GccOptionArity::SKIP_NEXT},
+    {"--sysroot", true, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"--no-sysroot-suffix", false, GccOptionKind::UNHANDLED, GccOptionArity::NONE},
+    {"-o", false, GccOptionKind::OUTPUT, GccOptionArity::NEXT},
+    // ignore output redirect
+    {">", true, GccOptionKind::IGNORED, GccOptionArity::NONE},
+    {"2>&1", false, GccOptionKind::IGNORED, GccOptionArity::NONE},
+};
+// clang-format on
+
+inline constexpr size_t kNumGccOptions = size(kGccOptions);
+
+/**
+ * Lookup structures for kGccOptions, built at compile time:
+ * - a perfect hash of the exact options, so an exact match costs one hash of
+ * the argument and one string compare;
+ * - a trie of the prefix options, walked one character of the argument at a
+ * time.
+ * Either way classifying an argument is linear in its length, no matter how
+ * many options the table holds.
+ */
+class GccOptionTable {
+ public:
+  static constexpr uint8_t kNone = 0xff;
+  static constexpr size_t kHashSlots = 1024;
+  static constexpr size_t kMaxTrieNodes = 128;
+  // The trie only branches on printable ASCII characters.
+  static constexpr char kFirstTrieChar = ' ';
+  static constexpr size_t kTrieFanout = 96;
+
+  static_assert(kNumGccOptions < kNone, "option indices must fit in a byte");
+
+  constexpr GccOptionTable() {
+    for (auto& slot : hash_slots_) {
+      slot = kNone;
+    }
+    for (auto& node : trie_) {
+      node.prefix_option = kNone;
+      for (auto& child : node.children) {
+        child = 0;
+      }
+    }
+
+    // Find a seed that gives every exact option its own slot.
+    for (seed_ = 0;; seed_++) {
+      bool collision = false;
+      for (size_t i = 0; i < kNumGccOptions && !collision; i++) {
+        if (kGccOptions[i].is_prefix) {
+          continue;
+        }
+        uint8_t& slot = hash_slots_[Slot(kGccOptions[i].name)];
+        if (slot != kNone) {
+          collision = true;
+        } else {
+          slot = i;
+        }
+      }
+      if (!collision) {
+        break;
+      }
+      for (auto& slot : hash_slots_) {
+        slot = kNone;
+      }
+    }
+
+    // Node 0 is the root, so 0 doubles as "no child".
+    size_t num_nodes = 1;
+    for (size_t i = 0; i < kNumGccOptions; i++) {
+      if (!kGccOptions[i].is_prefix) {
+        continue;
+      }
+      size_t node = 0;
+      for (char c : kGccOptions[i].name) {
+        uint8_t& child = trie_[node].children[c - kFirstTrieChar];
+        if (child == 0) {
+          child = num_nodes++;
+        }
+        node = child;
+      }
+      if (trie_[node].prefix_option == kNone) {
+        trie_[node].prefix_option = i;
+      }
+    }
+    num_trie_nodes_ = num_nodes;
+  }
+
+  /**
+   * Returns the option that 'arg' is an instance of, or nullptr if it isn't
+   * an option at all.
+   */
+  constexpr const GccOption* Classify(string_view arg) const {
+    size_t best = kNone;
+
+    uint8_t exact = hash_slots_[Slot(arg)];
+    if (exact != kNone && kGccOptions[exact].name == arg) {
+      best = exact;
+    }
+
+    size_t node = 0;
+    for (char c : arg) {
+      if (c < kFirstTrieChar || size_t(c - kFirstTrieChar) >= kTrieFanout) {
+        break;
+      }
+      node = trie_[node].children[c - kFirstTrieChar];
+      if (node == 0) {
+        break;
+      }
+      if (trie_[node].prefix_option < best) {
+        best = trie_[node].prefix_option;
+      }
+    }
+
+    return best == kNone ? nullptr : &kGccOptions[best];
+  }
+
+  constexpr size_t num_trie_nodes() const { return num_trie_nodes_; }
+
+ private:
+  struct TrieNode {
+    // The first prefix option ending at this node, or kNone.
+    uint8_t prefix_option;
+    uint8_t children[kTrieFanout];
+  };
+
+  constexpr size_t Slot(string_view str) const {
+    // 32-bit FNV-1a, seeded.
+    uint32_t hash = 2166136261u ^ seed_;
+    for (char c : str) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return (hash ^ (hash >> 15)) & (kHashSlots - 1);
+  }
+
+  uint32_t seed_ = 0;
+  uint8_t hash_slots_[kHashSlots] = {};
+  TrieNode trie_[kMaxTrieNodes] = {};
+  size_t num_trie_nodes_ = 0;
+};
+
+inline constexpr GccOptionTable kGccOptionTable;
+
+static_assert(kGccOptionTable.num_trie_nodes() <=
+                  GccOptionTable::kMaxTrieNodes,
+              "too many prefix options for the trie");
+static_assert(kGccOptionTable.Classify("-fuse-ld=gold")->name == "-fuse",
+              "more specific prefixes must win");
+static_assert(kGccOptionTable.Classify("-I-")->kind == GccOptionKind::INCLUDE,
+              "earlier prefixes must win over later exact options");
+static_assert(kGccOptionTable.Classify("-isystem")->arity ==
+                      GccOptionArity::JOINED_NEXT &&
+                  kGccOptionTable.Classify("-isystemdir")->arity ==
+                      GccOptionArity::NONE,
+              "exact options must come before the prefixes they start");
+static_assert(kGccOptionTable.Classify("foo.c") == nullptr,
+              "inputs aren't options");
+
+/**
+ * Returns the option that 'arg' is an instance of, or nullptr if it is an
+ * input rather than an option.
+ */
+inline const GccOption* classify_gcc_option(string_view arg) {
+  return kGccOptionTable.Classify(arg);
+}
+
+#endif  // REVERSE_MAKE_GCC_OPTIONS_H__
@@ -0,0 +1,109 @@
+#include "reverse-make/hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9ull;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ull;
+constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5ull;
+
+uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t read64(const unsigned char* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t read32(const unsigned char* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t xxh_round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+uint64_t merge_round(uint64_t hash, uint64_t acc) {
+  hash ^= xxh_round(0, acc);
+  return hash * kPrime1 + kPrime4;
+}
+
+}  // namespace
+
+ContentHash::ContentHash(uint64_t seed)
+    : acc_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1},
+      seed_(seed) {}
+
+void ContentHash::Update(string_view data) {
+  auto p = reinterpret_cast<const unsigned char*>(data.data());
+  const unsigned char* end = p + data.size();
+  length_ += data.size();
+
+  if (buffered_ > 0) {
+    size_t n = min(sizeof(buffer_) - buffered_, data.size());
+    memcpy(buffer_ + buffered_, p, n);
+    buffered_ += n;
+    p += n;
+    if (buffered_ < sizeof(buffer_)) {
+      return;
+    }
+    for (int lane = 0; lane < 4; lane++) {
+      acc_[lane] = xxh_round(acc_[lane], read64(buffer_ + lane * 8));
+    }
+    buffered_ = 0;
+  }
+
+  for (; end - p >= 32; p += 32) {
+    acc_[0] = xxh_round(acc_[0], read64(p));
+    acc_[1] = xxh_round(acc_[1], read64(p + 8));
+    acc_[2] = xxh_round(acc_[2], read64(p + 16));
+    acc_[3] = xxh_round(acc_[3], read64(p + 24));
+  }
+  memcpy(buffer_, p, end - p);
+  buffered_ = end - p;
+}
+
+uint64_t ContentHash::Finish() const {
+  uint64_t hash;
+  if (length_ >= 32) {
+    hash = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) +
+           rotl(acc_[3], 18);
+    for (uint64_t acc : acc_) {
+      hash = merge_round(hash, acc);
+    }
+  } else {
+    hash = seed_ + kPrime5;
+  }
+  hash += length_;
+
+  const unsigned char* p = buffer_;
+  const unsigned char* end = buffer_ + buffered_;
+  for (; end - p >= 8; p += 8) {
+    hash ^= xxh_round(0, read64(p));
+    hash = rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (end - p >= 4) {
+    hash ^= uint64_t(read32(p)) * kPrime1;
+    hash = rotl(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * kPrime5;
+    hash = rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,51 @@
+#ifndef REVERSE_MAKE_HASH_H__
+#define REVERSE_MAKE_HASH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Computes a 64-bit hash of a byte stream that is fed in pieces, using the
+ * XXH64 algorithm. The result doesn't depend on how the stream is split up.
+ */
+class ContentHash {
+ public:
+  explicit ContentHash(uint64_t seed = 0);
+
+  /**
+   * Hashes the next piece of the stream.
+   */
+  void Update(string_view data);
+
+  /**
+   * Returns the hash of everything passed to Update() so far.
+   */
+  uint64_t Finish() const;
+
+ private:
+  uint64_t acc_[4];
+  uint64_t seed_;
+  uint64_t length_ = 0;
+  // The start of a 32-byte stripe that Update() hasn't seen the end of.
+  unsigned char buffer_[32];
+  size_t buffered_ = 0;
+};
+
+/**
+ * Computes the 64-bit FNV-1a hash of a sequence of words, such as the IDs a
+ * hash table is keyed by. Each word is mixed in whole, not byte by byte.
+ */
+class WordHash {
+ public:
+  void Mix(uint64_t word) { hash_ = (hash_ ^ word) * 1099511628211ull; }
+
+  uint64_t hash() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 14695981039346656037ull;
+};
+
+#endif  // REVERSE_MAKE_HASH_H__
@@ -0,0 +1,505 @@
+#include "reverse-make/index.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "reverse-make/hash.h"
+#include "reverse-make/log_reader.h"
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'R', 'M', 'I', 'D', 'X', '\n', '\0', '\0'};
+// Bump this whenever the layout, or what parsing makes of a log, changes;
+// older indexes are then rebuilt.
+constexpr uint32_t kIndexVersion = 6;
+
+// The sections of an index, in file order.
+enum IndexSection {
+  PATH_OFFSETS,      // uint64_t per path, plus one: where each path starts
+  PATH_DATA,         // the paths, back to back
+  FLAG_OFFSETS,      // uint64_t per flag, plus one
+  FLAG_DATA,         // the flags, back to back
+  FLAG_SET_OFFSETS,  // uint64_t per flag set, plus one, into FLAG_SET_FLAGS
+  FLAG_SET_FLAGS,    // uint32_t flag IDs of each set
+  FLAG_LIST_OFFSETS,  // uint64_t per flag list, plus one, into FLAG_LIST_FLAGS
+  FLAG_LIST_FLAGS,    // uint32_t flag IDs of each list, in order
+  ROW_KINDS,         // CommandKind per row
+  ROW_COMPILERS,     // uint8_t GccCommand::Compiler per row
+  ROW_COMMANDS,      // uint8_t GccCommand::Command per row
+  ROW_DIRECTORIES,   // PathId per row
+  ROW_OUTPUTS,       // PathId per row
+  ROW_DEPFILES,      // PathId per row
+  ROW_INPUT_COUNTS,  // uint32_t per row
+  ROW_FLAG_SETS,     // FlagSetId per row, for each FlagField in turn
+  ROW_FLAG_LISTS,    // FlagListId per row
+  INPUTS,            // PathId per input, row after row
+  SKIPPED_LINES,     // int64_t line number per skipped command
+  SKIPPED_OFFSETS,   // uint64_t per skipped command, plus one
+  SKIPPED_DATA,      // the skipped commands' names, back to back
+  kNumIndexSections
+};
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_sections;
+  uint64_t log_size;
+  int64_t log_mtime_ns;
+  uint64_t log_hash;
+  struct {
+    uint64_t offset;
+    uint64_t size;
+  } sections[kNumIndexSections];
+};
+
+/**
+ * Appends sections to an index file. Each section starts on an 8-byte
+ * boundary, so that a reader can use it in place.
+ */
+class IndexWriter {
+ public:
+  explicit IndexWriter(FILE* file) : file_(file) {
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic, kIndexMagic, sizeof(kIndexMagic));
+    header_.version = kIndexVersion;
+    header_.num_sections = kNumIndexSections;
+    Write(&header_, sizeof(header_));
+  }
+
+  template <typename T>
+  void Section(IndexSection section, const vector<T>& data) {
+    header_.sections[section].offset = pos_;
+    header_.sections[section].size = data.size() * sizeof(T);
+    Write(data.data(), data.size() * sizeof(T));
+    static const char kPadding[8] = {};
+    Write(kPadding, (8 - pos_ % 8) % 8);
+  }
+
+  // Strings are written as an offsets section and a data section.
+  void Strings(IndexSection offsets_section, IndexSection data_section,
+               const vector<string_view>& strings) {
+    vector<uint64_t> offsets = {0};
+    vector<char> data;
+    for (string_view str : strings) {
+      data.insert(data.end(), str.begin(), str.end());
+      offsets.push_back(data.size());
+    }
+    Section(offsets_section, offsets);
+    Section(data_section, data);
+  }
+
+  // Fills in the header, now that every section has been written.
+  bool Finish(const LogIdentity& log) {
+    header_.log_size = log.size;
+    header_.log_mtime_ns = log.mtime_ns;
+    header_.log_hash = log.content_hash;
+    if (fseek(file_, 0, SEEK_SET) != 0) {
+      return false;
+    }
+    Write(&header_, sizeof(header_));
+    return ok_ && fflush(file_) == 0;
+  }
+
+ private:
+  void Write(const void* data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, file_) != size) {
+      ok_ = false;
+    }
+    pos_ += size;
+  }
+
+  FILE* file_;
+  IndexHeader header_;
+  uint64_t pos_ = 0;
+  bool ok_ = true;
+};
+
+/**
+ * Reads the sections of a mapped index file, checking that each lies within
+ * the file.
+ */
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  // Returns false if the file doesn't start with a header this version wrote.
+  bool ReadHeader() {
+    if (size_ < sizeof(header_)) {
+      return false;
+    }
+    memcpy(&header_, data_, sizeof(header_));
+    return memcmp(header_.magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+           header_.version == kIndexVersion &&
+           header_.num_sections == kNumIndexSections;
+  }
+
+  const IndexHeader& header() const { return header_; }
+
+  template <typename T>
+  bool Section(IndexSection section, const T** data, size_t* count) const {
+    uint64_t offset = header_.sections[section].offset;
+    uint64_t size = header_.sections[section].size;
+    if (offset > size_ || size > size_ - offset || offset % 8 != 0 ||
+        size % sizeof(T) != 0) {
+      return false;
+    }
+    *data = reinterpret_cast<const T*>(data_ + offset);
+    *count = size / sizeof(T);
+    return true;
+  }
+
+  bool Strings(IndexSection offsets_section, IndexSection data_section,
+               vector<string_view>* strings) const {
+    const uint64_t* offsets = nullptr;
+    const char* data = nullptr;
+    size_t num_offsets = 0, data_size = 0;
+    if (!Section(offsets_section, &offsets, &num_offsets) ||
+        !Section(data_section, &data, &data_size) || num_offsets == 0) {
+      return false;
+    }
+    strings->clear();
+    strings->reserve(num_offsets - 1);
+    for (size_t i = 0; i + 1 < num_offsets; i++) {
+      if (offsets[i] > offsets[i + 1] || offsets[i + 1] > data_size) {
+        return false;
+      }
+      strings->emplace_back(data + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return true;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  IndexHeader header_;
+};
+
+/**
+ * Hashes the whole of a build log.
+ */
+bool hash_log(const string& filename, uint64_t* hash) {
+  auto source = LogSource::Open(filename);
+  if (!source) {
+    return false;
+  }
+  ContentHash content_hash;
+  LogChunk chunk;
+  while (source->NextChunk(&chunk)) {
+    content_hash.Update(chunk.data);
+    source->DoneWith(chunk);
+  }
+  *hash = content_hash.Finish();
+  return true;
+}
+
+/**
+ * Reads the flag sets or lists stored in the sections 'offsets_section' and
+ * 'flags_section', interning each in this process's table and mapping the
+ * index's IDs to the new ones in 'ids'. 'flags' are the index's flags.
+ */
+template <typename Flags>
+bool load_flags(const IndexReader& reader, IndexSection offsets_section,
+                IndexSection flags_section, const vector<string_view>& flags,
+                vector<uint32_t>* ids) {
+  const uint64_t* offsets = nullptr;
+  const uint32_t* set_flags = nullptr;
+  size_t num_offsets = 0, num_set_flags = 0;
+  if (!reader.Section(offsets_section, &offsets, &num_offsets) ||
+      !reader.Section(flags_section, &set_flags, &num_set_flags) ||
+      num_offsets == 0) {
+    return false;
+  }
+  ids->reserve(num_offsets - 1);
+  for (size_t i = 0; i + 1 < num_offsets; i++) {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > num_set_flags) {
+      return false;
+    }
+    Flags entry;
+    for (uint64_t j = offsets[i]; j < offsets[i + 1]; j++) {
+      if (set_flags[j] >= flags.size()) {
+        return false;
+      }
+      if constexpr (is_same_v<Flags, FlagSet>) {
+        entry.insert(flags[set_flags[j]]);
+      } else {
+        entry.push_back(flags[set_flags[j]]);
+      }
+    }
+    ids->push_back(FlagsTable<Flags>::Global().Intern(entry));
+  }
+  return true;
+}
+
+/**
+ * Writes every entry of 'table', in ID order, to the sections
+ * 'offsets_section' and 'flags_section', so that IDs can be written as they
+ * are.
+ */
+template <typename Flags>
+void write_flags(const FlagsTable<Flags>& table, IndexSection offsets_section,
+                 IndexSection flags_section, IndexWriter* writer) {
+  vector<uint64_t> offsets = {0};
+  vector<uint32_t> flags;
+  for (uint32_t id = 0; id < table.size(); id++) {
+    const auto& ids = table.Lookup(id).ids();
+    flags.insert(flags.end(), ids.begin(), ids.end());
+    offsets.push_back(flags.size());
+  }
+  writer->Section(offsets_section, offsets);
+  writer->Section(flags_section, flags);
+}
+
+/**
+ * Rebuilds the commands and skipped commands of an index whose header has
+ * already been read. The index's IDs are interned again, since the global
+ * tables may hand out different ones in this process.
+ */
+bool load_index(const IndexReader& reader, CommandTable* commands,
+                vector<SkippedCommand>* skipped_commands) {
+  vector<string_view> strings;
+  if (!reader.Strings(PATH_OFFSETS, PATH_DATA, &strings)) {
+    return false;
+  }
+  vector<PathId> paths;
+  paths.reserve(strings.size());
+  PathTable::Global().Reserve(strings.size());
+  for (string_view path : strings) {
+    paths.push_back(PathTable::Global().Intern(path));
+  }
+  vector<string_view> flags;
+  if (!reader.Strings(FLAG_OFFSETS, FLAG_DATA, &flags)) {
+    return false;
+  }
+
+  vector<FlagSetId> flag_sets;
+  vector<FlagListId> flag_lists;
+  if (!load_flags<FlagSet>(reader, FLAG_SET_OFFSETS, FLAG_SET_FLAGS, flags,
+                           &flag_sets) ||
+      !load_flags<FlagList>(reader, FLAG_LIST_OFFSETS, FLAG_LIST_FLAGS, flags,
+                            &flag_lists)) {
+    return false;
+  }
+
+  const CommandKind* kinds = nullptr;
+  const uint8_t *compilers = nullptr, *command_types = nullptr;
+  const PathId* directories = nullptr;
+  const PathId *outputs = nullptr, *depfiles = nullptr, *inputs = nullptr;
+  const uint32_t* input_counts = nullptr;
+  const FlagSetId* row_flag_sets = nullptr;
+  const FlagListId* row_flag_lists = nullptr;
+  size_t num_rows = 0, n = 0, num_inputs = 0, num_row_flag_sets = 0;
+  if (!reader.Section(ROW_KINDS, &kinds, &num_rows) ||
+      !reader.Section(ROW_COMPILERS, &compilers, &n) || n != num_rows ||
+      !reader.Section(ROW_COMMANDS, &command_types, &n) || n != num_rows ||
+      !reader.Section(ROW_DIRECTORIES, &directories, &n) || n != num_rows ||
+      !reader.Section(ROW_OUTPUTS, &outputs, &n) || n != num_rows ||
+      !reader.Section(ROW_DEPFILES, &depfiles, &n) || n != num_rows ||
+      !reader.Section(ROW_INPUT_COUNTS, &input_counts, &n) || n != num_rows ||
+      !reader.Section(ROW_FLAG_SETS, &row_flag_sets, &num_row_flag_sets) ||
+      num_row_flag_sets != num_rows * kNumFlagFields ||
+      !reader.Section(ROW_FLAG_LISTS, &row_flag_lists, &n) || n != num_rows ||
+      !reader.Section(INPUTS, &inputs, &num_inputs)) {
+    return false;
+  }
+  CommandTable table;
+  vector<PathId> row_inputs;
+  size_t input = 0;
+  for (size_t row = 0; row < num_rows; row++) {
+    if (kinds[row] > CommandKind::AR || compilers[row] > GccCommand::GPP ||
+        command_types[row] > GccCommand::LINK ||
+        directories[row] >= paths.size() || outputs[row] >= paths.size() ||
+        depfiles[row] >= paths.size() ||
+        input_counts[row] > num_inputs - input ||
+        row_flag_lists[row] >= flag_lists.size()) {
+      return false;
+    }
+    row_inputs.clear();
+    for (size_t end = input + input_counts[row]; input < end; input++) {
+      if (inputs[input] >= paths.size()) {
+        return false;
+      }
+      row_inputs.push_back(paths[inputs[input]]);
+    }
+    FlagSetId row_flags[kNumFlagFields];
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      FlagSetId id = row_flag_sets[field * num_rows + row];
+      if (id >= flag_sets.size()) {
+        return false;
+      }
+      row_flags[field] = flag_sets[id];
+    }
+    table.AddRow(kinds[row], GccCommand::Compiler(compilers[row]),
+                 GccCommand::Command(command_types[row]),
+                 paths[directories[row]], paths[outputs[row]],
+                 paths[depfiles[row]], row_inputs.data(), row_inputs.size(),
+                 row_flags, flag_lists[row_flag_lists[row]]);
+  }
+
+  const int64_t* skipped_lines = nullptr;
+  size_t num_skipped = 0;
+  if (!reader.Section(SKIPPED_LINES, &skipped_lines, &num_skipped) ||
+      !reader.Strings(SKIPPED_OFFSETS, SKIPPED_DATA, &strings) ||
+      strings.size() != num_skipped) {
+    return false;
+  }
+  skipped_commands->clear();
+  for (size_t i = 0; i < num_skipped; i++) {
+    skipped_commands->emplace_back(skipped_lines[i], strings[i]);
+  }
+  *commands = std::move(table);
+  return true;
+}
+
+}  // namespace
+
+bool stat_log(const string& filename, LogIdentity* identity) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    return false;
+  }
+  identity->size = st.st_size;
+#ifdef __APPLE__
+  const struct timespec& mtime = st.st_mtimespec;
+#else
+  const struct timespec& mtime = st.st_mtim;
+#endif
+  identity->mtime_ns = int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+  return true;
+}
+
+bool write_index(const string& filename, const LogIdentity& log,
+                 const CommandTable& commands,
+                 const vector<SkippedCommand>& skipped_commands) {
+  string temp_filename = filename + ".tmp";
+  FILE* file = fopen(temp_filename.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  IndexWriter writer(file);
+
+  // The interned strings, flag sets and flag lists, in ID order, so that IDs can be
+  // written as they are.
+  vector<string_view> strings;
+  PathTable& paths = PathTable::Global();
+  for (PathId id = 0; id < paths.size(); id++) {
+    strings.push_back(paths.Lookup(id));
+  }
+  writer.Strings(PATH_OFFSETS, PATH_DATA, strings);
+  strings.clear();
+  FlagInterner& flags = FlagInterner::Global();
+  for (uint32_t id = 0; id < flags.size(); id++) {
+    strings.push_back(flags.Lookup(id));
+  }
+  writer.Strings(FLAG_OFFSETS, FLAG_DATA, strings);
+  write_flags(FlagSetTable::Global(), FLAG_SET_OFFSETS, FLAG_SET_FLAGS,
+              &writer);
+  write_flags(FlagListTable::Global(), FLAG_LIST_OFFSETS, FLAG_LIST_FLAGS,
+              &writer);
+
+  // The columns.
+  vector<CommandKind> kinds;
+  vector<uint8_t> compilers, command_types;
+  vector<PathId> directories, outputs, depfiles, inputs;
+  vector<uint32_t> input_counts;
+  vector<FlagSetId> row_flag_sets;
+  vector<FlagListId> row_flag_lists;
+  for (CommandTable::RowId row = 0; row < commands.size(); row++) {
+    kinds.push_back(commands.kind(row));
+    compilers.push_back(commands.compiler(row));
+    command_types.push_back(commands.command(row));
+    directories.push_back(commands.directory(row));
+    outputs.push_back(commands.output(row));
+    depfiles.push_back(commands.depfile(row));
+    row_flag_lists.push_back(commands.flags_in_order(row));
+    PathList row_inputs = commands.inputs(row);
+    input_counts.push_back(row_inputs.size());
+    inputs.insert(inputs.end(), row_inputs.begin(), row_inputs.end());
+  }
+  for (size_t field = 0; field < kNumFlagFields; field++) {
+    for (CommandTable::RowId row = 0; row < commands.size(); row++) {
+      row_flag_sets.push_back(commands.flags(row, FlagField(field)));
+    }
+  }
+  writer.Section(ROW_KINDS, kinds);
+  writer.Section(ROW_COMPILERS, compilers);
+  writer.Section(ROW_COMMANDS, command_types);
+  writer.Section(ROW_DIRECTORIES, directories);
+  writer.Section(ROW_OUTPUTS, outputs);
+  writer.Section(ROW_DEPFILES, depfiles);
+  writer.Section(ROW_INPUT_COUNTS, input_counts);
+  writer.Section(ROW_FLAG_SETS, row_flag_sets);
+  writer.Section(ROW_FLAG_LISTS, row_flag_lists);
+  writer.Section(INPUTS, inputs);
+
+  vector<int64_t> skipped_lines;
+  strings.clear();
+  for (auto& [line, command] : skipped_commands) {
+    skipped_lines.push_back(line);
+    strings.push_back(command);
+  }
+  writer.Section(SKIPPED_LINES, skipped_lines);
+  writer.Strings(SKIPPED_OFFSETS, SKIPPED_DATA, strings);
+
+  bool ok = writer.Finish(log);
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+IndexStatus read_index(const string& filename, const string& log_filename,
+                       CommandTable* commands,
+                       vector<SkippedCommand>* skipped_commands) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return IndexStatus::MISSING;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return IndexStatus::INVALID;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return IndexStatus::INVALID;
+  }
+
+  IndexStatus status = IndexStatus::INVALID;
+  IndexReader reader(static_cast<const char*>(data), st.st_size);
+  LogIdentity log;
+  if (reader.ReadHeader()) {
+    const IndexHeader& header = reader.header();
+    if (!stat_log(log_filename, &log) || log.size != header.log_size ||
+        log.mtime_ns != header.log_mtime_ns ||
+        !hash_log(log_filename, &log.content_hash) ||
+        log.content_hash != header.log_hash) {
+      status = IndexStatus::STALE;
+    } else if (load_index(reader, commands, skipped_commands)) {
+      status = IndexStatus::LOADED;
+    }
+  }
+  munmap(data, st.st_size);
+  return status;
+}
+
+const char* index_status_name(IndexStatus status) {
+  switch (status) {
+    case IndexStatus::LOADED:
+      return "up to date";
+    case IndexStatus::MISSING:
+      return "missing";
+    case IndexStatus::STALE:
+      return "stale";
+    case IndexStatus::INVALID:
+      return "invalid";
+  }
+  return "unknown";
+}
@@ -0,0 +1,90 @@
+#ifndef REVERSE_MAKE_INDEX_H__
+#define REVERSE_MAKE_INDEX_H__
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/parse.h"
+
+using namespace std;
+
+/**
+ * What an index records about the build log it was built from, so that it can
+ * tell when the log has changed since.
+ */
+struct LogIdentity {
+  uint64_t size = 0;
+  int64_t mtime_ns = 0;
+  uint64_t content_hash = 0;
+};
+
+/**
+ * The outcome of read_index().
+ */
+enum class IndexStatus {
+  LOADED,   // the index is up to date and has been loaded
+  MISSING,  // there is no index file
+  STALE,    // the index was built from a different version of the log
+  INVALID,  // the file isn't an index that this version can read
+};
+
+/**
+ * Fills in the size and modification time of 'filename', but not its content
+ * hash.
+ *
+ * @return false if the file can't be stat'ed.
+ */
+bool stat_log(const string& filename, LogIdentity* identity);
+
+/**
+ * Writes a parsed build log to an index file, which read_index() can load
+ * faster than the log can be parsed again.
+ *
+ * The index holds the interned paths, flags and flag sets, each column of
+ * 'commands', and the skipped commands, as flat arrays. It is mapped when it
+ * is read, but not used in place: the IDs the global tables hand out differ
+ * from one process to the next, so each distinct path, flag and flag set is
+ * interned again, once, and the rows are rebuilt with the new IDs. What
+ * loading saves is tokenizing and classifying every line of the log. The file
+ * is written under a temporary name and renamed into place, so a reader never
+ * sees a partial index.
+ *
+ * @param filename The index file to write.
+ * @param log The identity of the log that 'commands' was parsed from.
+ * @param commands The commands parsed from the log.
+ * @param skipped_commands The commands skipped while parsing the log.
+ *
+ * @return false if the file couldn't be written.
+ */
+bool write_index(const string& filename, const LogIdentity& log,
+                 const CommandTable& commands,
+                 const vector<SkippedCommand>& skipped_commands);
+
+/**
+ * Loads an index written by write_index(), if it is up to date.
+ *
+ * The index is up to date if the log has the size, modification time and
+ * content hash recorded in it. The hash is only computed once the size and
+ * time match.
+ *
+ * @param filename The index file to read.
+ * @param log_filename The build log the index should have been built from.
+ * @param commands Receives the commands, only if the index is loaded.
+ * @param skipped_commands Receives the skipped commands, only if the index is
+ * loaded.
+ *
+ * @return Whether the index was loaded, and if not, why.
+ */
+IndexStatus read_index(const string& filename, const string& log_filename,
+                       CommandTable* commands,
+                       vector<SkippedCommand>* skipped_commands);
+
+/**
+ * Returns a short description of 'status', e.g. "stale".
+ */
+const char* index_status_name(IndexStatus status);
+
+#endif  // REVERSE_MAKE_INDEX_H__
@@ -0,0 +1,37 @@
+#include "reverse-make/interner.h"
+
+#include <algorithm>
+#include <functional>
+
+uint32_t StringInterner::Intern(string_view str) {
+  size_t hash = std::hash<string_view>()(str);
+  Shard& shard = shards_[(hash >> 8) % kNumShards];
+  lock_guard<mutex> lock(shard.shard_mutex);
+  auto it = shard.ids.find(str);
+  if (it == shard.ids.end()) {
+    char* stored = shard.arena.AllocateArray<char>(str.size());
+    copy(str.begin(), str.end(), stored);
+    string_view view(stored, str.size());
+    uint32_t id = size_.fetch_add(1, memory_order_acq_rel);
+    strings_.Set(id, view);
+    it = shard.ids.emplace(view, id).first;
+  }
+  return it->second;
+}
+
+string_view StringInterner::Lookup(uint32_t id) const { return strings_[id]; }
+
+uint32_t StringInterner::Find(string_view str) {
+  size_t hash = std::hash<string_view>()(str);
+  Shard& shard = shards_[(hash >> 8) % kNumShards];
+  lock_guard<mutex> lock(shard.shard_mutex);
+  auto it = shard.ids.find(str);
+  return it == shard.ids.end() ? kNotFound : it->second;
+}
+
+void StringInterner::Reserve(size_t n) {
+  for (Shard& shard : shards_) {
+    lock_guard<mutex> lock(shard.shard_mutex);
+    shard.ids.reserve(shard.ids.size() + n / kNumShards + 1);
+  }
+}
@@ -0,0 +1,136 @@
+#ifndef REVERSE_MAKE_INTERNER_H__
+#define REVERSE_MAKE_INTERNER_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "reverse-make/arena.h"
+
+using namespace std;
+
+/**
+ * An array that only grows, and that can be read without locking while other
+ * threads add to it.
+ *
+ * Elements live in fixed-size chunks that never move once allocated, so a
+ * reference to an element stays valid for the lifetime of the array. Each
+ * index must be set by one thread only, and read only by threads that learned
+ * of it after it was set.
+ */
+template <typename T>
+class AppendOnlyArray {
+ public:
+  AppendOnlyArray() : chunks_(new atomic<T*>[kMaxChunks]) {
+    for (size_t i = 0; i < kMaxChunks; i++) {
+      chunks_[i].store(nullptr, memory_order_relaxed);
+    }
+  }
+  AppendOnlyArray(const AppendOnlyArray&) = delete;
+  AppendOnlyArray& operator=(const AppendOnlyArray&) = delete;
+  ~AppendOnlyArray() {
+    for (size_t i = 0; i < kMaxChunks; i++) {
+      delete[] chunks_[i].load(memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Sets the element at 'index', allocating its chunk if need be.
+   */
+  void Set(size_t index, T value) {
+    atomic<T*>& slot = chunks_[index >> kChunkBits];
+    T* chunk = slot.load(memory_order_acquire);
+    if (chunk == nullptr) {
+      T* fresh = new T[kChunkSize];
+      if (slot.compare_exchange_strong(chunk, fresh, memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        // Another thread got there first; 'chunk' is now its chunk.
+        delete[] fresh;
+      }
+    }
+    chunk[index & (kChunkSize - 1)] = move(value);
+  }
+
+  const T& operator[](size_t index) const {
+    return chunks_[index >> kChunkBits].load(
+        memory_order_acquire)[index & (kChunkSize - 1)];
+  }
+
+ private:
+  static constexpr size_t kChunkBits = 16;
+  static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+  static constexpr size_t kMaxChunks = (size_t(1) << 32) >> kChunkBits;
+
+  unique_ptr<atomic<T*>[]> chunks_;
+};
+
+/**
+ * Maps each distinct string to a dense integer ID.
+ *
+ * Each string is stored once, and IDs are handed out densely starting at 0,
+ * in order of first appearance when only one thread interns. IDs and the
+ * views returned by Lookup() are never invalidated.
+ *
+ * The interner is safe to use from several threads at once. Strings are
+ * spread by hash over independently locked shards, so threads interning
+ * different strings rarely wait for each other, and Lookup() takes no lock
+ * at all.
+ */
+class StringInterner {
+ public:
+  // What Find() returns for a string that was never interned.
+  static constexpr uint32_t kNotFound = ~uint32_t(0);
+
+  /**
+   * Returns the ID of 'str', assigning it a new one if it hasn't been seen
+   * before.
+   */
+  uint32_t Intern(string_view str);
+
+  /**
+   * Returns the string of a previously interned ID. The view stays valid for
+   * the lifetime of the interner.
+   */
+  string_view Lookup(uint32_t id) const;
+
+  /**
+   * Returns the ID of 'str', or kNotFound if it was never interned. Unlike
+   * Intern(), this never adds it, so looking up strings that aren't there
+   * doesn't grow the interner.
+   */
+  uint32_t Find(string_view str);
+
+  /**
+   * Returns the number of distinct strings interned so far. While other
+   * threads are interning, the newest IDs may not be ready to look up yet.
+   */
+  size_t size() const { return size_.load(memory_order_acquire); }
+
+  /**
+   * Makes room for 'n' more strings, when a caller knows that many are coming.
+   */
+  void Reserve(size_t n);
+
+ private:
+  static constexpr size_t kNumShards = 32;
+
+  // The strings whose hashes fall in one shard.
+  struct alignas(64) Shard {
+    mutex shard_mutex;
+    // The characters of the shard's strings, back to back.
+    Arena arena;
+    unordered_map<string_view, uint32_t> ids;
+  };
+
+  Shard shards_[kNumShards];
+  atomic<uint32_t> size_{0};
+  AppendOnlyArray<string_view> strings_;
+};
+
+#endif  // REVERSE_MAKE_INTERNER_H__
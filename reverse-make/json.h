@@ -0,0 +1,49 @@
+#ifndef REVERSE_MAKE_JSON_H__
+#define REVERSE_MAKE_JSON_H__
+
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Appends 'str' to 'out' as a JSON string, quoted and escaped.
+ *
+ * @param str The string.
+ * @param out A buffer with push_back(char), such as a string or a
+ * fmt::memory_buffer.
+ */
+template <typename Buffer>
+void append_json_string(string_view str, Buffer* out) {
+  constexpr char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  for (char c : str) {
+    switch (c) {
+      case '"':
+      case '\\':
+        out->push_back('\\');
+        out->push_back(c);
+        break;
+      case '\n':
+        out->push_back('\\');
+        out->push_back('n');
+        break;
+      case '\t':
+        out->push_back('\\');
+        out->push_back('t');
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          for (char e : {'\\', 'u', '0', '0'}) {
+            out->push_back(e);
+          }
+          out->push_back(kHex[c >> 4]);
+          out->push_back(kHex[c & 0xf]);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+#endif  // REVERSE_MAKE_JSON_H__
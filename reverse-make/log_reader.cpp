@@ -0,0 +1,267 @@
+#include "reverse-make/log_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "reverse-make/scan.h"
+
+namespace {
+
+/**
+ * Returns true if the newline at 'pos' is escaped, i.e. it is preceded by an
+ * odd number of backslashes.
+ */
+bool is_escaped_newline(string_view data, size_t pos) {
+  size_t backslashes = 0;
+  while (pos > backslashes && data[pos - backslashes - 1] == '\\') {
+    backslashes++;
+  }
+  return backslashes % 2 == 1;
+}
+
+/**
+ * Serves chunks straight out of a log that is already in memory.
+ */
+class BufferLogSource : public LogSource {
+ public:
+  BufferLogSource(string_view data, size_t chunk_size)
+      : data_(data), chunk_size_(chunk_size) {}
+
+  bool NextChunk(LogChunk* chunk) override {
+    if (pos_ >= data_.size()) {
+      return false;
+    }
+    size_t end = data_.size();
+    if (data_.size() - pos_ > chunk_size_) {
+      end = min(find_line_end(data_, pos_ + chunk_size_), data_.size());
+    }
+    chunk->storage.clear();
+    chunk->data = data_.substr(pos_, end - pos_);
+    pos_ = end;
+    return true;
+  }
+
+ protected:
+  string_view data_;
+
+ private:
+  size_t chunk_size_;
+  size_t pos_ = 0;
+};
+
+/**
+ * Serves chunks straight out of a read-only mapping of a regular file.
+ */
+class MappedLogSource : public BufferLogSource {
+ public:
+  MappedLogSource(int fd, const char* data, size_t size, size_t chunk_size)
+      : BufferLogSource(string_view(data, size), chunk_size), fd_(fd) {}
+
+  ~MappedLogSource() override {
+    munmap(const_cast<char*>(data_.data()), data_.size());
+    close(fd_);
+  }
+
+  void DoneWith(const LogChunk& chunk) override {
+    // Drop the pages that lie entirely inside the chunk. They are clean file
+    // pages, so this only keeps them from counting against our RSS.
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = reinterpret_cast<uintptr_t>(chunk.data.data());
+    uintptr_t end = begin + chunk.data.size();
+    begin = (begin + page_size - 1) & ~(page_size - 1);
+    end &= ~(page_size - 1);
+    if (begin < end) {
+      madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    }
+  }
+
+ private:
+  int fd_;
+};
+
+/**
+ * Reads stdin, pipes and other non-mappable inputs in fixed-size blocks.
+ */
+class StreamLogSource : public LogSource {
+ public:
+  StreamLogSource(int fd, bool owns_fd, size_t chunk_size)
+      : fd_(fd), owns_fd_(owns_fd), chunk_size_(chunk_size) {}
+
+  ~StreamLogSource() override {
+    if (owns_fd_) {
+      close(fd_);
+    }
+  }
+
+  bool NextChunk(LogChunk* chunk) override {
+    // buffer_[0, filled_) holds bytes that have been read but not handed out.
+    // Everything before 'scanned' is known not to contain a line end.
+    size_t scanned = 0;
+    while (true) {
+      while (!eof_ && filled_ < chunk_size_) {
+        Fill();
+      }
+      size_t boundary =
+          eof_ ? filled_
+               : rfind_line_end(string_view(buffer_.data(), filled_), scanned);
+      if (boundary != string_view::npos && boundary > 0) {
+        Emit(boundary, chunk);
+        return true;
+      }
+      if (eof_) {
+        return false;
+      }
+      // The pending logical line is longer than the buffer; keep reading.
+      scanned = filled_;
+      Fill();
+    }
+  }
+
+ private:
+  void Fill() {
+    if (buffer_.size() < filled_ + chunk_size_) {
+      buffer_.resize(filled_ + chunk_size_);
+    }
+    ssize_t n;
+    do {
+      n = read(fd_, buffer_.data() + filled_, buffer_.size() - filled_);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+      eof_ = true;
+    } else {
+      filled_ += n;
+    }
+  }
+
+  // Hands buffer_[0, boundary) to 'chunk' and carries the remainder over to
+  // the front of the buffer. The chunk's old storage becomes our new buffer,
+  // so steady-state reading doesn't allocate.
+  void Emit(size_t boundary, LogChunk* chunk) {
+    chunk->storage.swap(buffer_);
+    size_t carry = filled_ - boundary;
+    if (buffer_.size() < carry + chunk_size_) {
+      buffer_.resize(carry + chunk_size_);
+    }
+    memcpy(buffer_.data(), chunk->storage.data() + boundary, carry);
+    filled_ = carry;
+    chunk->data = string_view(chunk->storage.data(), boundary);
+  }
+
+  int fd_;
+  bool owns_fd_;
+  size_t chunk_size_;
+  vector<char> buffer_;
+  size_t filled_ = 0;
+  bool eof_ = false;
+};
+
+}  // namespace
+
+unique_ptr<LogSource> LogSource::Open(const string& filename,
+                                      size_t chunk_size) {
+  if (filename == "-") {
+    return make_unique<StreamLogSource>(STDIN_FILENO, false, chunk_size);
+  }
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      return make_unique<MappedLogSource>(fd, static_cast<const char*>(data),
+                                          st.st_size, chunk_size);
+    }
+  }
+  // Not mappable; fall back to reading it like a pipe.
+  return make_unique<StreamLogSource>(fd, true, chunk_size);
+}
+
+unique_ptr<LogSource> LogSource::FromBuffer(string_view data,
+                                            size_t chunk_size) {
+  return make_unique<BufferLogSource>(data, chunk_size);
+}
+
+unique_ptr<LogSource> LogSource::FromFd(int fd, bool owns_fd,
+                                        size_t chunk_size) {
+  return make_unique<StreamLogSource>(fd, owns_fd, chunk_size);
+}
+
+bool LogicalLineSplitter::Next(string_view* line) {
+  if (rest_.empty()) {
+    return false;
+  }
+  const char* begin = rest_.data();
+  const char* end = begin + rest_.size();
+
+  // Fast path: the line has no backslashes, so it can be handed out as is.
+  const char* p = scan_any_of(begin, end, '\n', '\\');
+  if (p == end || *p == '\n') {
+    *line = string_view(begin, p - begin);
+    rest_.remove_prefix(p == end ? rest_.size() : p - begin + 1);
+    return true;
+  }
+
+  // Slow path: unescape into the scratch buffer. 'p' only ever stops at
+  // newlines and backslashes; everything in between is copied in bulk.
+  scratch_.assign(begin, p);
+  bool is_escaped = false;
+  while (p < end) {
+    char c = *p;
+    if (c == '\n' && !is_escaped) {
+      break;
+    } else if (c == '\\') {
+      if (is_escaped) {  // means '\\' is found
+        scratch_ += c;
+        is_escaped = false;
+      } else {
+        is_escaped = true;
+      }
+      p++;
+    } else {
+      if (is_escaped) {
+        scratch_ += '\\';
+        is_escaped = false;
+      }
+      const char* run_end = scan_any_of(p + 1, end, '\n', '\\');
+      scratch_.append(p, run_end);
+      p = run_end;
+    }
+  }
+  *line = scratch_;
+  rest_.remove_prefix(p == end ? rest_.size() : p - begin + 1);
+  return true;
+}
+
+size_t find_line_end(string_view data, size_t from) {
+  for (size_t pos = data.find('\n', from); pos != string_view::npos;
+       pos = data.find('\n', pos + 1)) {
+    if (!is_escaped_newline(data, pos)) {
+      return pos + 1;
+    }
+  }
+  return string_view::npos;
+}
+
+size_t rfind_line_end(string_view data, size_t from) {
+  if (data.empty()) {
+    return string_view::npos;
+  }
+  for (size_t pos = data.rfind('\n'); pos != string_view::npos && pos >= from;
+       pos = pos == 0 ? string_view::npos : data.rfind('\n', pos - 1)) {
+    if (!is_escaped_newline(data, pos)) {
+      return pos + 1;
+    }
+  }
+  return string_view::npos;
+}
@@ -0,0 +1,140 @@
+#ifndef REVERSE_MAKE_LOG_READER_H__
+#define REVERSE_MAKE_LOG_READER_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A run of raw log bytes that ends on a logical line boundary (just after a
+ * newline that is not escaped by a backslash), or at the end of the input.
+ *
+ * 'data' either points into a memory-mapped file or a caller's buffer, or into
+ * 'storage' when the bytes were read from a stream.
+ */
+struct LogChunk {
+  string_view data;
+  vector<char> storage;
+};
+
+/**
+ * Hands out the contents of a build log in chunks, without ever holding the
+ * whole log in memory.
+ *
+ * Regular files are memory-mapped. Anything else (stdin, pipes, FIFOs) is read
+ * in fixed-size blocks; a logical line that does not fit in one block grows the
+ * buffer until it does, so memory use is bounded by the longest logical line
+ * rather than by the size of the log.
+ */
+class LogSource {
+ public:
+  virtual ~LogSource() {}
+
+  /**
+   * Opens the given file for reading. The filename "-" means stdin.
+   *
+   * @param filename The path of the build log, or "-".
+   *
+   * @param chunk_size The approximate number of bytes to hand out per chunk.
+   *
+   * @return The opened source, or nullptr if the file can't be opened.
+   */
+  static unique_ptr<LogSource> Open(const string& filename,
+                                    size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * Hands out a log that is already in memory, in chunks that point into it.
+   *
+   * @param data The log. It must outlive the source and its chunks.
+   *
+   * @param chunk_size The approximate number of bytes to hand out per chunk.
+   */
+  static unique_ptr<LogSource> FromBuffer(
+      string_view data, size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * Reads a log from a file descriptor, such as a pipe or a socket, in
+   * blocks.
+   *
+   * @param fd The file descriptor.
+   *
+   * @param owns_fd If true, the source closes 'fd' when it is destroyed.
+   *
+   * @param chunk_size The approximate number of bytes to hand out per chunk.
+   */
+  static unique_ptr<LogSource> FromFd(int fd, bool owns_fd,
+                                      size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * Fetches the next chunk of the log.
+   *
+   * A chunk stays valid until it is passed to DoneWith() or reused for another
+   * call to NextChunk(), so several chunks may be outstanding at once.
+   *
+   * @return false at the end of the input, true otherwise.
+   */
+  virtual bool NextChunk(LogChunk* chunk) = 0;
+
+  /**
+   * Tells the source the caller has finished with 'chunk', so the memory
+   * backing it can be given back to the OS.
+   */
+  virtual void DoneWith(const LogChunk& chunk) {}
+
+  static constexpr size_t kDefaultChunkSize = 1 << 20;
+};
+
+/**
+ * Splits a LogChunk into logical lines, i.e. lines joined by backslash
+ * continuations.
+ *
+ * The escaping rules are those of a shell-like command log: a newline preceded
+ * by an odd number of backslashes is escaped and stays part of the line (along
+ * with the backslash that escapes it), and a pair of backslashes collapses into
+ * a single one.
+ *
+ * Lines without any backslash are returned as views directly into the chunk.
+ * Lines that need unescaping are materialized into a scratch buffer that is
+ * reused from one line to the next.
+ *
+ * Example:
+ * "hello\\\nworld\n" yields {"hello\\\nworld"}
+ * "hello\nworld\n" yields {"hello", "world"}
+ * "hello\\\\world" yields {"hello\\world"}
+ */
+class LogicalLineSplitter {
+ public:
+  explicit LogicalLineSplitter(string_view chunk) : rest_(chunk) {}
+
+  /**
+   * Fetches the next logical line.
+   *
+   * @param line Set to the line, without its terminating newline. It stays
+   * valid until the next call to Next().
+   *
+   * @return false once the chunk is exhausted.
+   */
+  bool Next(string_view* line);
+
+ private:
+  string_view rest_;
+  string scratch_;
+};
+
+/**
+ * Returns the offset just past the first unescaped newline at or after 'from'
+ * in 'data', or string_view::npos if there is none.
+ */
+size_t find_line_end(string_view data, size_t from);
+
+/**
+ * Returns the offset just past the last unescaped newline at or after 'from'
+ * in 'data', or string_view::npos if there is none.
+ */
+size_t rfind_line_end(string_view data, size_t from = 0);
+
+#endif  // REVERSE_MAKE_LOG_READER_H__
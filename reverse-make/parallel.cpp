@@ -0,0 +1,61 @@
+#include "reverse-make/parallel.h"
+
+ThreadPool::ThreadPool(int jobs) {
+  for (int t = 1; t < jobs; t++) {
+    workers_.emplace_back([this]() { Work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Run(size_t n, const function<void(size_t)>& fn) {
+  {
+    lock_guard<mutex> lock(mutex_);
+    fn_ = &fn;
+    n_ = n;
+    next_ = 0;
+    busy_ = workers_.size();
+    generation_++;
+  }
+  start_.notify_all();
+  for (size_t i = next_++; i < n; i = next_++) {
+    fn(i);
+  }
+  // The workers may still be running the last items, or not have woken up
+  // yet; either way fn must outlive them.
+  unique_lock<mutex> lock(mutex_);
+  done_.wait(lock, [this]() { return busy_ == 0; });
+  fn_ = nullptr;
+}
+
+void ThreadPool::Work() {
+  size_t generation = 0;
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    start_.wait(lock,
+                [&]() { return stop_ || generation_ != generation; });
+    if (stop_) {
+      return;
+    }
+    generation = generation_;
+    const function<void(size_t)>& fn = *fn_;
+    size_t n = n_;
+    lock.unlock();
+    for (size_t i = next_++; i < n; i = next_++) {
+      fn(i);
+    }
+    lock.lock();
+    if (--busy_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,124 @@
+#ifndef REVERSE_MAKE_PARALLEL_H__
+#define REVERSE_MAKE_PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Calls fn(i) for every i in [0, n), spread over up to 'jobs' threads.
+ *
+ * Work items are handed out one at a time from a shared counter, so uneven
+ * items balance themselves. With 'jobs' <= 1 (or a single item) everything runs
+ * on the calling thread. Returns once every call has finished.
+ *
+ * @param n The number of work items.
+ *
+ * @param jobs The maximum number of threads to use, including the caller's.
+ *
+ * @param fn The work to do. It must be safe to call concurrently for different
+ * values of i.
+ */
+template <typename Fn>
+void parallel_for(size_t n, int jobs, Fn&& fn) {
+  size_t threads = min<size_t>(max(jobs, 1), n);
+  if (threads <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      fn(i);
+    }
+  };
+  vector<thread> workers;
+  for (size_t t = 1; t < threads; t++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+/**
+ * Threads that are started once and then run one parallel loop after another,
+ * for callers that run many short loops, such as parse_log(), which parses a
+ * log a batch of chunks at a time. parallel_for() starts and joins its threads
+ * on every call instead.
+ *
+ * Only one loop runs at a time, and only one thread should call Run().
+ */
+class ThreadPool {
+ public:
+  /**
+   * Starts 'jobs' - 1 threads, since the thread that calls Run() works too.
+   */
+  explicit ThreadPool(int jobs);
+
+  /**
+   * Stops the threads, once they finish the loop they are running.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Returns the number of threads loops run on, including the caller's.
+   */
+  size_t size() const { return workers_.size() + 1; }
+
+  /**
+   * Calls fn(i) for every i in [0, n), as parallel_for() does, on the pool's
+   * threads and the caller's. Returns once every call has finished.
+   */
+  void Run(size_t n, const function<void(size_t)>& fn);
+
+ private:
+  // Runs the loop of each generation, until stop_.
+  void Work();
+
+  vector<thread> workers_;
+  mutex mutex_;
+  // Signalled when a loop starts or the pool stops, and when the last worker
+  // is done with a loop.
+  condition_variable start_;
+  condition_variable done_;
+  // The current loop, the next item of it to hand out, and how many workers
+  // haven't finished it yet.
+  const function<void(size_t)>* fn_ = nullptr;
+  size_t n_ = 0;
+  atomic<size_t> next_{0};
+  size_t busy_ = 0;
+  // Counts the loops run, so each worker runs each loop once.
+  size_t generation_ = 0;
+  bool stop_ = false;
+};
+
+/**
+ * Calls fn(i) for every i in [0, n) on the threads of 'pool'.
+ */
+template <typename Fn>
+void parallel_for(size_t n, ThreadPool* pool, Fn&& fn) {
+  if (pool->size() <= 1 || n <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+  pool->Run(n, function<void(size_t)>(ref(fn)));
+}
+
+#endif  // REVERSE_MAKE_PARALLEL_H__
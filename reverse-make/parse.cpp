@@ -0,0 +1,436 @@
+#include "reverse-make/parse.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "reverse-make/gcc_options.h"
+#include "reverse-make/parallel.h"
+#include "reverse-make/paths.h"
+#include "reverse-make/stats.h"
+#include "reverse-make/tokenizer.h"
+
+namespace {
+
+/**
+ * Interns the canonical form of 'path', as seen from 'directories' if they
+ * aren't null.
+ */
+PathId intern_path(string_view path, const DirectoryStack* directories) {
+  static thread_local string scratch;
+  return PathTable::Global().Intern(
+      directories != nullptr ? directories->Resolve(path, &scratch)
+                             : normalize_path(path, &scratch));
+}
+
+/**
+ * Interns the directory a command runs in: the current directory of
+ * 'directories', or "." if there are none.
+ */
+PathId intern_directory(const DirectoryStack* directories) {
+  return PathTable::Global().Intern(
+      directories != nullptr ? directories->current() : string_view("."));
+}
+
+/**
+ * Prints the message a problem of 'kind' about 'token' aborts with when there
+ * are no diagnostics to record it in, and aborts.
+ */
+void abort_on(DiagnosticKind kind, string_view token) {
+  switch (kind) {
+    case DiagnosticKind::UNHANDLED_OPTION:
+      fmt::print("Unhandled argument type: \"{}\"\n", token);
+      break;
+    case DiagnosticKind::MISSING_ARGUMENT:
+      fmt::print("No argument after '{}'\n", token);
+      break;
+    case DiagnosticKind::UNSUPPORTED_GCC_COMMAND:
+      fmt::print(stderr, "Unsupported or unknown gcc/g++ command type.");
+      break;
+    case DiagnosticKind::UNSUPPORTED_AR_MODE:
+      fmt::print(
+          "Only form of `ar` command suported is `ar cr|rc|cq|qc|rcs "
+          "<inputs...> <output>\n");
+      break;
+    default:
+      break;
+  }
+  abort();
+}
+
+}  // namespace
+
+GccCommand process_gcc_command(const vector<string_view>& parts,
+                               Diagnostics* diagnostics,
+                               const DirectoryStack* directories) {
+  PathTable& paths = PathTable::Global();
+  GccCommand gcc_command;
+  gcc_command.output = paths.Intern("");
+  gcc_command.depfile = gcc_command.output;
+  gcc_command.directory = intern_directory(directories);
+
+  if (parts[0] == "gcc") {
+    gcc_command.compiler = GccCommand::GCC;
+  } else if (parts[0] == "g++") {
+    gcc_command.compiler = GccCommand::GPP;
+  } else {
+    fmt::print("Unsupported command: {}\n", parts[0]);
+    abort();
+  }
+
+  // default unless -c, -S, or -E
+  gcc_command.command = GccCommand::LINK;
+
+  for (size_t i = 1; i < parts.size(); i++) {
+    string_view arg = parts[i];
+    const GccOption* option = classify_gcc_option(arg);
+    if (option == nullptr) {
+      gcc_command.inputs.push_back(intern_path(arg, directories));
+      continue;
+    }
+
+    // The option as it should be recorded.
+    string_view value = arg;
+    string joined;
+    switch (option->arity) {
+      case GccOptionArity::NONE:
+        break;
+      case GccOptionArity::SKIP_NEXT:
+      case GccOptionArity::JOINED_NEXT:
+      case GccOptionArity::NEXT:
+        if (i + 1 == parts.size()) {
+          if (diagnostics == nullptr) {
+            abort_on(DiagnosticKind::MISSING_ARGUMENT, option->name);
+          }
+          diagnostics->Add(DiagnosticKind::MISSING_ARGUMENT, option->name);
+          continue;
+        }
+        if (option->arity == GccOptionArity::SKIP_NEXT) {
+          i++;
+        } else if (option->arity == GccOptionArity::NEXT) {
+          value = parts[++i];
+        } else {
+          // pass the whole thing.
+          auto this_part = parts[i];
+          auto next_part = parts[++i];
+          joined = fmt::format("{} {}", this_part, next_part);
+          value = joined;
+        }
+        break;
+    }
+
+    // The set the option is recorded in, if any.
+    FlagSet* field = nullptr;
+    switch (option->kind) {
+      case GccOptionKind::COMPILE:
+        gcc_command.command = GccCommand::COMPILE;
+        break;
+      case GccOptionKind::COMPILE_NO_ASSEMBLE:
+        gcc_command.command = GccCommand::COMPILE_NO_ASSEMBLE;
+        break;
+      case GccOptionKind::PREPROCESS_ONLY:
+        gcc_command.command = GccCommand::PREPROCESS_ONLY;
+        break;
+      case GccOptionKind::DEFINE:
+        field = &gcc_command.defines;
+        break;
+      case GccOptionKind::INCLUDE:
+        field = &gcc_command.includes;
+        break;
+      case GccOptionKind::CFLAG:
+        field = &gcc_command.cflags;
+        break;
+      case GccOptionKind::WARN:
+        field = &gcc_command.warns;
+        break;
+      case GccOptionKind::TARGET_OPT:
+        field = &gcc_command.target_opts;
+        break;
+      case GccOptionKind::OPTIMIZATION:
+        field = &gcc_command.optimizations;
+        break;
+      case GccOptionKind::DEBUG_INFO:
+        field = &gcc_command.debug;
+        break;
+      case GccOptionKind::LINK_SEARCH_DIR:
+        field = &gcc_command.link_search_dirs;
+        break;
+      case GccOptionKind::LINKOPT:
+        field = &gcc_command.linkopts;
+        break;
+      case GccOptionKind::LINK_LIB:
+        field = &gcc_command.link_libs;
+        break;
+      case GccOptionKind::OUTPUT:
+        gcc_command.output = intern_path(value, directories);
+        break;
+      case GccOptionKind::DEPFILE:
+        // Either "-MF file" or "-MFfile".
+        gcc_command.depfile = intern_path(
+            option->is_prefix ? value.substr(option->name.size()) : value,
+            directories);
+        break;
+      case GccOptionKind::IGNORED:
+        break;
+      case GccOptionKind::UNHANDLED:
+        // The option, not the argument it may have consumed.
+        if (diagnostics == nullptr) {
+          abort_on(DiagnosticKind::UNHANDLED_OPTION, arg);
+        }
+        diagnostics->Add(DiagnosticKind::UNHANDLED_OPTION, arg);
+        break;
+    }
+    if (field != nullptr) {
+      uint32_t id = FlagInterner::Global().Intern(value);
+      field->insert(id);
+      gcc_command.flags_in_order.push_back(id);
+    }
+  }
+  return gcc_command;
+}
+
+namespace {
+
+/**
+ * Returns true if 'parts' is an ar command of the form process_ar_command()
+ * supports.
+ */
+bool is_supported_ar_command(const vector<string_view>& parts) {
+  return parts.size() >= 4 &&
+         (parts[1] == "cr" || parts[1] == "rc" || parts[1] == "qc" ||
+          parts[1] == "cq" || parts[1] == "rcs");
+}
+
+}  // namespace
+
+ArCommand process_ar_command(const vector<string_view>& parts,
+                             const DirectoryStack* directories) {
+  ArCommand ar_command;
+
+  if (!is_supported_ar_command(parts)) {
+    abort_on(DiagnosticKind::UNSUPPORTED_AR_MODE, "");
+  }
+  ar_command.directory = intern_directory(directories);
+  ar_command.output = intern_path(parts[2], directories);
+  for (int i = 3; i < parts.size(); i++) {
+    ar_command.inputs.push_back(intern_path(parts[i], directories));
+  }
+
+  return ar_command;
+}
+
+bool add_command(const vector<string_view>& parts, CommandTable* commands,
+                 Diagnostics* diagnostics, const DirectoryStack* directories) {
+  if (parts[0] == "gcc" || parts[0] == "g++") {
+    auto c = process_gcc_command(parts, diagnostics, directories);
+    if (c.command != GccCommand::COMPILE && c.command != GccCommand::LINK) {
+      if (diagnostics == nullptr) {
+        abort_on(DiagnosticKind::UNSUPPORTED_GCC_COMMAND, "");
+      }
+      diagnostics->Add(DiagnosticKind::UNSUPPORTED_GCC_COMMAND,
+                       c.CommandAsString());
+      return true;
+    }
+    commands->Add(c);
+    return true;
+  } else if (parts[0] == "ar") {
+    if (diagnostics != nullptr && !is_supported_ar_command(parts)) {
+      // The mode, or the whole command if it's only short of arguments.
+      string form = parts.size() > 1 ? string(parts[1]) : "";
+      if (parts.size() < 4) {
+        for (size_t i = 2; i < parts.size(); i++) {
+          form += fmt::format(" {}", parts[i]);
+        }
+      }
+      diagnostics->Add(DiagnosticKind::UNSUPPORTED_AR_MODE, form);
+      return true;
+    }
+    commands->Add(process_ar_command(parts, directories));
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+/**
+ * Strips the timestamp from the start of each physical line of 'line', and
+ * returns the start time of the first.
+ *
+ * @return false if the first physical line has no timestamp.
+ */
+bool strip_timestamps(string_view* line, double* seconds) {
+  static thread_local string scratch;
+  if (!strip_timestamp(line, seconds)) {
+    return false;
+  }
+  size_t continuation = line->find("\\\n");
+  if (continuation == string_view::npos) {
+    return true;
+  }
+  scratch.clear();
+  string_view rest = *line;
+  while (continuation != string_view::npos) {
+    scratch.append(rest.substr(0, continuation + 2));
+    rest.remove_prefix(continuation + 2);
+    double ignored;
+    strip_timestamp(&rest, &ignored);
+    continuation = rest.find("\\\n");
+  }
+  scratch.append(rest);
+  *line = scratch;
+  return true;
+}
+
+}  // namespace
+
+ParsedChunk parse_chunk(string_view chunk, const ParseOptions& options,
+                        const DirectoryStack& directories) {
+  static thread_local CommandTokenizer tokenizer;
+  static const PathId kNoOutput = PathTable::Global().Intern("");
+  ParsedChunk parsed;
+  parsed.directories = directories;
+  PhaseTimer timer;
+  LogicalLineSplitter lines(chunk);
+  string_view command;
+  // Without keep_going, problems aren't acted on here either, since this may
+  // be one of several threads: parsing stops at the first, and merge_chunk()
+  // aborts on it once everything before it in the log has been reported.
+  for (; lines.Next(&command); parsed.lines++) {
+    double start;
+    bool has_start =
+        options.timestamped && strip_timestamps(&command, &start);
+    timer.Lap(Phase::SPLIT);
+    const auto& parts = tokenizer.Tokenize(command);
+    timer.Lap(Phase::TOKENIZE);
+    size_t rows = parsed.commands.size();
+    // Lines are counted from 1 here, since line 0 is no line at all.
+    parsed.diagnostics.SetLine(parsed.lines + 1);
+    DirectoryChange change;
+    if (parts.size() > 0 &&
+        !add_command(parts, &parsed.commands, &parsed.diagnostics,
+                     &parsed.directories)) {
+      if (parse_directory_change(command, &change)) {
+        parsed.directories.Apply(change);
+      } else {
+        parsed.skipped_commands.emplace_back(parsed.lines, parts[0]);
+      }
+    }
+    if (!options.keep_going && !parsed.diagnostics.empty()) {
+      parsed.stopped = true;
+      break;
+    }
+    if (has_start) {
+      parsed.starts.emplace_back(parsed.commands.size() > rows
+                                     ? parsed.commands.output(rows)
+                                     : kNoOutput,
+                                 start);
+    }
+    timer.Lap(Phase::PROCESS);
+  }
+  timer.Lap(Phase::SPLIT);
+  return parsed;
+}
+
+void chunk_directories(const LogChunk* chunks, size_t n, ThreadPool* pool,
+                       bool timestamped, DirectoryStack* directories,
+                       vector<DirectoryStack>* starts) {
+  vector<vector<DirectoryChange>> changes(n);
+  parallel_for(n, pool, [&](size_t i) {
+    find_directory_changes(chunks[i].data, timestamped, &changes[i]);
+  });
+  starts->resize(n);
+  for (size_t i = 0; i < n; i++) {
+    (*starts)[i] = *directories;
+    for (const DirectoryChange& change : changes[i]) {
+      directories->Apply(change);
+    }
+  }
+}
+
+void merge_chunk(ParsedChunk* parsed, int* line, CommandTable* commands,
+                 vector<SkippedCommand>* skipped_commands,
+                 CommandTimings* timings, Diagnostics* diagnostics) {
+  commands->Append(parsed->commands);
+  if (diagnostics != nullptr) {
+    diagnostics->Merge(parsed->diagnostics, *line - 1);
+  }
+  if (timings != nullptr) {
+    for (auto [output, start] : parsed->starts) {
+      timings->AddStart(output, start);
+    }
+  }
+  for (auto& [chunk_line, command] : parsed->skipped_commands) {
+    skipped_commands->emplace_back(*line + chunk_line, command);
+    print_skipped_command(skipped_commands->back());
+  }
+  abort_on_problem(*parsed);
+  *line += parsed->lines;
+  *parsed = ParsedChunk();
+}
+
+void abort_on_problem(const ParsedChunk& parsed) {
+  if (parsed.stopped) {
+    const auto* problem = parsed.diagnostics.first();
+    abort_on(problem->first, problem->second);
+  }
+}
+
+void print_skipped_command(const SkippedCommand& skipped) {
+  fmt::print(stderr, "Skipping unrecognized command \"{}\" on line {}.\n",
+             skipped.second, skipped.first);
+}
+
+void parse_log(LogSource* source, int jobs, CommandTable* commands,
+               vector<SkippedCommand>* skipped_commands,
+               ContentHash* content_hash, CommandTimings* timings,
+               Diagnostics* diagnostics) {
+  Stats* stats = Stats::Active();
+  int line = 1;
+  vector<LogChunk> chunks(jobs * 4);
+  vector<ParsedChunk> parsed_chunks(chunks.size());
+  ParseOptions options;
+  options.timestamped = timings != nullptr;
+  options.keep_going = diagnostics != nullptr;
+  DirectoryStack directories;
+  vector<DirectoryStack> starts;
+  ThreadPool pool(jobs);
+  bool more = true;
+  while (more) {
+    size_t n = 0;
+    {
+      ScopedPhase phase(Phase::READ);
+      while (n < chunks.size() && (more = source->NextChunk(&chunks[n]))) {
+        n++;
+      }
+    }
+    {
+      ScopedPhase phase(Phase::PARSE);
+      chunk_directories(chunks.data(), n, &pool, options.timestamped,
+                        &directories, &starts);
+      parallel_for(n, &pool, [&](size_t i) {
+        parsed_chunks[i] = parse_chunk(chunks[i].data, options, starts[i]);
+      });
+      for (size_t i = 0; i < n; i++) {
+        merge_chunk(&parsed_chunks[i], &line, commands, skipped_commands,
+                    timings, diagnostics);
+      }
+    }
+    if (content_hash != nullptr) {
+      ScopedPhase phase(Phase::INDEX);
+      for (size_t i = 0; i < n; i++) {
+        content_hash->Update(chunks[i].data);
+      }
+    }
+    ScopedPhase phase(Phase::READ);
+    for (size_t i = 0; i < n; i++) {
+      if (stats != nullptr) {
+        stats->counts().bytes += chunks[i].data.size();
+      }
+      source->DoneWith(chunks[i]);
+    }
+  }
+  if (stats != nullptr) {
+    stats->counts().lines += line - 1;
+  }
+}
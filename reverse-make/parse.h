@@ -0,0 +1,239 @@
+#ifndef REVERSE_MAKE_PARSE_H__
+#define REVERSE_MAKE_PARSE_H__
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/commands.h"
+#include "reverse-make/diagnostics.h"
+#include "reverse-make/directories.h"
+#include "reverse-make/hash.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/parallel.h"
+#include "reverse-make/paths.h"
+#include "reverse-make/timings.h"
+
+using namespace std;
+
+/**
+ * A line of the build log that isn't a gcc, g++ or ar command, as (line
+ * number, command name).
+ */
+using SkippedCommand = pair<int, string>;
+
+/**
+ * Processes a vector of strings containing parts of a GCC or G++ command, and
+ * constructs a GccCommand object from them.
+ *
+ * This function identifies and handles several types of command line options,
+ * including (but not limited to):
+ * - "-c", "-S", and "-E" to determine the command type;
+ * - "-D", "-I", and "-f" to handle definitions, include directories, and some
+ * options;
+ * - "-W", "-m", "-O", and "-g" to handle warnings, target options,
+ * optimizations, and debug options;
+ * - "-L", "-l", and "-o" to handle linker options.
+ *
+ * Each argument is classified with classify_gcc_option(); see kGccOptions for
+ * the full list of options and what is done with each. Arguments that aren't
+ * options are inputs.
+ *
+ * Unhandled or unrecognised options, and options missing their argument,
+ * cause the function to abort and print an error message, unless
+ * 'diagnostics' is given, in which case they are recorded there and ignored.
+ *
+ * @param parts A vector of strings containing parts of a GCC or G++ command.
+ * This is usually obtained by splitting the command line with a
+ * CommandTokenizer.
+ * @param diagnostics If not null, collects the options that were ignored.
+ * @param directories If not null, the directories make was in, which paths
+ * are resolved against; see DirectoryStack::Resolve(). Paths are normalized
+ * either way.
+ *
+ * @return A GccCommand that represents the given command. Its paths are
+ * canonicalized and interned in the global PathTable.
+ *
+ * @note This function assumes that 'parts' is non-empty and that the first
+ * element of 'parts' is "gcc" or "g++". It does not check for this, and the
+ * behaviour is undefined if this is not the case.
+ */
+GccCommand process_gcc_command(const vector<string_view>& parts,
+                               Diagnostics* diagnostics = nullptr,
+                               const DirectoryStack* directories = nullptr);
+
+/**
+ * Processes a vector of strings containing parts of an 'ar' command, and
+ * constructs an ArCommand object from them.
+ *
+ * This function only supports the form 'ar cr <inputs...> <output>', where
+ * '<inputs...>' is one or more input files, and '<output>' is the output file.
+ * Other forms of 'ar' commands are not supported and will cause the function to
+ * abort and print an error message.
+ *
+ * @param parts A vector of strings containing parts of an 'ar' command. This is
+ * usually obtained by splitting the command line with a CommandTokenizer.
+ * @param directories If not null, the directories make was in; see
+ * process_gcc_command().
+ *
+ * @return An ArCommand that represents the given command. Its paths are
+ * canonicalized and interned in the global PathTable.
+ *
+ * @note This function assumes that 'parts' is of the form 'ar cr <inputs...>
+ * <output>'. It does not check for this, and the behaviour is undefined if this
+ * is not the case.
+ */
+ArCommand process_ar_command(const vector<string_view>& parts,
+                             const DirectoryStack* directories = nullptr);
+
+/**
+ * Processes the gcc, g++ or ar command in 'parts' and adds it to 'commands'.
+ *
+ * gcc -S and -E commands, and ar commands of an unsupported form, abort,
+ * unless 'diagnostics' is given, in which case they are recorded there and
+ * left out.
+ *
+ * @param parts The arguments of the command, which must be non-empty.
+ * @param commands The table to add the command to.
+ * @param diagnostics If not null, collects the problems with the command
+ * instead of aborting.
+ * @param directories If not null, the directories make was in; see
+ * process_gcc_command().
+ *
+ * @return false if 'parts' is some other command, which is left out.
+ */
+bool add_command(const vector<string_view>& parts, CommandTable* commands,
+                 Diagnostics* diagnostics = nullptr,
+                 const DirectoryStack* directories = nullptr);
+
+/**
+ * How to parse a build log.
+ */
+struct ParseOptions {
+  // The timestamp at the start of each line is stripped and recorded; see
+  // strip_timestamp().
+  bool timestamped = false;
+  // Problems that would abort are recorded in the diagnostics of each
+  // ParsedChunk instead, and worked around; see add_command(). Otherwise
+  // parsing stops at the first, which abort_on_problem() aborts on.
+  bool keep_going = false;
+};
+
+/**
+ * The commands parsed from one LogChunk, in the order they appear in it.
+ */
+struct ParsedChunk {
+  int lines = 0;
+  CommandTable commands;
+  // Unrecognized commands, with line numbers counted within the chunk.
+  vector<SkippedCommand> skipped_commands;
+  // For a timestamped log, the output of each timestamped line, or the empty
+  // path if it built nothing, and when it started.
+  vector<pair<PathId, double>> starts;
+  // With keep_going, the problems worked around, on lines counted from 1
+  // within the chunk. Otherwise the problems on the line parsing stopped at.
+  Diagnostics diagnostics;
+  // Without keep_going, parsing stopped at a problem on the line after the
+  // chunk's 'lines'; see abort_on_problem().
+  bool stopped = false;
+  // The directories make is in at the end of the chunk.
+  DirectoryStack directories;
+};
+
+/**
+ * Splits a chunk of the build log into logical lines, and parses each line
+ * into a row of a CommandTable.
+ *
+ * Chunks are independent of each other once the directory each starts in is
+ * known (see chunk_directories()), so this can run on several chunks
+ * concurrently. Nothing is printed for unrecognized commands; they are
+ * recorded in the result so the caller can report them in log order. The
+ * lines where make enters or leaves a directory aren't commands, and change
+ * the directory paths are resolved against.
+ *
+ * @param chunk A chunk of the build log, as returned by LogSource::NextChunk().
+ * @param options How to parse it.
+ * @param directories The directories make is in at the start of the chunk.
+ *
+ * @return The commands found in 'chunk'.
+ */
+ParsedChunk parse_chunk(string_view chunk,
+                        const ParseOptions& options = ParseOptions(),
+                        const DirectoryStack& directories = DirectoryStack());
+
+/**
+ * Works out the directories make is in at the start of each of a run of
+ * consecutive chunks of the log, by scanning them in parallel for the lines
+ * where it changes directory.
+ *
+ * @param chunks The chunks.
+ * @param n The number of chunks.
+ * @param pool The threads to scan with.
+ * @param timestamped If true, lines may start with timestamps.
+ * @param directories The directories at the start of the first chunk. It is
+ * advanced to the end of the last.
+ * @param starts Receives the directories at the start of each chunk.
+ */
+void chunk_directories(const LogChunk* chunks, size_t n, ThreadPool* pool,
+                       bool timestamped, DirectoryStack* directories,
+                       vector<DirectoryStack>* starts);
+
+/**
+ * Appends a parsed chunk to the commands parsed before it, and prints and
+ * records its skipped commands with their line numbers in the whole log. If
+ * parsing the chunk stopped at a problem, aborts on it after that.
+ *
+ * @param parsed The chunk, which is left empty.
+ * @param line The number of the chunk's first line in the log. It is advanced
+ * to the line after the chunk.
+ * @param commands The commands of the chunks before this one.
+ * @param skipped_commands The skipped commands of the chunks before this one.
+ * @param timings If not null, the chunk's commands are timed from its
+ * timestamps.
+ * @param diagnostics If not null, receives the chunk's diagnostics, with
+ * their line numbers in the whole log.
+ */
+void merge_chunk(ParsedChunk* parsed, int* line, CommandTable* commands,
+                 vector<SkippedCommand>* skipped_commands,
+                 CommandTimings* timings = nullptr,
+                 Diagnostics* diagnostics = nullptr);
+
+/**
+ * If parsing 'parsed' stopped at a problem, prints it as add_command() would
+ * have without diagnostics, and aborts.
+ */
+void abort_on_problem(const ParsedChunk& parsed);
+
+/**
+ * Prints the message for a line of the log that was skipped.
+ */
+void print_skipped_command(const SkippedCommand& skipped);
+
+/**
+ * Parses a whole build log into a CommandTable.
+ *
+ * Chunks are parsed a batch at a time, in parallel on threads started once
+ * for the whole log, and then merged in log order so the result doesn't
+ * depend on the number of jobs. Skipped commands, and the problem that aborts
+ * without 'diagnostics', are reported as they are merged.
+ *
+ * @param source The build log.
+ * @param jobs The number of threads to parse with.
+ * @param commands Receives the parsed commands.
+ * @param skipped_commands Receives the lines that weren't gcc, g++ or ar
+ * commands.
+ * @param content_hash If not null, every byte of the log is fed to it.
+ * @param timings If not null, the log's lines start with timestamps, which are
+ * stripped and used to time its commands; see CommandTimings::AddStart().
+ * @param diagnostics If not null, the log is parsed in one pass whatever is
+ * wrong with it: problems that would abort are collected here instead, and
+ * the commands they are in are skipped or approximated.
+ */
+void parse_log(LogSource* source, int jobs, CommandTable* commands,
+               vector<SkippedCommand>* skipped_commands,
+               ContentHash* content_hash, CommandTimings* timings = nullptr,
+               Diagnostics* diagnostics = nullptr);
+
+#endif  // REVERSE_MAKE_PARSE_H__
@@ -0,0 +1,90 @@
+#include "reverse-make/paths.h"
+
+#include <vector>
+
+namespace {
+
+/**
+ * Returns true if normalize_path() would leave 'path', which isn't empty,
+ * alone.
+ */
+bool is_normal_path(string_view path) {
+  if (path == "/") {
+    return true;
+  }
+  size_t start = path[0] == '/' ? 1 : 0;
+  // Whether every component so far has been "..", which a relative path may
+  // start with.
+  bool leading = start == 0;
+  while (true) {
+    size_t end = path.find('/', start);
+    if (end == string_view::npos) {
+      end = path.size();
+    }
+    string_view component = path.substr(start, end - start);
+    if (component.empty() || component == ".") {
+      return false;
+    }
+    if (component == "..") {
+      if (!leading) {
+        return false;
+      }
+    } else {
+      leading = false;
+    }
+    if (end == path.size()) {
+      return true;
+    }
+    start = end + 1;
+  }
+}
+
+}  // namespace
+
+PathTable& PathTable::Global() {
+  static PathTable table;
+  return table;
+}
+
+string_view normalize_path(string_view path, string* scratch) {
+  if (path.empty() || path == "." || is_normal_path(path)) {
+    return path;
+  }
+  static thread_local vector<string_view> components;
+  components.clear();
+  bool absolute = path[0] == '/';
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t end = path.find('/', start);
+    if (end == string_view::npos) {
+      end = path.size();
+    }
+    string_view component = path.substr(start, end - start);
+    start = end + 1;
+    if (component.empty() || component == ".") {
+      continue;
+    }
+    if (component != "..") {
+      components.push_back(component);
+    } else if (!components.empty() && components.back() != "..") {
+      components.pop_back();
+    } else if (!absolute) {
+      components.push_back(component);
+    }
+  }
+
+  scratch->clear();
+  if (absolute) {
+    scratch->push_back('/');
+  }
+  for (size_t i = 0; i < components.size(); i++) {
+    if (i > 0) {
+      scratch->push_back('/');
+    }
+    scratch->append(components[i]);
+  }
+  if (scratch->empty()) {
+    scratch->push_back('.');
+  }
+  return *scratch;
+}
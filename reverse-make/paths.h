@@ -0,0 +1,52 @@
+#ifndef REVERSE_MAKE_PATHS_H__
+#define REVERSE_MAKE_PATHS_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "reverse-make/interner.h"
+
+using namespace std;
+
+/**
+ * The ID of a path interned in the PathTable.
+ */
+using PathId = uint32_t;
+
+/**
+ * Maps each distinct path to a dense PathId. Commands refer to their inputs
+ * and outputs by ID, so looking a file up is an integer hash probe rather than
+ * a string comparison.
+ *
+ * Paths from build logs are canonicalized before they are interned (see
+ * normalize_path() and DirectoryStack), so that "./src/a.o" and "src/a.o" get
+ * the same ID.
+ */
+class PathTable : public StringInterner {
+ public:
+  /**
+   * Returns the table shared by the whole program.
+   */
+  static PathTable& Global();
+};
+
+/**
+ * Normalizes 'path' lexically, without looking at the file system: empty and
+ * "." components and trailing slashes are removed, and each ".." component is
+ * removed along with the component before it. A relative path keeps its
+ * leading ".." components, and one that comes to nothing is "."; an absolute
+ * path loses them. The empty path stays empty.
+ *
+ * For example, "./src//lib/../a.o" becomes "src/a.o".
+ *
+ * @param path The path.
+ * @param scratch Holds the normalized path, if it differs from 'path'. It
+ * mustn't be what 'path' points into.
+ *
+ * @return 'path' itself if it is already normal, and otherwise a view of
+ * 'scratch'.
+ */
+string_view normalize_path(string_view path, string* scratch);
+
+#endif  // REVERSE_MAKE_PATHS_H__
@@ -0,0 +1,124 @@
+#include "reverse-make/pic_twins.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <unordered_map>
+
+#include "reverse-make/hash.h"
+
+namespace {
+
+/**
+ * Everything a compile is compiled with but its PIC flags, and its source.
+ */
+struct TwinKey {
+  PathId source;
+  GccCommand::Compiler compiler;
+  array<FlagSetId, kNumFlagFields> flags;
+
+  bool operator==(const TwinKey& other) const {
+    return source == other.source && compiler == other.compiler &&
+           flags == other.flags;
+  }
+};
+
+struct TwinKeyHash {
+  size_t operator()(const TwinKey& key) const {
+    WordHash hash;
+    hash.Mix(key.source);
+    hash.Mix(key.compiler);
+    for (FlagSetId id : key.flags) {
+      hash.Mix(id);
+    }
+    return hash.hash();
+  }
+};
+
+/**
+ * Returns 'flags' as a FlagSet.
+ */
+FlagSet make_flag_set(const vector<uint32_t>& flags) {
+  FlagSet set;
+  for (uint32_t flag : flags) {
+    set.insert(FlagInterner::Global().Lookup(flag));
+  }
+  return set;
+}
+
+}  // namespace
+
+PicTwins::PicTwins(const CommandTable& commands,
+                   const vector<string>& pic_flags)
+    : primaries_(commands.size()), deltas_(commands.size(), 0) {
+  FlagSetTable& flag_sets = FlagSetTable::Global();
+  vector<uint32_t> pic_ids;
+  for (const string& flag : pic_flags) {
+    pic_ids.push_back(FlagInterner::Global().Intern(flag));
+  }
+  sort(pic_ids.begin(), pic_ids.end());
+
+  // Each distinct flag set without its PIC flags, and the PIC flags it had.
+  struct Stripped {
+    FlagSetId rest;
+    vector<uint32_t> pic;
+  };
+  unordered_map<FlagSetId, Stripped> stripped;
+  auto strip = [&](FlagSetId id) -> const Stripped& {
+    auto [it, is_new] = stripped.try_emplace(id);
+    if (is_new) {
+      vector<uint32_t> rest;
+      for (uint32_t flag : flag_sets.Lookup(id).ids()) {
+        bool pic = binary_search(pic_ids.begin(), pic_ids.end(), flag);
+        (pic ? it->second.pic : rest).push_back(flag);
+      }
+      it->second.rest =
+          it->second.pic.empty() ? id : flag_sets.Intern(make_flag_set(rest));
+    }
+    return it->second;
+  };
+
+  // The key and PIC flags of each single-source compile.
+  vector<TwinKey> keys(commands.size());
+  vector<vector<uint32_t>> pics(commands.size());
+  unordered_map<TwinKey, RowId, TwinKeyHash> primaries;
+  primaries.reserve(commands.Count(CommandKind::COMPILE));
+  for (RowId row = 0; row < commands.size(); row++) {
+    primaries_[row] = row;
+    if (commands.kind(row) != CommandKind::COMPILE ||
+        commands.inputs(row).size() != 1) {
+      continue;
+    }
+    TwinKey& key = keys[row];
+    key.source = commands.inputs(row)[0];
+    key.compiler = commands.compiler(row);
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      const Stripped& flags = strip(commands.flags(row, FlagField(field)));
+      key.flags[field] = flags.rest;
+      pics[row].insert(pics[row].end(), flags.pic.begin(), flags.pic.end());
+    }
+    if (pics[row].empty()) {
+      primaries.emplace(key, row);
+    }
+  }
+
+  // Most twins have the same PIC flags, so each distinct set is interned once.
+  map<vector<uint32_t>, FlagSetId> deltas;
+  for (RowId row = 0; row < commands.size(); row++) {
+    if (pics[row].empty()) {
+      continue;
+    }
+    auto it = primaries.find(keys[row]);
+    if (it == primaries.end()) {
+      continue;
+    }
+    sort(pics[row].begin(), pics[row].end());
+    auto [delta, is_new] = deltas.try_emplace(pics[row]);
+    if (is_new) {
+      delta->second = flag_sets.Intern(make_flag_set(pics[row]));
+    }
+    primaries_[row] = it->second;
+    deltas_[row] = delta->second;
+    num_twins_++;
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef REVERSE_MAKE_PIC_TWINS_H__
+#define REVERSE_MAKE_PIC_TWINS_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/flags.h"
+
+using namespace std;
+
+/**
+ * The compile commands that are PIC twins of others.
+ *
+ * libtool, and builds like it, compile every source twice: once as is for the
+ * static library, and once with -fPIC -DPIC for the shared one. A twin is a
+ * compile of the same source, by the same compiler, with exactly the same
+ * flags plus some of the PIC flags. Its primary is the first compile of that
+ * source with none of them.
+ */
+class PicTwins {
+ public:
+  using RowId = CommandTable::RowId;
+
+  /**
+   * Finds the twins among the compile commands of 'commands'.
+   *
+   * @param commands The commands of the build.
+   * @param pic_flags The flags a twin may have on top of its primary's, such
+   * as "-fPIC" and "-DPIC".
+   */
+  PicTwins(const CommandTable& commands, const vector<string>& pic_flags);
+
+  /**
+   * Returns the row 'row' is a twin of, or 'row' itself if it isn't a twin.
+   */
+  RowId primary(RowId row) const { return primaries_[row]; }
+
+  /**
+   * Returns the PIC flags 'row' has on top of those of its primary; the empty
+   * set if it isn't a twin.
+   */
+  FlagSetId delta(RowId row) const { return deltas_[row]; }
+
+  /**
+   * Returns the number of twins.
+   */
+  size_t size() const { return num_twins_; }
+
+ private:
+  vector<RowId> primaries_;
+  vector<FlagSetId> deltas_;
+  size_t num_twins_ = 0;
+};
+
+#endif  // REVERSE_MAKE_PIC_TWINS_H__
@@ -0,0 +1,865 @@
+#include "reverse-make/report.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include "reverse-make/json.h"
+#include "reverse-make/parallel.h"
+
+/* Format a FlagSet the way fmt formats a set<string>: quoted flags in sorted
+ * order, e.g. {"-O2", "-g"}.
+ */
+template <>
+struct fmt::formatter<FlagSet> : fmt::formatter<set<string_view>> {
+  template <typename FormatContext>
+  auto format(const FlagSet& flags, FormatContext& ctx) {
+    set<string_view> strings;
+    for (uint32_t id : flags.ids()) {
+      strings.insert(FlagInterner::Global().Lookup(id));
+    }
+    return fmt::formatter<set<string_view>>::format(strings, ctx);
+  }
+};
+
+namespace {
+
+constexpr char kGeneratedTarget[] = "reverse-make-generated-target.a";
+
+/**
+ * Returns the rows of kind 'kind', each with its grouped dependencies.
+ */
+vector<TargetReport> report_targets(const CommandTable& commands,
+                                    const FlagGroups& flag_groups,
+                                    CommandKind kind, Diagnostics* diagnostics,
+                                    const PicTwins* twins) {
+  vector<TargetReport> targets;
+  for (auto row : commands.SortedRows(kind)) {
+    targets.push_back(
+        {row, find_deps(sorted_dependencies(commands.inputs(row)), commands,
+                        flag_groups, diagnostics, twins)});
+  }
+  return targets;
+}
+
+/**
+ * Points each group of PIC twins at the group of their primaries, if it is
+ * reported before them, in the order print_report() prints groups.
+ */
+void link_twin_groups(const PicTwins& twins, Report* report) {
+  using RowId = CommandTable::RowId;
+  // The groups without PIC flags, by their sorted rows.
+  map<vector<RowId>, pair<RowId, size_t>> primary_groups;
+  for (auto* targets : {&report->ar_targets, &report->link_targets}) {
+    for (TargetReport& target : *targets) {
+      for (size_t i = 0; i < target.groups.size(); i++) {
+        DependencyGroup& group = target.groups[i];
+        vector<RowId> primaries;
+        for (RowId row : group.rows) {
+          primaries.push_back(twins.primary(row));
+        }
+        sort(primaries.begin(), primaries.end());
+        if (group.variant == 0) {
+          primary_groups.emplace(move(primaries), make_pair(target.target, i));
+          continue;
+        }
+        auto it = primary_groups.find(primaries);
+        if (it != primary_groups.end()) {
+          group.twin_target = it->second.first;
+          group.twin_group = it->second.second;
+        }
+      }
+    }
+  }
+}
+
+using Buffer = fmt::memory_buffer;
+
+constexpr char kRule[] =
+    "----------------------------------------------------\n";
+
+/**
+ * Appends 'str' to 'out'.
+ */
+void append(string_view str, Buffer* out) {
+  out->append(str.data(), str.data() + str.size());
+}
+
+/**
+ * Appends 'value' to 'out' as an unsigned LEB128 varint: seven bits a byte,
+ * low bits first, with the top bit set on every byte but the last.
+ */
+void append_varint(uint64_t value, Buffer* out) {
+  while (value >= 0x80) {
+    out->push_back(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(char(value));
+}
+
+/**
+ * Returns the IDs of the flags of 'flags', sorted by flag.
+ */
+vector<uint32_t> sorted_flags(const FlagSet& flags) {
+  FlagInterner& interner = FlagInterner::Global();
+  vector<uint32_t> ids(flags.ids().begin(), flags.ids().end());
+  sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) {
+    return interner.Lookup(a) < interner.Lookup(b);
+  });
+  return ids;
+}
+
+/**
+ * Returns the i-th target in print order: the ar targets, then the link
+ * targets.
+ */
+const TargetReport& nth_target(const Report& report, size_t i,
+                               bool* is_link) {
+  *is_link = i >= report.ar_targets.size();
+  return *is_link ? report.link_targets[i - report.ar_targets.size()]
+                  : report.ar_targets[i];
+}
+
+/**
+ * Returns every flag set the report shows, sorted, starting with the empty
+ * set.
+ */
+vector<FlagSetId> shown_flag_sets(const CommandTable& commands,
+                                  const Report& report) {
+  vector<FlagSetId> ids = {0};
+  for (auto* targets : {&report.ar_targets, &report.link_targets}) {
+    for (const TargetReport& target : *targets) {
+      for (size_t field = 0; field < kNumFlagFields; field++) {
+        ids.push_back(commands.flags(target.target, FlagField(field)));
+      }
+      for (const DependencyGroup& group : target.groups) {
+        for (size_t field = 0; field < kNumFlagFields; field++) {
+          ids.push_back(
+              commands.flags(group.example_gcc_command, FlagField(field)));
+        }
+        ids.push_back(group.variant);
+      }
+    }
+  }
+  sort(ids.begin(), ids.end());
+  ids.erase(unique(ids.begin(), ids.end()), ids.end());
+  return ids;
+}
+
+/**
+ * Renders each flag set in 'ids' once, on up to 'jobs' threads, since most
+ * are shown by many groups.
+ *
+ * @return The text of each, indexed by FlagSetId.
+ */
+template <typename Render>
+vector<string> render_flag_sets(const vector<FlagSetId>& ids, int jobs,
+                                Render render) {
+  vector<string> texts(ids.back() + 1);
+  parallel_for(ids.size(), jobs, [&](size_t i) {
+    texts[ids[i]] = render(FlagSetTable::Global().Lookup(ids[i]));
+  });
+  return texts;
+}
+
+/**
+ * Writes 'buffers' to 'out' in order, each with one write.
+ */
+bool write_buffers(const vector<Buffer>& buffers, FILE* out) {
+  for (const Buffer& buffer : buffers) {
+    if (buffer.size() > 0 &&
+        fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Renders the dependency groups of a target as text.
+ */
+void render_text_groups(const CommandTable& commands,
+                        const vector<DependencyGroup>& groups,
+                        const vector<string>& flag_texts, Buffer* out) {
+  PathTable& paths = PathTable::Global();
+  auto it = back_inserter(*out);
+  append("  Found the following group(s) of matching source dependencies:\n",
+         out);
+  int group_num = 0;
+  for (auto& group : groups) {
+    if (group.sources.size() == 0) {
+      append("  Group sources is empty!\n", out);
+      continue;
+    }
+    if (group.twin_target != CommandTable::kNoRow) {
+      fmt::format_to(it,
+                     "    Group {} depending on {} source dependencies: the "
+                     "PIC twins of group {} of {}, compiled with the same "
+                     "flags and {}\n",
+                     group_num, group.sources.size(), group.twin_group,
+                     paths.Lookup(commands.output(group.twin_target)),
+                     flag_texts[group.variant]);
+      group_num++;
+      continue;
+    }
+
+    vector<string_view> sources;
+    for (PathId source : group.sources) {
+      sources.push_back(paths.Lookup(source));
+    }
+    fmt::format_to(it, "    Group {} depending on {} source dependencies: {}\n",
+                   group_num, sources.size(), sources);
+    append("    Compiled with the following flags:\n", out);
+    auto representative_input = group.example_gcc_command;
+    fmt::format_to(it, "      compiler: {}\n",
+                   GccCommand::CompilerAsString(
+                       commands.compiler(representative_input)));
+    fmt::format_to(it, "      command: {}\n",
+                   GccCommand::CommandAsString(
+                       commands.command(representative_input)));
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      fmt::format_to(
+          it, "      {}: {}\n", kFlagFieldNames[field],
+          flag_texts[commands.flags(representative_input, FlagField(field))]);
+    }
+    if (group.variant != 0) {
+      fmt::format_to(it, "      pic_variant: {}\n", flag_texts[group.variant]);
+    }
+    if (!group.headers.empty()) {
+      vector<string_view> headers;
+      for (PathId header : group.headers) {
+        headers.push_back(paths.Lookup(header));
+      }
+      fmt::format_to(it, "    Including {} headers: {}\n", headers.size(),
+                     headers);
+    }
+
+    group_num++;
+  }
+}
+
+/**
+ * Renders a target and its dependency groups as text.
+ */
+void render_text_target(const CommandTable& commands,
+                        const TargetReport& target, bool is_link,
+                        const vector<string>& flag_texts, Buffer* out) {
+  PathTable& paths = PathTable::Global();
+  auto it = back_inserter(*out);
+  PathList inputs = commands.inputs(target.target);
+  append(kRule, out);
+  fmt::format_to(it, "{}: {} has {} dependencies: ",
+                 is_link ? "gcc link target" : "ar archive target",
+                 paths.Lookup(commands.output(target.target)), inputs.size());
+  const char* separator = "";
+  for (PathId input : inputs) {
+    append(separator, out);
+    append(paths.Lookup(input), out);
+    separator = ", ";
+  }
+  append(is_link ? "\n" : ".\n", out);
+  append(kRule, out);
+
+  if (is_link) {
+    append("  Linked with the following flags:\n", out);
+    for (FlagField field : {FlagField::LINKOPTS, FlagField::LINK_SEARCH_DIRS,
+                            FlagField::LINK_LIBS}) {
+      fmt::format_to(it, "    {}: {}\n", kFlagFieldNames[size_t(field)],
+                     flag_texts[commands.flags(target.target, field)]);
+    }
+  }
+  render_text_groups(commands, target.groups, flag_texts, out);
+}
+
+bool write_text_report(const CommandTable& commands, const Report& report,
+                       int jobs, FILE* out) {
+  PathTable& paths = PathTable::Global();
+  vector<string> flag_texts = render_flag_sets(
+      shown_flag_sets(commands, report), jobs,
+      [](const FlagSet& flags) { return fmt::format("{}", flags); });
+
+  // The notes, each target, then the headers.
+  size_t num_targets = report.ar_targets.size() + report.link_targets.size();
+  vector<Buffer> buffers(num_targets + 2);
+  auto it = back_inserter(buffers.front());
+  if (report.generated_target) {
+    fmt::format_to(it,
+                   "NOTE: No link commands found. Creating ar target "
+                   "\"{}\" with all found sources as dependencies.\n",
+                   kGeneratedTarget);
+  }
+  if (report.pic_twins > 0) {
+    fmt::format_to(it,
+                   "NOTE: Folded {} PIC twin compiles into the compiles they "
+                   "are twins of.\n",
+                   report.pic_twins);
+  }
+
+  parallel_for(num_targets, jobs, [&](size_t i) {
+    bool is_link;
+    const TargetReport& target = nth_target(report, i, &is_link);
+    render_text_target(commands, target, is_link, flag_texts, &buffers[i + 1]);
+  });
+
+  if (report.has_headers) {
+    Buffer* headers = &buffers.back();
+    it = back_inserter(*headers);
+    append(kRule, headers);
+    fmt::format_to(it,
+                   "Most included headers ({} sources, {} source/header "
+                   "dependencies):\n",
+                   report.header_sources, report.header_edges);
+    append(kRule, headers);
+    for (auto& [header, count] : report.most_included_headers) {
+      fmt::format_to(it, "  {:>6} {}\n", count, paths.Lookup(header));
+    }
+  }
+  return write_buffers(buffers, out);
+}
+
+/**
+ * Appends the paths in [begin, end) to 'out' as a JSON array.
+ */
+void append_json_paths(const PathId* begin, const PathId* end, Buffer* out) {
+  out->push_back('[');
+  for (const PathId* path = begin; path != end; path++) {
+    if (path != begin) {
+      append(", ", out);
+    }
+    append_json_string(PathTable::Global().Lookup(*path), out);
+  }
+  out->push_back(']');
+}
+
+void append_json_paths(const vector<PathId>& paths, Buffer* out) {
+  append_json_paths(paths.data(), paths.data() + paths.size(), out);
+}
+
+/**
+ * Renders a target and its dependency groups as a JSON object.
+ */
+void render_json_target(const CommandTable& commands,
+                        const TargetReport& target, bool is_link,
+                        const vector<string>& flag_texts, Buffer* out) {
+  PathTable& paths = PathTable::Global();
+  auto it = back_inserter(*out);
+  PathList inputs = commands.inputs(target.target);
+  fmt::format_to(it, "{{\"kind\": \"{}\", \"target\": ",
+                 is_link ? "link" : "ar");
+  append_json_string(paths.Lookup(commands.output(target.target)), out);
+  append(", \"dependencies\": ", out);
+  append_json_paths(inputs.begin(), inputs.end(), out);
+  if (is_link) {
+    const char* separator = ", \"link_flags\": {";
+    for (FlagField field : {FlagField::LINKOPTS, FlagField::LINK_SEARCH_DIRS,
+                            FlagField::LINK_LIBS}) {
+      fmt::format_to(it, "{}\"{}\": {}", separator,
+                     kFlagFieldNames[size_t(field)],
+                     flag_texts[commands.flags(target.target, field)]);
+      separator = ", ";
+    }
+    out->push_back('}');
+  }
+
+  append(", \"groups\": [", out);
+  for (size_t i = 0; i < target.groups.size(); i++) {
+    const DependencyGroup& group = target.groups[i];
+    append(i > 0 ? ",\n    {\"sources\": " : "\n    {\"sources\": ", out);
+    append_json_paths(group.sources, out);
+    if (group.twin_target != CommandTable::kNoRow) {
+      fmt::format_to(it, ", \"pic_variant\": {}, \"twin_of\": {{\"target\": ",
+                     flag_texts[group.variant]);
+      append_json_string(paths.Lookup(commands.output(group.twin_target)),
+                         out);
+      fmt::format_to(it, ", \"group\": {}}}}}", group.twin_group);
+      continue;
+    }
+    auto row = group.example_gcc_command;
+    fmt::format_to(it, ", \"compiler\": \"{}\", \"command\": \"{}\"",
+                   GccCommand::CompilerAsString(commands.compiler(row)),
+                   GccCommand::CommandAsString(commands.command(row)));
+    const char* separator = ", \"flags\": {";
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      fmt::format_to(it, "{}\"{}\": {}", separator, kFlagFieldNames[field],
+                     flag_texts[commands.flags(row, FlagField(field))]);
+      separator = ", ";
+    }
+    out->push_back('}');
+    if (group.variant != 0) {
+      fmt::format_to(it, ", \"pic_variant\": {}", flag_texts[group.variant]);
+    }
+    if (!group.headers.empty()) {
+      append(", \"headers\": ", out);
+      append_json_paths(group.headers, out);
+    }
+    out->push_back('}');
+  }
+  append("]}", out);
+}
+
+bool write_json_report(const CommandTable& commands, const Report& report,
+                       int jobs, FILE* out) {
+  vector<string> flag_texts =
+      render_flag_sets(shown_flag_sets(commands, report), jobs,
+                       [](const FlagSet& flags) {
+                         string text = "[";
+                         for (uint32_t flag : sorted_flags(flags)) {
+                           if (text.size() > 1) {
+                             text += ", ";
+                           }
+                           append_json_string(
+                               FlagInterner::Global().Lookup(flag), &text);
+                         }
+                         return text + "]";
+                       });
+
+  size_t num_targets = report.ar_targets.size() + report.link_targets.size();
+  vector<Buffer> buffers(num_targets + 2);
+  fmt::format_to(back_inserter(buffers.front()),
+                 "{{\"generated_target\": {}, \"pic_twins\": {}, "
+                 "\"targets\": [",
+                 report.generated_target, report.pic_twins);
+  parallel_for(num_targets, jobs, [&](size_t i) {
+    bool is_link;
+    const TargetReport& target = nth_target(report, i, &is_link);
+    append(i > 0 ? ",\n  " : "\n  ", &buffers[i + 1]);
+    render_json_target(commands, target, is_link, flag_texts, &buffers[i + 1]);
+  });
+
+  Buffer* end = &buffers.back();
+  append("]", end);
+  if (report.has_headers) {
+    fmt::format_to(back_inserter(*end),
+                   ",\n \"headers\": {{\"sources\": {}, \"edges\": {}, "
+                   "\"most_included\": [",
+                   report.header_sources, report.header_edges);
+    const char* separator = "";
+    for (auto& [header, count] : report.most_included_headers) {
+      append(separator, end);
+      append("{\"header\": ", end);
+      append_json_string(PathTable::Global().Lookup(header), end);
+      fmt::format_to(back_inserter(*end), ", \"count\": {}}}", count);
+      separator = ", ";
+    }
+    append("]}", end);
+  }
+  append("}\n", end);
+  return write_buffers(buffers, out);
+}
+
+/**
+ * The strings and flag sets of the binary format, each numbered in order of
+ * first use, walking the report in print order. The IDs of the interned
+ * paths, flags and flag sets depend on which thread interned them first, so
+ * nothing is numbered by ID; the output doesn't depend on 'jobs'.
+ */
+class BinaryTables {
+ public:
+  BinaryTables(const CommandTable& commands, const Report& report)
+      : path_index_(PathTable::Global().size(), kNone),
+        flag_index_(FlagInterner::Global().size(), kNone),
+        set_index_(FlagSetTable::Global().size(), kNone) {
+    AddFlagSet(0);
+    for (auto* targets : {&report.ar_targets, &report.link_targets}) {
+      for (const TargetReport& target : *targets) {
+        for (size_t field = 0; field < kNumFlagFields; field++) {
+          AddFlagSet(commands.flags(target.target, FlagField(field)));
+        }
+        for (const DependencyGroup& group : target.groups) {
+          for (size_t field = 0; field < kNumFlagFields; field++) {
+            AddFlagSet(
+                commands.flags(group.example_gcc_command, FlagField(field)));
+          }
+          AddFlagSet(group.variant);
+        }
+      }
+    }
+    for (auto* targets : {&report.ar_targets, &report.link_targets}) {
+      for (const TargetReport& target : *targets) {
+        AddPath(commands.output(target.target));
+        for (PathId input : commands.inputs(target.target)) {
+          AddPath(input);
+        }
+        for (const DependencyGroup& group : target.groups) {
+          for (PathId source : group.sources) {
+            AddPath(source);
+          }
+          for (PathId header : group.headers) {
+            AddPath(header);
+          }
+          auto row = group.example_gcc_command;
+          AddName(GccCommand::CompilerAsString(commands.compiler(row)));
+          AddName(GccCommand::CommandAsString(commands.command(row)));
+        }
+      }
+    }
+    for (auto& [header, count] : report.most_included_headers) {
+      AddPath(header);
+    }
+  }
+
+  uint32_t path(PathId path) const { return path_index_[path]; }
+  uint32_t flag_set(FlagSetId id) const { return set_index_[id]; }
+  uint32_t name(const string& name) const { return names_.at(name); }
+
+  /**
+   * Appends the strings and the flag sets.
+   */
+  void Write(Buffer* out) const {
+    append_varint(strings_.size(), out);
+    for (string_view str : strings_) {
+      append_varint(str.size(), out);
+      append(str, out);
+    }
+    append_varint(sets_.size(), out);
+    for (FlagSetId id : sets_) {
+      vector<uint32_t> flags = sorted_flags(FlagSetTable::Global().Lookup(id));
+      append_varint(flags.size(), out);
+      for (uint32_t flag : flags) {
+        append_varint(flag_index_[flag], out);
+      }
+    }
+  }
+
+ private:
+  static constexpr uint32_t kNone = ~uint32_t(0);
+
+  uint32_t AddString(string_view str) {
+    strings_.push_back(str);
+    return strings_.size() - 1;
+  }
+
+  // Numbers the set, and its flags in the order they are shown.
+  void AddFlagSet(FlagSetId id) {
+    if (set_index_[id] != kNone) {
+      return;
+    }
+    set_index_[id] = sets_.size();
+    sets_.push_back(id);
+    for (uint32_t flag : sorted_flags(FlagSetTable::Global().Lookup(id))) {
+      if (flag_index_[flag] == kNone) {
+        flag_index_[flag] = AddString(FlagInterner::Global().Lookup(flag));
+      }
+    }
+  }
+
+  void AddPath(PathId path) {
+    if (path_index_[path] == kNone) {
+      path_index_[path] = AddString(PathTable::Global().Lookup(path));
+    }
+  }
+
+  void AddName(string name) {
+    auto [it, is_new] = names_.try_emplace(move(name), strings_.size());
+    if (is_new) {
+      AddString(it->first);
+    }
+  }
+
+  // Views of the interned paths and flags, and of the keys of names_.
+  vector<string_view> strings_;
+  vector<uint32_t> path_index_;
+  vector<uint32_t> flag_index_;
+  map<string, uint32_t> names_;
+  vector<FlagSetId> sets_;
+  vector<uint32_t> set_index_;
+};
+
+/**
+ * Renders a target and its dependency groups in the binary format.
+ */
+void render_binary_target(const CommandTable& commands,
+                          const TargetReport& target, bool is_link,
+                          const BinaryTables& tables,
+                          const unordered_map<CommandTable::RowId, size_t>&
+                              target_index,
+                          Buffer* out) {
+  PathList inputs = commands.inputs(target.target);
+  append_varint(is_link ? 1 : 0, out);
+  append_varint(tables.path(commands.output(target.target)), out);
+  append_varint(inputs.size(), out);
+  for (PathId input : inputs) {
+    append_varint(tables.path(input), out);
+  }
+  if (is_link) {
+    for (FlagField field : {FlagField::LINKOPTS, FlagField::LINK_SEARCH_DIRS,
+                            FlagField::LINK_LIBS}) {
+      append_varint(tables.flag_set(commands.flags(target.target, field)), out);
+    }
+  }
+  append_varint(target.groups.size(), out);
+  for (const DependencyGroup& group : target.groups) {
+    append_varint(group.sources.size(), out);
+    for (PathId source : group.sources) {
+      append_varint(tables.path(source), out);
+    }
+    auto row = group.example_gcc_command;
+    append_varint(
+        tables.name(GccCommand::CompilerAsString(commands.compiler(row))), out);
+    append_varint(
+        tables.name(GccCommand::CommandAsString(commands.command(row))), out);
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      append_varint(tables.flag_set(commands.flags(row, FlagField(field))),
+                    out);
+    }
+    append_varint(tables.flag_set(group.variant), out);
+    if (group.twin_target == CommandTable::kNoRow) {
+      append_varint(0, out);
+    } else {
+      append_varint(1 + target_index.at(group.twin_target), out);
+      append_varint(group.twin_group, out);
+    }
+    append_varint(group.headers.size(), out);
+    for (PathId header : group.headers) {
+      append_varint(tables.path(header), out);
+    }
+  }
+}
+
+bool write_binary_report(const CommandTable& commands, const Report& report,
+                         int jobs, FILE* out) {
+  BinaryTables tables(commands, report);
+  size_t num_targets = report.ar_targets.size() + report.link_targets.size();
+  unordered_map<CommandTable::RowId, size_t> target_index;
+  for (size_t i = 0; i < num_targets; i++) {
+    bool is_link;
+    target_index.emplace(nth_target(report, i, &is_link).target, i);
+  }
+
+  vector<Buffer> buffers(num_targets + 2);
+  Buffer* start = &buffers.front();
+  append("RMKR", start);
+  append_varint(1, start);
+  tables.Write(start);
+  append_varint(report.generated_target ? 1 : 0, start);
+  append_varint(report.pic_twins, start);
+  append_varint(num_targets, start);
+  parallel_for(num_targets, jobs, [&](size_t i) {
+    bool is_link;
+    const TargetReport& target = nth_target(report, i, &is_link);
+    render_binary_target(commands, target, is_link, tables, target_index,
+                         &buffers[i + 1]);
+  });
+
+  Buffer* end = &buffers.back();
+  append_varint(report.has_headers ? 1 : 0, end);
+  if (report.has_headers) {
+    append_varint(report.header_sources, end);
+    append_varint(report.header_edges, end);
+    append_varint(report.most_included_headers.size(), end);
+    for (auto& [header, count] : report.most_included_headers) {
+      append_varint(tables.path(header), end);
+      append_varint(count, end);
+    }
+  }
+  return write_buffers(buffers, out);
+}
+
+}  // namespace
+
+vector<PathId> sorted_dependencies(PathList inputs) {
+  PathTable& paths = PathTable::Global();
+  vector<pair<string_view, PathId>> keyed;
+  keyed.reserve(inputs.size());
+  for (PathId input : inputs) {
+    keyed.emplace_back(paths.Lookup(input), input);
+  }
+  sort(keyed.begin(), keyed.end());
+  vector<PathId> dependencies;
+  dependencies.reserve(keyed.size());
+  for (auto& [path, id] : keyed) {
+    if (dependencies.empty() || dependencies.back() != id) {
+      dependencies.push_back(id);
+    }
+  }
+  return dependencies;
+}
+
+vector<DependencyGroup> find_deps(const vector<PathId>& dependencies,
+                                  const CommandTable& commands,
+                                  const FlagGroups& flag_groups,
+                                  Diagnostics* diagnostics,
+                                  const PicTwins* twins) {
+  PathTable& paths = PathTable::Global();
+
+  // Dependencies that aren't built by anything we know of are only an error
+  // if there are sources to group.
+  bool has_source_dependency = false;
+  for (PathId dependency : dependencies) {
+    if (commands.Find(CommandKind::COMPILE, dependency) !=
+        CommandTable::kNoRow) {
+      has_source_dependency = true;
+      break;
+    }
+  }
+
+  // For each dependency...
+  vector<DependencyGroup> match_groups;
+  // Indices into match_groups, by their FlagGroups::GroupId and, with PIC
+  // twins folded, the FlagSetId of their PIC flags.
+  unordered_map<uint64_t, size_t> target_groups;
+  for (PathId dependency : dependencies) {
+    auto input = commands.Find(CommandKind::COMPILE, dependency);
+    if (input == CommandTable::kNoRow) {
+      if (!has_source_dependency) {
+        // not a source input.
+        continue;
+      }
+      if (commands.Find(CommandKind::LINK, dependency) !=
+              CommandTable::kNoRow ||
+          commands.Find(CommandKind::AR, dependency) != CommandTable::kNoRow) {
+        // Link depdency. Skip.
+        continue;
+      }
+      if (diagnostics == nullptr) {
+        fmt::print("Compilation command for dependency \"{}\" not found.\n",
+                   paths.Lookup(dependency));
+        abort();
+      }
+      diagnostics->Add(DiagnosticKind::MISSING_COMPILE_COMMAND,
+                       paths.Lookup(dependency));
+      continue;
+    }
+    PathList input_sources = commands.inputs(input);
+    if (input_sources.empty()) {
+      if (diagnostics == nullptr) {
+        fmt::print("Expected compile target {} to have an input!\n",
+                   paths.Lookup(dependency));
+        abort();
+      }
+      diagnostics->Add(DiagnosticKind::COMPILE_WITHOUT_SOURCE,
+                       paths.Lookup(dependency));
+      continue;
+    }
+    // Only the first source is grouped, whether or not the dependency starts
+    // a group.
+    if (input_sources.size() != 1) {
+      if (diagnostics == nullptr) {
+        fmt::print("Expected matching compile target {} to have one input!\n",
+                   paths.Lookup(dependency));
+        abort();
+      }
+      diagnostics->Add(DiagnosticKind::COMPILE_WITH_SOURCES,
+                       paths.Lookup(dependency));
+    }
+
+    // A PIC twin is grouped as its primary, plus its PIC flags.
+    CommandTable::RowId example = input;
+    FlagSetId variant = 0;
+    if (twins != nullptr) {
+      example = twins->primary(input);
+      variant = twins->delta(input);
+    }
+
+    // find the group that has the same flags as this one, if any.
+    auto [it, is_new_group] = target_groups.emplace(
+        uint64_t(flag_groups.group(example)) << 32 | variant,
+        match_groups.size());
+
+    if (is_new_group) {
+      // save off the *input*
+      DependencyGroup& group = match_groups.emplace_back();
+      group.sources.push_back(input_sources[0]);
+      group.rows.push_back(input);
+      group.example_gcc_command = example;
+      group.variant = variant;
+    } else {
+      // Match!
+      match_groups[it->second].sources.push_back(input_sources[0]);
+      match_groups[it->second].rows.push_back(input);
+    }
+  }
+
+  return match_groups;
+}
+
+Report build_report(CommandTable* commands, Diagnostics* diagnostics,
+                    const PicTwins* twins) {
+  Report report;
+  if (!commands->Count(CommandKind::LINK) &&
+      !commands->Count(CommandKind::AR)) {
+    report.generated_target = true;
+    ArCommand ar_command;
+    ar_command.directory = PathTable::Global().Intern(".");
+    ar_command.output = PathTable::Global().Intern(kGeneratedTarget);
+    for (auto row : commands->SortedRows(CommandKind::COMPILE)) {
+      ar_command.inputs.push_back(commands->output(row));
+    }
+    commands->Add(ar_command);
+  }
+
+  // Group every compile command by its flags once, for all targets to share.
+  FlagGroups flag_groups(*commands);
+  Report targets = build_report(*commands, flag_groups, diagnostics, twins);
+  report.ar_targets = move(targets.ar_targets);
+  report.link_targets = move(targets.link_targets);
+  report.pic_twins = targets.pic_twins;
+  return report;
+}
+
+Report build_report(const CommandTable& commands,
+                    const FlagGroups& flag_groups, Diagnostics* diagnostics,
+                    const PicTwins* twins) {
+  Report report;
+  report.ar_targets = report_targets(commands, flag_groups, CommandKind::AR,
+                                     diagnostics, twins);
+  report.link_targets = report_targets(commands, flag_groups,
+                                       CommandKind::LINK, diagnostics, twins);
+  if (twins != nullptr) {
+    report.pic_twins = twins->size();
+    link_twin_groups(*twins, &report);
+  }
+  return report;
+}
+
+void add_headers(const HeaderGraph& graph, size_t top_n, Report* report) {
+  PathTable& paths = PathTable::Global();
+  for (auto* targets : {&report->ar_targets, &report->link_targets}) {
+    for (TargetReport& target : *targets) {
+      for (DependencyGroup& group : target.groups) {
+        vector<PathId> headers;
+        for (PathId source : group.sources) {
+          const vector<PathId>& source_headers = graph.headers(source);
+          headers.insert(headers.end(), source_headers.begin(),
+                         source_headers.end());
+        }
+        sort(headers.begin(), headers.end());
+        headers.erase(unique(headers.begin(), headers.end()), headers.end());
+        sort(headers.begin(), headers.end(), [&](PathId a, PathId b) {
+          return paths.Lookup(a) < paths.Lookup(b);
+        });
+        group.headers = move(headers);
+      }
+    }
+  }
+  report->has_headers = true;
+  report->header_sources = graph.num_sources();
+  report->header_edges = graph.num_edges();
+  report->most_included_headers = graph.MostIncluded(top_n);
+}
+
+bool write_report(const CommandTable& commands, const Report& report,
+                  ReportFormat format, int jobs, FILE* out) {
+  switch (format) {
+    case ReportFormat::TEXT:
+      return write_text_report(commands, report, jobs, out);
+    case ReportFormat::JSON:
+      return write_json_report(commands, report, jobs, out);
+    case ReportFormat::BINARY:
+      return write_binary_report(commands, report, jobs, out);
+  }
+  return false;
+}
+
+void print_report(const CommandTable& commands, const Report& report,
+                  FILE* out) {
+  write_report(commands, report, ReportFormat::TEXT, 1, out);
+}
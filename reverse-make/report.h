@@ -0,0 +1,213 @@
+#ifndef REVERSE_MAKE_REPORT_H__
+#define REVERSE_MAKE_REPORT_H__
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/depfiles.h"
+#include "reverse-make/diagnostics.h"
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/paths.h"
+#include "reverse-make/pic_twins.h"
+
+using namespace std;
+
+/**
+ * Some of a target's dependencies, all compiled with matching flags.
+ */
+struct DependencyGroup {
+  // The source file of each dependency, in order.
+  vector<PathId> sources;
+  // The compile command of each dependency, in the same order.
+  vector<CommandTable::RowId> rows;
+  // The compile command of the first dependency; its flags are the ones shown.
+  // With PIC twins folded, it is the command of the first dependency's
+  // primary twin.
+  CommandTable::RowId example_gcc_command;
+  // The headers the sources depend on, ordered by path. Only filled in by
+  // add_headers().
+  vector<PathId> headers;
+  // With PIC twins folded, the PIC flags the dependencies were compiled with
+  // on top of those of example_gcc_command; the empty set otherwise.
+  FlagSetId variant = 0;
+  // If the dependencies are the PIC twins of exactly those of a group
+  // reported earlier, the target of that group and its index.
+  CommandTable::RowId twin_target = CommandTable::kNoRow;
+  size_t twin_group = 0;
+};
+
+/**
+ * A link or ar target, and its source dependencies grouped by flags.
+ */
+struct TargetReport {
+  CommandTable::RowId target;
+  vector<DependencyGroup> groups;
+};
+
+/**
+ * Everything reverse-make prints about a build log.
+ */
+struct Report {
+  // True if the log had no link or ar commands, so an ar target depending on
+  // every object was made up.
+  bool generated_target = false;
+  // The number of PIC twins folded into their primaries.
+  size_t pic_twins = 0;
+  // Each ordered by the target's output path.
+  vector<TargetReport> ar_targets;
+  vector<TargetReport> link_targets;
+  // Set by add_headers().
+  bool has_headers = false;
+  size_t header_sources = 0;
+  size_t header_edges = 0;
+  vector<pair<PathId, size_t>> most_included_headers;
+};
+
+/**
+ * Returns the distinct paths in 'inputs', ordered by path.
+ */
+vector<PathId> sorted_dependencies(PathList inputs);
+
+/**
+ * Iterates through the dependencies of a compilation/linking command and
+ * groups them based on the flags they were compiled with.
+ *
+ * The function works in the following steps:
+ * 1. For each dependency, in order, it finds the row of the command that
+ * compiles it.
+ * 2. It looks up the row's precomputed flag group, and the target's own group
+ * for it, if the target has one yet.
+ * 3. If so, the dependency is added to it. Otherwise it starts a new group,
+ * with its command as the representative one.
+ *
+ * No flags are compared here, so the cost is linear in the number of
+ * dependencies, however many targets share them.
+ *
+ * With 'twins', each PIC twin is grouped by the flags of its primary and its
+ * PIC flags, so the twins of a group's dependencies are grouped the same way,
+ * and the flags shown for a group of twins are their primaries'.
+ *
+ * A dependency that no command builds is an error if any of the target's
+ * dependencies are compiled, as is a compile command without exactly one
+ * source. Without 'diagnostics', the function prints a message and aborts on
+ * the first error; with it, the error is recorded and worked around.
+ *
+ * @param dependencies The target's inputs, as returned by
+ * sorted_dependencies().
+ * @param commands Every command in the build log.
+ * @param flag_groups The flag groups of 'commands'.
+ * @param diagnostics If not null, collects the errors instead.
+ * @param twins If not null, the PIC twins of 'commands', to fold.
+ *
+ * @return The groups, in order of their first dependency.
+ */
+vector<DependencyGroup> find_deps(const vector<PathId>& dependencies,
+                                  const CommandTable& commands,
+                                  const FlagGroups& flag_groups,
+                                  Diagnostics* diagnostics = nullptr,
+                                  const PicTwins* twins = nullptr);
+
+/**
+ * Works out the dependency groups of every ar and link target.
+ *
+ * If the log has no ar or link commands, an ar target that depends on every
+ * compiled object is added to 'commands' first.
+ *
+ * Errors in the log abort, unless 'diagnostics' is given to collect them; see
+ * find_deps().
+ *
+ * With 'twins', PIC twins are folded: see find_deps(), and each group of
+ * twins of a group reported earlier is reported as just a reference to it and
+ * the PIC flags.
+ */
+Report build_report(CommandTable* commands,
+                    Diagnostics* diagnostics = nullptr,
+                    const PicTwins* twins = nullptr);
+
+/**
+ * Works out the dependency groups of the ar and link targets in 'commands',
+ * using flag groups that are already up to date with it. Unlike the overload
+ * above, this never makes up a target.
+ */
+Report build_report(const CommandTable& commands,
+                    const FlagGroups& flag_groups,
+                    Diagnostics* diagnostics = nullptr,
+                    const PicTwins* twins = nullptr);
+
+/**
+ * Adds the headers of each dependency group, and the most included headers
+ * overall, to a report.
+ *
+ * @param graph The headers of each source.
+ * @param top_n How many of the most included headers to list.
+ * @param report The report to add them to.
+ */
+void add_headers(const HeaderGraph& graph, size_t top_n, Report* report);
+
+/**
+ * The formats a report can be written in.
+ */
+enum class ReportFormat {
+  // The human-readable text print_report() prints.
+  TEXT,
+  // One JSON object:
+  //   {"generated_target": false, "pic_twins": 0, "targets": [
+  //     {"kind": "ar" or "link", "target": path, "dependencies": [path...],
+  //      "link_flags": {"linkopts": [flag...], ...} (link targets only),
+  //      "groups": [
+  //        {"sources": [path...], "compiler": "gcc", "command": "COMPILE",
+  //         "flags": {"defines": [flag...], ...}, "pic_variant": [flag...],
+  //         "headers": [path...]},
+  //        {"sources": [path...], "pic_variant": [flag...],
+  //         "twin_of": {"target": path, "group": index}}]}],
+  //    "headers": {"sources": n, "edges": n,
+  //                "most_included": [{"header": path, "count": n}...]}}
+  // Flags are sorted, and "pic_variant", "headers" and the top-level
+  // "headers" only appear when there are any.
+  JSON,
+  // A compact encoding of the same, where every string is written once and
+  // every set of flags once. Everything is an unsigned LEB128 varint, or a
+  // string (its length, then its bytes):
+  //   "RMKR", the format version (1)
+  //   the strings: their count, then each
+  //   the flag sets: their count, then the size of each and the index of
+  //     each of its flags in the strings, sorted by flag; set 0 is empty
+  //   generated_target (0 or 1), pic_twins
+  //   the targets: their count, then for each:
+  //     its kind (0 for ar, 1 for link), its path, its dependencies (their
+  //     count, then each path), and for link targets the flag sets of its
+  //     linkopts, link_search_dirs and link_libs
+  //     its groups: their count, then for each:
+  //       its sources (their count, then each path), its compiler and its
+  //       command (as strings), the flag set of each FlagField in order, the
+  //       flag set of its PIC flags, 0 or 1 + the index of the target of the
+  //       group it twins followed by that group's index, and its headers
+  //       (their count, then each path)
+  //   0, or 1 followed by the number of sources and of source/header
+  //     dependencies, and the most included headers: their count, then for
+  //     each its path and how many sources include it
+  // Paths and compiler and command names are indices in the strings.
+  BINARY,
+};
+
+/**
+ * Writes a report built by build_report() from 'commands'.
+ *
+ * Each target is rendered into its own buffer, on up to 'jobs' threads, and
+ * the buffers are written in order, so the output doesn't depend on 'jobs'.
+ *
+ * @return false if writing to 'out' failed.
+ */
+bool write_report(const CommandTable& commands, const Report& report,
+                  ReportFormat format, int jobs, FILE* out = stdout);
+
+/**
+ * Prints a report built by build_report() from 'commands', as text, on the
+ * calling thread.
+ */
+void print_report(const CommandTable& commands, const Report& report,
+                  FILE* out = stdout);
+
+#endif  // REVERSE_MAKE_REPORT_H__
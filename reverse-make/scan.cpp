@@ -0,0 +1,139 @@
+#include "reverse-make/scan.h"
+
+#include <initializer_list>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Every kernel looks for three bytes; the two-byte search passes one of them
+// twice, which costs one extra compare per block.
+using ScanKernel = const char* (*)(const char*, const char*, char, char, char);
+
+const char* scan_scalar(const char* p, const char* end, char a, char b,
+                        char c) {
+  for (; p < end; p++) {
+    if (*p == a || *p == b || *p == c) {
+      return p;
+    }
+  }
+  return end;
+}
+
+#if defined(__x86_64__)
+
+const char* scan_sse2(const char* p, const char* end, char a, char b, char c) {
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vc = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)),
+        _mm_cmpeq_epi8(x, vc));
+    if (int mask = _mm_movemask_epi8(hits)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return scan_scalar(p, end, a, b, c);
+}
+
+__attribute__((target("avx2"))) const char* scan_avx2(const char* p,
+                                                      const char* end, char a,
+                                                      char b, char c) {
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  const __m256i vc = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hits = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)),
+        _mm256_cmpeq_epi8(x, vc));
+    if (unsigned mask = _mm256_movemask_epi8(hits)) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  // Finish the last partial block 16 bytes at a time.
+  return scan_sse2(p, end, a, b, c);
+}
+
+#endif  // defined(__x86_64__)
+
+bool is_supported(ScanIsa isa) {
+  switch (isa) {
+    case ScanIsa::SCALAR:
+      return true;
+#if defined(__x86_64__)
+    case ScanIsa::SSE2:
+      return true;
+    case ScanIsa::AVX2:
+      // We may get here from a static initializer, before libgcc has looked
+      // at the CPU.
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+ScanKernel kernel_for(ScanIsa isa) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case ScanIsa::SSE2:
+      return scan_sse2;
+    case ScanIsa::AVX2:
+      return scan_avx2;
+#endif
+    default:
+      return scan_scalar;
+  }
+}
+
+ScanIsa best_isa() {
+  for (ScanIsa isa : {ScanIsa::AVX2, ScanIsa::SSE2}) {
+    if (is_supported(isa)) {
+      return isa;
+    }
+  }
+  return ScanIsa::SCALAR;
+}
+
+ScanIsa active_isa = best_isa();
+ScanKernel active_kernel = kernel_for(active_isa);
+
+}  // namespace
+
+const char* scan_any_of(const char* begin, const char* end, char a, char b) {
+  return active_kernel(begin, end, a, b, b);
+}
+
+const char* scan_any_of(const char* begin, const char* end, char a, char b,
+                        char c) {
+  return active_kernel(begin, end, a, b, c);
+}
+
+ScanIsa scan_isa() { return active_isa; }
+
+bool set_scan_isa(ScanIsa isa) {
+  if (!is_supported(isa)) {
+    return false;
+  }
+  active_isa = isa;
+  active_kernel = kernel_for(isa);
+  return true;
+}
+
+const char* scan_isa_name(ScanIsa isa) {
+  switch (isa) {
+    case ScanIsa::SCALAR:
+      return "scalar";
+    case ScanIsa::SSE2:
+      return "sse2";
+    case ScanIsa::AVX2:
+      return "avx2";
+  }
+  return "unknown";
+}
@@ -0,0 +1,52 @@
+#ifndef REVERSE_MAKE_SCAN_H__
+#define REVERSE_MAKE_SCAN_H__
+
+using namespace std;
+
+/**
+ * The instruction sets the scanning kernels can use.
+ */
+enum class ScanIsa {
+  SCALAR,  // one byte at a time, available everywhere
+  SSE2,    // 16 bytes at a time (x86-64)
+  AVX2,    // 32 bytes at a time (x86-64, checked at runtime)
+};
+
+/**
+ * Returns the position of the first byte in [begin, end) equal to 'a' or 'b',
+ * or 'end' if there is none.
+ *
+ * This is what the log reader and the tokenizer use to skip over the runs of
+ * ordinary characters between the few bytes they care about (newlines,
+ * backslashes, quotes and spaces), so that escape and quote state is only
+ * handled at those positions.
+ */
+const char* scan_any_of(const char* begin, const char* end, char a, char b);
+
+/**
+ * Returns the position of the first byte in [begin, end) equal to 'a', 'b' or
+ * 'c', or 'end' if there is none.
+ */
+const char* scan_any_of(const char* begin, const char* end, char a, char b,
+                        char c);
+
+/**
+ * Returns the instruction set the kernels are currently using. By default
+ * this is the best one the CPU supports.
+ */
+ScanIsa scan_isa();
+
+/**
+ * Switches the kernels to 'isa', for benchmarking and testing.
+ *
+ * @return false, leaving the kernels unchanged, if the CPU doesn't support
+ * 'isa'.
+ */
+bool set_scan_isa(ScanIsa isa);
+
+/**
+ * Returns a short printable name for 'isa'.
+ */
+const char* scan_isa_name(ScanIsa isa);
+
+#endif  // REVERSE_MAKE_SCAN_H__
@@ -0,0 +1,754 @@
+#include "reverse-make/serve.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <utility>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "reverse-make/diagnostics.h"
+#include "reverse-make/index.h"
+#include "reverse-make/json.h"
+#include "reverse-make/log_reader.h"
+#include "reverse-make/parse.h"
+#include "reverse-make/paths.h"
+#include "reverse-make/signals.h"
+#include "reverse-make/sockets.h"
+
+namespace {
+
+using Buffer = fmt::memory_buffer;
+using RowId = CommandTable::RowId;
+
+// A client that sends this much without a line end is dropped.
+constexpr size_t kMaxQueryBytes = 1 << 20;
+
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int) { stop_requested = 1; }
+
+/**
+ * A member of a query.
+ */
+struct QueryValue {
+  // The value, unescaped if it is a string.
+  string value;
+  // The value as it was written, quotes and all.
+  string_view json;
+};
+
+/**
+ * Parses a query: a JSON object whose members are strings, numbers, true,
+ * false or null.
+ *
+ * @param text The query.
+ * @param members Receives the members, by name.
+ * @param error Set to what is wrong with 'text', if anything.
+ *
+ * @return false if 'text' isn't such an object.
+ */
+bool parse_query(string_view text,
+                 unordered_map<string, QueryValue>* members, string* error) {
+  size_t pos = 0;
+  auto skip_space = [&]() {
+    while (pos < text.size() &&
+           isspace(static_cast<unsigned char>(text[pos]))) {
+      pos++;
+    }
+  };
+  // Parses the string at 'pos', which starts with its opening quote.
+  auto parse_string = [&](string* out) {
+    for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+      char c = text[pos];
+      if (c != '\\') {
+        out->push_back(c);
+        continue;
+      }
+      if (++pos == text.size()) {
+        return false;
+      }
+      switch (text[pos]) {
+        case 'b':
+          out->push_back('\b');
+          break;
+        case 'f':
+          out->push_back('\f');
+          break;
+        case 'n':
+          out->push_back('\n');
+          break;
+        case 'r':
+          out->push_back('\r');
+          break;
+        case 't':
+          out->push_back('\t');
+          break;
+        case 'u': {
+          if (pos + 4 >= text.size()) {
+            return false;
+          }
+          char digits[5] = {};
+          text.copy(digits, 4, pos + 1);
+          char* end;
+          unsigned long code = strtoul(digits, &end, 16);
+          if (end != digits + 4) {
+            return false;
+          }
+          pos += 4;
+          // Surrogate pairs aren't combined; no path needs them.
+          if (code < 0x80) {
+            out->push_back(char(code));
+          } else if (code < 0x800) {
+            out->push_back(char(0xc0 | code >> 6));
+            out->push_back(char(0x80 | (code & 0x3f)));
+          } else {
+            out->push_back(char(0xe0 | code >> 12));
+            out->push_back(char(0x80 | (code >> 6 & 0x3f)));
+            out->push_back(char(0x80 | (code & 0x3f)));
+          }
+          break;
+        }
+        default:
+          out->push_back(text[pos]);
+      }
+    }
+    if (pos == text.size()) {
+      return false;
+    }
+    pos++;
+    return true;
+  };
+
+  skip_space();
+  if (pos == text.size() || text[pos] != '{') {
+    *error = "a query must be a JSON object";
+    return false;
+  }
+  pos++;
+  skip_space();
+  if (pos < text.size() && text[pos] == '}') {
+    pos++;
+  } else {
+    while (true) {
+      string name;
+      if (pos == text.size() || text[pos] != '"' || !parse_string(&name)) {
+        *error = "expected a member name";
+        return false;
+      }
+      skip_space();
+      if (pos == text.size() || text[pos] != ':') {
+        *error = "expected ':'";
+        return false;
+      }
+      pos++;
+      skip_space();
+      QueryValue value;
+      size_t start = pos;
+      if (pos < text.size() && text[pos] == '"') {
+        if (!parse_string(&value.value)) {
+          *error = "unterminated string";
+          return false;
+        }
+      } else {
+        while (pos < text.size() && (isalnum(static_cast<unsigned char>(
+                                         text[pos])) ||
+                                     strchr("+-.", text[pos]) != nullptr)) {
+          pos++;
+        }
+        if (pos == start) {
+          *error = "members must be strings, numbers, true, false or null";
+          return false;
+        }
+        value.value = string(text.substr(start, pos - start));
+      }
+      value.json = text.substr(start, pos - start);
+      (*members)[name] = move(value);
+      skip_space();
+      if (pos < text.size() && text[pos] == ',') {
+        pos++;
+        skip_space();
+        continue;
+      }
+      if (pos < text.size() && text[pos] == '}') {
+        pos++;
+        break;
+      }
+      *error = "expected ',' or '}'";
+      return false;
+    }
+  }
+  skip_space();
+  if (pos != text.size()) {
+    *error = "trailing characters after the query";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Appends 'str' to 'out'.
+ */
+void append(string_view str, Buffer* out) {
+  out->append(str.data(), str.data() + str.size());
+}
+
+/**
+ * Appends the output paths of 'rows' to 'out' as a JSON array, sorted and
+ * without duplicates.
+ */
+void append_outputs(const CommandTable& commands, const vector<RowId>& rows,
+                    Buffer* out) {
+  PathTable& paths = PathTable::Global();
+  vector<string_view> outputs;
+  for (RowId row : rows) {
+    outputs.push_back(paths.Lookup(commands.output(row)));
+  }
+  sort(outputs.begin(), outputs.end());
+  outputs.erase(unique(outputs.begin(), outputs.end()), outputs.end());
+  out->push_back('[');
+  for (size_t i = 0; i < outputs.size(); i++) {
+    append(i > 0 ? ", " : "", out);
+    append_json_string(outputs[i], out);
+  }
+  out->push_back(']');
+}
+
+/**
+ * Appends the compiler, command and flags of compile row 'row' to 'out' as
+ * members of a JSON object.
+ */
+void append_compile_flags(const CommandTable& commands, RowId row,
+                          Buffer* out) {
+  FlagInterner& interner = FlagInterner::Global();
+  fmt::format_to(back_inserter(*out),
+                 ", \"compiler\": \"{}\", \"command\": \"{}\", \"flags\": {{",
+                 GccCommand::CompilerAsString(commands.compiler(row)),
+                 GccCommand::CommandAsString(commands.command(row)));
+  for (size_t field = 0; field < kNumFlagFields; field++) {
+    fmt::format_to(back_inserter(*out), "{}\"{}\": [", field > 0 ? ", " : "",
+                   kFlagFieldNames[field]);
+    vector<string_view> flags;
+    for (uint32_t flag : commands.flag_set(row, FlagField(field)).ids()) {
+      flags.push_back(interner.Lookup(flag));
+    }
+    sort(flags.begin(), flags.end());
+    for (size_t i = 0; i < flags.size(); i++) {
+      append(i > 0 ? ", " : "", out);
+      append_json_string(flags[i], out);
+    }
+    out->push_back(']');
+  }
+  out->push_back('}');
+}
+
+/**
+ * Returns the answer to a query that couldn't be answered.
+ */
+string error_answer(string_view id, string_view error) {
+  string answer = "{\"ok\": false";
+  if (!id.empty()) {
+    answer += ", \"id\": ";
+    answer += id;
+  }
+  answer += ", \"error\": ";
+  append_json_string(error, &answer);
+  answer += "}\n";
+  return answer;
+}
+
+/**
+ * Parses the log named by 'options' and indexes it.
+ *
+ * @param options What to serve.
+ * @param generation How many times the log was loaded before.
+ * @param identity Set to the size and modification time of the log, taken
+ * before it is read, so that a change while it is read is noticed later.
+ *
+ * @return The index, or nullptr if the log can't be read.
+ */
+unique_ptr<QueryIndex> load_index(const ServeOptions& options,
+                                  size_t generation, LogIdentity* identity) {
+  if (!stat_log(options.filename, identity)) {
+    return nullptr;
+  }
+  auto source = LogSource::Open(options.filename);
+  if (!source) {
+    return nullptr;
+  }
+  CommandTable commands;
+  vector<SkippedCommand> skipped_commands;
+  Diagnostics diagnostics;
+  parse_log(source.get(), options.jobs, &commands, &skipped_commands, nullptr,
+            nullptr, &diagnostics);
+  return make_unique<QueryIndex>(options.filename, generation, move(commands),
+                                 diagnostics.size() + skipped_commands.size(),
+                                 options.jobs);
+}
+
+/**
+ * Listens on a Unix domain socket at 'path', replacing a stale socket left
+ * there.
+ *
+ * @return The listening socket, or -1 with 'error' set.
+ */
+int listen_on(const string& path, string* error) {
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    *error = fmt::format("Socket path is too long: {}", path);
+    return -1;
+  }
+  memcpy(address.sun_path, path.data(), path.size());
+
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path.c_str());
+  }
+  int fd = open_unix_socket(true);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    *error = fmt::format("Unable to listen on {}: {}", path, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * A connected client, with the queries it sent that haven't been answered
+ * yet and the answers that haven't been sent yet.
+ */
+struct Client {
+  int fd;
+  string in;
+  string out;
+  bool closed = false;
+};
+
+/**
+ * Reads what 'client' sent, and answers every complete query.
+ */
+void read_queries(const QueryIndex& index, Client* client) {
+  char buffer[64 * 1024];
+  while (true) {
+    ssize_t n = read(client->fd, buffer, sizeof(buffer));
+    if (n > 0) {
+      client->in.append(buffer, n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      client->closed = true;
+    }
+    break;
+  }
+
+  size_t start = 0;
+  size_t end;
+  while ((end = client->in.find('\n', start)) != string::npos) {
+    string_view query(client->in.data() + start, end - start);
+    if (!query.empty() && query.back() == '\r') {
+      query.remove_suffix(1);
+    }
+    if (!query.empty()) {
+      client->out += index.Answer(query);
+    }
+    start = end + 1;
+  }
+  client->in.erase(0, start);
+  if (client->in.size() > kMaxQueryBytes) {
+    client->closed = true;
+  }
+}
+
+/**
+ * Sends as much of the answers to 'client' as it will take.
+ */
+void write_answers(Client* client) {
+  size_t sent = 0;
+  while (sent < client->out.size()) {
+    ssize_t n = send_no_sigpipe(client->fd, client->out.data() + sent,
+                                client->out.size() - sent);
+    if (n > 0) {
+      sent += n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        client->closed = true;
+        client->out.clear();
+        return;
+      }
+      break;
+    }
+  }
+  client->out.erase(0, sent);
+}
+
+}  // namespace
+
+QueryIndex::QueryIndex(const string& log, size_t generation,
+                       CommandTable commands, size_t problems, int jobs)
+    : log_(log),
+      generation_(generation),
+      problems_(problems),
+      commands_(move(commands)),
+      flag_groups_(commands_) {
+  graph_ = make_unique<TargetGraph>(commands_, flag_groups_, jobs);
+  PathTable& paths = PathTable::Global();
+  FlagInterner& interner = FlagInterner::Global();
+  group_rows_.assign(flag_groups_.size(), CommandTable::kNoRow);
+  group_sizes_.assign(flag_groups_.size(), 0);
+  group_targets_.resize(flag_groups_.size());
+  for (RowId row = 0; row < commands_.size(); row++) {
+    string_view output = paths.Lookup(commands_.output(row));
+    if (commands_.kind(row) != CommandKind::COMPILE) {
+      targets_.emplace(output, row);
+      continue;
+    }
+    objects_.emplace(output, row);
+    for (PathId source : commands_.inputs(row)) {
+      sources_[paths.Lookup(source)].push_back(row);
+    }
+    FlagGroups::GroupId group = flag_groups_.group(row);
+    group_sizes_[group]++;
+    if (group_rows_[group] != CommandTable::kNoRow) {
+      continue;
+    }
+    group_rows_[group] = row;
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      for (uint32_t flag : commands_.flag_set(row, FlagField(field)).ids()) {
+        flags_[interner.Lookup(flag)].push_back(group);
+      }
+    }
+  }
+  for (auto& [flag, groups] : flags_) {
+    sort(groups.begin(), groups.end());
+  }
+
+  for (auto& [output, target] : targets_) {
+    for (PathId input : commands_.inputs(target)) {
+      auto object = objects_.find(paths.Lookup(input));
+      if (object != objects_.end()) {
+        object_users_[object->second].targets.push_back(target);
+        group_targets_[flag_groups_.group(object->second)].push_back(target);
+      }
+    }
+    for (RowId used : graph_->uses(target)) {
+      used_by_[used].push_back(target);
+    }
+    for (RowId object : graph_->transitive_objects(target)) {
+      object_users_[object].all_targets.push_back(target);
+    }
+  }
+  for (auto& targets : group_targets_) {
+    sort(targets.begin(), targets.end());
+    targets.erase(unique(targets.begin(), targets.end()), targets.end());
+  }
+}
+
+string QueryIndex::Answer(string_view query) const {
+  unordered_map<string, QueryValue> members;
+  string error;
+  if (!parse_query(query, &members, &error)) {
+    return error_answer("", error);
+  }
+  string_view id;
+  if (auto it = members.find("id"); it != members.end()) {
+    id = it->second.json;
+  }
+  auto member = [&](const char* name) -> const string* {
+    auto it = members.find(name);
+    return it == members.end() ? nullptr : &it->second.value;
+  };
+  const string* name = member("query");
+  if (name == nullptr) {
+    return error_answer(id, "the query has no \"query\" member");
+  }
+  // The path named by member 'name', normalized.
+  string scratch;
+  auto path = [&](const char* name) -> string_view {
+    const string* value = member(name);
+    return value == nullptr ? string_view()
+                            : normalize_path(*value, &scratch);
+  };
+
+  PathTable& paths = PathTable::Global();
+  Buffer answer;
+  auto it = back_inserter(answer);
+  append("{\"ok\": true", &answer);
+  if (!id.empty()) {
+    fmt::format_to(it, ", \"id\": {}", id);
+  }
+
+  if (*name == "source") {
+    auto source = sources_.find(path("source"));
+    if (source == sources_.end()) {
+      return error_answer(id, fmt::format("unknown source: {}", path("source")));
+    }
+    vector<RowId> targets;
+    vector<RowId> all_targets;
+    for (RowId object : source->second) {
+      auto users = object_users_.find(object);
+      if (users != object_users_.end()) {
+        targets.insert(targets.end(), users->second.targets.begin(),
+                       users->second.targets.end());
+        all_targets.insert(all_targets.end(),
+                           users->second.all_targets.begin(),
+                           users->second.all_targets.end());
+      }
+    }
+    append(", \"objects\": ", &answer);
+    append_outputs(commands_, source->second, &answer);
+    append(", \"targets\": ", &answer);
+    append_outputs(commands_, targets, &answer);
+    append(", \"all_targets\": ", &answer);
+    append_outputs(commands_, all_targets, &answer);
+  } else if (*name == "object") {
+    auto object = objects_.find(path("object"));
+    if (object == objects_.end()) {
+      return error_answer(id, fmt::format("unknown object: {}", path("object")));
+    }
+    RowId row = object->second;
+    append(", \"sources\": [", &answer);
+    const char* separator = "";
+    for (PathId source : commands_.inputs(row)) {
+      append(separator, &answer);
+      append_json_string(paths.Lookup(source), &answer);
+      separator = ", ";
+    }
+    fmt::format_to(it, "], \"group\": {}", flag_groups_.group(row));
+    append_compile_flags(commands_, row, &answer);
+    auto users = object_users_.find(row);
+    append(", \"targets\": ", &answer);
+    append_outputs(commands_,
+                   users == object_users_.end() ? vector<RowId>()
+                                                : users->second.targets,
+                   &answer);
+  } else if (*name == "flag") {
+    const string* flag = member("flag");
+    const string* kind = member("kind");
+    if (flag == nullptr) {
+      return error_answer(id, "the query has no \"flag\" member");
+    }
+    if (kind != nullptr && *kind != "ar" && *kind != "link") {
+      return error_answer(id, "\"kind\" must be \"ar\" or \"link\"");
+    }
+    auto groups = flags_.find(*flag);
+    vector<RowId> targets;
+    append(", \"groups\": [", &answer);
+    if (groups != flags_.end()) {
+      for (size_t i = 0; i < groups->second.size(); i++) {
+        FlagGroups::GroupId group = groups->second[i];
+        fmt::format_to(it, "{}{}", i > 0 ? ", " : "", group);
+        for (RowId target : group_targets_[group]) {
+          CommandKind target_kind = commands_.kind(target);
+          if (kind == nullptr ||
+              (*kind == "ar") == (target_kind == CommandKind::AR)) {
+            targets.push_back(target);
+          }
+        }
+      }
+    }
+    append("], \"targets\": ", &answer);
+    append_outputs(commands_, targets, &answer);
+  } else if (*name == "group") {
+    const string* group_text = member("group");
+    char* end = nullptr;
+    unsigned long group =
+        group_text == nullptr ? 0 : strtoul(group_text->c_str(), &end, 10);
+    if (group_text == nullptr || group_text->empty() || *end != '\0' ||
+        group >= group_rows_.size()) {
+      return error_answer(id, "\"group\" must be the number of a flag group");
+    }
+    fmt::format_to(it, ", \"group\": {}, \"objects\": {}", group,
+                   group_sizes_[group]);
+    append_compile_flags(commands_, group_rows_[group], &answer);
+    append(", \"targets\": ", &answer);
+    append_outputs(commands_, group_targets_[group], &answer);
+  } else if (*name == "target") {
+    auto target = targets_.find(path("target"));
+    if (target == targets_.end()) {
+      return error_answer(id, fmt::format("unknown target: {}", path("target")));
+    }
+    RowId row = target->second;
+    auto used_by = used_by_.find(row);
+    fmt::format_to(it, ", \"kind\": \"{}\", \"uses\": ",
+                   commands_.kind(row) == CommandKind::AR ? "ar" : "link");
+    append_outputs(commands_, graph_->uses(row), &answer);
+    append(", \"used_by\": ", &answer);
+    append_outputs(commands_,
+                   used_by == used_by_.end() ? vector<RowId>()
+                                             : used_by->second,
+                   &answer);
+    append(", \"sources\": [", &answer);
+    const char* separator = "";
+    for (PathId source : graph_->TransitiveSources(row)) {
+      append(separator, &answer);
+      append_json_string(paths.Lookup(source), &answer);
+      separator = ", ";
+    }
+    append("], \"groups\": [", &answer);
+    separator = "";
+    for (FlagGroups::GroupId group : graph_->TransitiveGroups(row)) {
+      fmt::format_to(it, "{}{}", separator, group);
+      separator = ", ";
+    }
+    append("]", &answer);
+  } else if (*name == "status") {
+    append(", \"log\": ", &answer);
+    append_json_string(log_, &answer);
+    fmt::format_to(it,
+                   ", \"loads\": {}, \"compile_commands\": {}, "
+                   "\"link_commands\": {}, \"ar_commands\": {}, "
+                   "\"flag_groups\": {}, \"problems\": {}",
+                   generation_ + 1, commands_.Count(CommandKind::COMPILE),
+                   commands_.Count(CommandKind::LINK),
+                   commands_.Count(CommandKind::AR), flag_groups_.size(),
+                   problems_);
+  } else {
+    return error_answer(id, fmt::format("unknown query: {}", *name));
+  }
+  append("}\n", &answer);
+  return fmt::to_string(answer);
+}
+
+int serve_log(const ServeOptions& options) {
+  if (options.filename == "-") {
+    fmt::print(stderr, "--serve needs a log file, not stdin.\n");
+    return 1;
+  }
+  LogIdentity loaded;
+  unique_ptr<QueryIndex> index = load_index(options, 0, &loaded);
+  if (!index) {
+    fmt::print(stderr, "Unable to open file: {}\n", options.filename);
+    return 1;
+  }
+  string error;
+  int listener = listen_on(options.socket_path, &error);
+  if (listener < 0) {
+    fmt::print(stderr, "{}\n", error);
+    return 1;
+  }
+  install_handler(SIGINT, request_stop);
+  install_handler(SIGTERM, request_stop);
+  fmt::print(stderr, "Serving {} on {}\n", options.filename,
+             options.socket_path);
+
+  using Clock = chrono::steady_clock;
+  auto interval = chrono::milliseconds(max(options.reload_interval_ms, 1));
+  Clock::time_point next_check = Clock::now() + interval;
+  size_t generation = 1;
+  // The log being parsed again, if it changed.
+  future<unique_ptr<QueryIndex>> reload;
+  LogIdentity reloading;
+
+  vector<Client> clients;
+  vector<pollfd> fds;
+  while (!stop_requested) {
+    fds.clear();
+    fds.push_back({listener, POLLIN, 0});
+    for (const Client& client : clients) {
+      short events = POLLIN;
+      if (!client.out.empty()) {
+        events |= POLLOUT;
+      }
+      fds.push_back({client.fd, events, 0});
+    }
+    auto wait = chrono::duration_cast<chrono::milliseconds>(next_check -
+                                                            Clock::now());
+    int timeout = int(max<int64_t>(wait.count(), 0));
+    if (reload.valid()) {
+      // Check on the reload often, to swap it in soon after it is done.
+      timeout = min(timeout, 10);
+    }
+    int ready = poll(fds.data(), fds.size(), timeout);
+    if (ready < 0 && errno != EINTR) {
+      fmt::print(stderr, "poll failed: {}\n", strerror(errno));
+      break;
+    }
+
+    if (ready > 0) {
+      for (size_t i = 0; i < clients.size(); i++) {
+        Client& client = clients[i];
+        short revents = fds[i + 1].revents;
+        if (revents & (POLLIN | POLLHUP | POLLERR)) {
+          read_queries(*index, &client);
+        }
+        if (!client.out.empty()) {
+          write_answers(&client);
+        }
+      }
+      clients.erase(remove_if(clients.begin(), clients.end(),
+                              [](const Client& client) {
+                                if (client.closed && client.out.empty()) {
+                                  close(client.fd);
+                                  return true;
+                                }
+                                return false;
+                              }),
+                    clients.end());
+      if (fds[0].revents & POLLIN) {
+        int fd;
+        while ((fd = accept_connection(listener, true)) >= 0) {
+          clients.push_back({fd, "", ""});
+        }
+      }
+    }
+
+    if (reload.valid() &&
+        reload.wait_for(chrono::seconds(0)) == future_status::ready) {
+      unique_ptr<QueryIndex> reloaded = reload.get();
+      if (reloaded) {
+        index = move(reloaded);
+        loaded = reloading;
+        generation++;
+        fmt::print(stderr, "Reloaded {}\n", options.filename);
+      } else {
+        fmt::print(stderr, "Unable to reload {}\n", options.filename);
+      }
+    }
+    if (!reload.valid() && Clock::now() >= next_check) {
+      next_check = Clock::now() + interval;
+      LogIdentity current;
+      if (stat_log(options.filename, &current) &&
+          (current.size != loaded.size ||
+           current.mtime_ns != loaded.mtime_ns)) {
+        reload = async(launch::async, [&options, &reloading, generation]() {
+          return load_index(options, generation, &reloading);
+        });
+      }
+    }
+  }
+
+  if (reload.valid()) {
+    reload.wait();
+  }
+  for (const Client& client : clients) {
+    close(client.fd);
+  }
+  close(listener);
+  unlink(options.socket_path.c_str());
+  return 0;
+}
@@ -0,0 +1,133 @@
+#ifndef REVERSE_MAKE_SERVE_H__
+#define REVERSE_MAKE_SERVE_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/target_graph.h"
+
+using namespace std;
+
+/**
+ * Answers questions about one parsed build log, from indexes built once:
+ * from each source to the objects compiled from it and the targets that use
+ * them, from each object to its flag group, and from each flag to the flag
+ * groups that have it and the targets that use those groups.
+ *
+ * Each query is a JSON object on one line, with a "query" member naming it
+ * and its arguments as strings. An "id" member, if there is one, is echoed in
+ * the answer. The queries are:
+ *
+ *   {"query": "source", "source": path}: the objects compiled from the
+ *     source, the targets that use them directly ("targets"), and every
+ *     target made from them, directly or not ("all_targets").
+ *   {"query": "object", "object": path}: the object's sources, its flag
+ *     group, with the group's compiler, command and flags, and the targets
+ *     that use it directly.
+ *   {"query": "flag", "flag": flag[, "kind": "ar" or "link"]}: the flag
+ *     groups compiled with the flag, and the targets, or only those of the
+ *     given kind, that use an object of one of them directly.
+ *   {"query": "group", "group": number}: a flag group's compiler, command
+ *     and flags, its number of objects, and the targets that use them.
+ *   {"query": "target", "target": path}: the target's kind, the targets it
+ *     uses and those that use it directly, and every source and flag group
+ *     it is made from, directly or not.
+ *   {"query": "status"}: the log, how many times it was loaded, and how many
+ *     commands, targets and flag groups it has.
+ *
+ * Paths are normalized before they are looked up; see normalize_path(). Each
+ * answer is a JSON object on one line, with "ok": true and the results, or
+ * "ok": false and an "error".
+ */
+class QueryIndex {
+ public:
+  using RowId = CommandTable::RowId;
+
+  /**
+   * Builds the indexes of a parsed log.
+   *
+   * @param log The log's name, for status queries.
+   * @param generation How many times the log was loaded before, for status
+   * queries.
+   * @param commands The commands of the log.
+   * @param problems The number of problems parsing the log ran into.
+   * @param jobs The number of threads to build the target graph on.
+   */
+  QueryIndex(const string& log, size_t generation, CommandTable commands,
+             size_t problems, int jobs);
+
+  /**
+   * Answers one query.
+   *
+   * @param query The query, without its line end.
+   *
+   * @return The answer, ending with a line end.
+   */
+  string Answer(string_view query) const;
+
+ private:
+  // The targets that use each object directly, and those that use it at
+  // all, by the object's compile row.
+  struct ObjectUsers {
+    vector<RowId> targets;
+    vector<RowId> all_targets;
+  };
+
+  string log_;
+  size_t generation_;
+  size_t problems_;
+  CommandTable commands_;
+  FlagGroups flag_groups_;
+  unique_ptr<TargetGraph> graph_;
+  // The compile rows of each source, in order.
+  unordered_map<string_view, vector<RowId>> sources_;
+  // The compile row of each object, and the row of each target.
+  unordered_map<string_view, RowId> objects_;
+  unordered_map<string_view, RowId> targets_;
+  unordered_map<RowId, ObjectUsers> object_users_;
+  // The targets that use each target directly.
+  unordered_map<RowId, vector<RowId>> used_by_;
+  // A compile row of each flag group, its number of objects, and the targets
+  // that use one of them directly, ordered by row.
+  vector<RowId> group_rows_;
+  vector<size_t> group_sizes_;
+  vector<vector<RowId>> group_targets_;
+  // The flag groups compiled with each flag, in order.
+  unordered_map<string_view, vector<FlagGroups::GroupId>> flags_;
+};
+
+/**
+ * What serve_log() serves.
+ */
+struct ServeOptions {
+  // The build log.
+  string filename;
+  // The path of the Unix domain socket to listen on.
+  string socket_path;
+  // The number of threads to parse with.
+  int jobs = 1;
+  // How often to check whether the log changed, in milliseconds.
+  int reload_interval_ms = 1000;
+};
+
+/**
+ * Parses a build log once and answers queries about it on a Unix domain
+ * socket until SIGINT or SIGTERM; see QueryIndex for the queries. Clients
+ * send one query per line and get one answer per line, in order.
+ *
+ * When the log's size or modification time changes, it is parsed again in
+ * the background, and queries are answered from the old log until the new
+ * one is ready. Problems in the log are worked around as with --keep-going,
+ * so a broken log doesn't stop the server.
+ *
+ * @return The exit code for main().
+ */
+int serve_log(const ServeOptions& options);
+
+#endif  // REVERSE_MAKE_SERVE_H__
@@ -0,0 +1,23 @@
+#ifndef REVERSE_MAKE_SIGNALS_H__
+#define REVERSE_MAKE_SIGNALS_H__
+
+#include <signal.h>
+
+#include <cstring>
+
+using namespace std;
+
+/**
+ * Installs 'handler' for 'signal' without SA_RESTART, so that it interrupts
+ * the wait of a loop that polls, such as --follow's and --serve's, which then
+ * checks the flag the handler set.
+ */
+inline void install_handler(int signal, void (*handler)(int)) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(signal, &action, nullptr);
+}
+
+#endif  // REVERSE_MAKE_SIGNALS_H__
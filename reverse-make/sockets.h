@@ -0,0 +1,84 @@
+#ifndef REVERSE_MAKE_SOCKETS_H__
+#define REVERSE_MAKE_SOCKETS_H__
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstddef>
+
+using namespace std;
+
+// Unix domain sockets that neither leak into child processes nor raise
+// SIGPIPE when the other end has gone. Linux sets this up with flags to
+// socket(), accept4() and send(), which other platforms such as macOS lack, so
+// these do it portably with fcntl() and, where there is no MSG_NOSIGNAL,
+// SO_NOSIGPIPE.
+
+/**
+ * Makes 'fd' close on exec, non-blocking if 'nonblocking' is true, and, where
+ * sends can't ask for it, not raise SIGPIPE.
+ *
+ * @return false, with errno set, if that fails.
+ */
+inline bool set_socket_flags(int fd, bool nonblocking) {
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+    return false;
+  }
+  if (nonblocking) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+      return false;
+    }
+  }
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+  int on = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on)) != 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+/**
+ * Opens a Unix domain stream socket; see set_socket_flags().
+ *
+ * @return The socket, or -1 with errno set.
+ */
+inline int open_unix_socket(bool nonblocking) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && !set_socket_flags(fd, nonblocking)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Accepts a connection on 'listener'; see set_socket_flags().
+ *
+ * @return The connection, or -1 with errno set.
+ */
+inline int accept_connection(int listener, bool nonblocking) {
+  int fd = accept(listener, nullptr, nullptr);
+  if (fd >= 0 && !set_socket_flags(fd, nonblocking)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Sends what send() would, without raising SIGPIPE if the other end has
+ * closed the connection.
+ */
+inline ssize_t send_no_sigpipe(int fd, const void* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  return send(fd, data, size, MSG_NOSIGNAL);
+#else
+  return send(fd, data, size, 0);
+#endif
+}
+
+#endif  // REVERSE_MAKE_SOCKETS_H__
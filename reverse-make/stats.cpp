@@ -0,0 +1,153 @@
+#include "reverse-make/stats.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+namespace {
+
+const char* const kPhaseNames[kNumPhases] = {
+    "read",    "index", "parse",    "split",  "tokenize",
+    "process", "group", "depfiles", "output",
+};
+
+// The order phases are printed in, with the per-line phases under PARSE.
+const Phase kPhaseOrder[kNumPhases] = {
+    Phase::READ,    Phase::INDEX,    Phase::PARSE,
+    Phase::SPLIT,   Phase::TOKENIZE, Phase::PROCESS,
+    Phase::GROUP,   Phase::DEPFILES, Phase::OUTPUT,
+};
+
+bool is_line_phase(Phase phase) {
+  return phase == Phase::SPLIT || phase == Phase::TOKENIZE ||
+         phase == Phase::PROCESS;
+}
+
+// Returns the peak resident set size of the process, in bytes.
+uint64_t peak_rss_bytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  // macOS reports bytes, where Linux reports kilobytes.
+  return uint64_t(usage.ru_maxrss);
+#else
+  return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+double seconds(int64_t ns) { return ns / 1e9; }
+
+}  // namespace
+
+Stats& Stats::Global() {
+  static Stats stats;
+  return stats;
+}
+
+Stats::Stats() : start_(chrono::steady_clock::now()) {}
+
+void Stats::Enable() {
+  Global();
+  enabled_ = true;
+  count_allocations_ = true;
+}
+
+void Stats::AddPhase(Phase phase, int64_t wall_ns, int64_t cpu_ns,
+                     uint64_t allocations) {
+  PhaseStats& stats = phases_[size_t(phase)];
+  stats.wall_ns += wall_ns;
+  stats.cpu_ns += cpu_ns;
+  stats.allocations += allocations;
+}
+
+void Stats::AddThreadTime(Phase phase, int64_t ns) {
+  phases_[size_t(phase)].wall_ns += ns;
+}
+
+int64_t Stats::process_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Stats::PrintText(FILE* out) const {
+  int64_t wall_ns =
+      chrono::nanoseconds(chrono::steady_clock::now() - start_).count();
+  fmt::print(out, "{:<12} {:>10} {:>10} {:>12}\n", "phase", "wall s", "cpu s",
+             "allocations");
+  for (Phase phase : kPhaseOrder) {
+    const PhaseStats& stats = phases_[size_t(phase)];
+    if (is_line_phase(phase)) {
+      // Summed over threads, so there is no separate CPU time.
+      fmt::print(out, "  {:<10} {:>10.4f} {:>10} {:>12}\n",
+                 kPhaseNames[size_t(phase)], seconds(stats.wall_ns), "-", "-");
+    } else {
+      fmt::print(out, "{:<12} {:>10.4f} {:>10.4f} {:>12}\n",
+                 kPhaseNames[size_t(phase)], seconds(stats.wall_ns),
+                 seconds(stats.cpu_ns), stats.allocations.load());
+    }
+  }
+  fmt::print(out, "{:<12} {:>10.4f} {:>10.4f} {:>12}\n", "total",
+             seconds(wall_ns), seconds(process_cpu_ns()), allocations());
+
+  // Throughput is of reading and parsing the log.
+  int64_t parse_ns = phases_[size_t(Phase::READ)].wall_ns +
+                     phases_[size_t(Phase::PARSE)].wall_ns;
+  fmt::print(out, "input:       {} bytes, {} lines\n", counts_.bytes,
+             counts_.lines);
+  if (parse_ns > 0 && counts_.lines > 0) {
+    fmt::print(out, "throughput:  {:.1f} MB/s, {:.0f} lines/s\n",
+               counts_.bytes / 1e6 / seconds(parse_ns),
+               counts_.lines / seconds(parse_ns));
+  }
+  fmt::print(out, "commands:    {} compile, {} link, {} ar, {} skipped\n",
+             counts_.compile_commands, counts_.link_commands,
+             counts_.ar_commands, counts_.skipped_commands);
+  fmt::print(out, "targets:     {}, in {} dependency groups\n",
+             counts_.targets, counts_.dependency_groups);
+  fmt::print(out, "memory:      {} allocations, {:.1f} MB allocated, "
+             "{:.1f} MB peak RSS\n",
+             allocations(), allocated_bytes() / 1e6, peak_rss_bytes() / 1e6);
+}
+
+void Stats::PrintJson(FILE* out) const {
+  int64_t wall_ns =
+      chrono::nanoseconds(chrono::steady_clock::now() - start_).count();
+  fmt::print(out, "{{\"phases\": {{");
+  for (size_t i = 0; i < kNumPhases; i++) {
+    Phase phase = kPhaseOrder[i];
+    const PhaseStats& stats = phases_[size_t(phase)];
+    fmt::print(out, "{}\"{}\": ", i > 0 ? ", " : "",
+               kPhaseNames[size_t(phase)]);
+    if (is_line_phase(phase)) {
+      fmt::print(out, "{{\"thread_s\": {:.6f}}}", seconds(stats.wall_ns));
+    } else {
+      fmt::print(out,
+                 "{{\"wall_s\": {:.6f}, \"cpu_s\": {:.6f}, "
+                 "\"allocations\": {}}}",
+                 seconds(stats.wall_ns), seconds(stats.cpu_ns),
+                 stats.allocations.load());
+    }
+  }
+  int64_t parse_ns = phases_[size_t(Phase::READ)].wall_ns +
+                     phases_[size_t(Phase::PARSE)].wall_ns;
+  double parse_s = parse_ns > 0 ? seconds(parse_ns) : 0;
+  fmt::print(out,
+             "}}, \"wall_s\": {:.6f}, \"cpu_s\": {:.6f}, \"bytes\": {}, "
+             "\"lines\": {}, \"mb_per_s\": {:.3f}, \"lines_per_s\": {:.0f}, "
+             "\"compile_commands\": {}, \"link_commands\": {}, "
+             "\"ar_commands\": {}, \"skipped_commands\": {}, \"targets\": {}, "
+             "\"dependency_groups\": {}, \"allocations\": {}, "
+             "\"allocated_bytes\": {}, \"peak_rss_bytes\": {}}}\n",
+             seconds(wall_ns), seconds(process_cpu_ns()), counts_.bytes,
+             counts_.lines, parse_s > 0 ? counts_.bytes / 1e6 / parse_s : 0,
+             parse_s > 0 ? counts_.lines / parse_s : 0,
+             counts_.compile_commands, counts_.link_commands,
+             counts_.ar_commands, counts_.skipped_commands, counts_.targets,
+             counts_.dependency_groups, allocations(), allocated_bytes(),
+             peak_rss_bytes());
+}
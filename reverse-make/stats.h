@@ -0,0 +1,215 @@
+#ifndef REVERSE_MAKE_STATS_H__
+#define REVERSE_MAKE_STATS_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+/**
+ * The phases of a run that --stats reports on.
+ *
+ * READ, INDEX, PARSE, GROUP, DEPFILES and OUTPUT are timed on the main
+ * thread, and don't overlap. SPLIT, TOKENIZE and PROCESS are the parts of
+ * PARSE that run on each line, and are timed on whichever thread parses the
+ * line, so their times are summed over threads.
+ */
+enum class Phase {
+  READ,      // reading the log into chunks
+  INDEX,     // reading or writing the index, and hashing the log for it
+  PARSE,     // parsing the chunks, across threads, and merging the results
+  SPLIT,     // splitting chunks into logical lines
+  TOKENIZE,  // splitting lines into arguments
+  PROCESS,   // process_gcc_command(), process_ar_command() and adding rows
+  GROUP,     // build_report(), which runs find_deps() on every target
+  DEPFILES,  // reading dependency files, and adding headers to the report
+  OUTPUT,    // print_report()
+};
+constexpr size_t kNumPhases = size_t(Phase::OUTPUT) + 1;
+
+/**
+ * Collects the timings, allocation counts and sizes that --stats reports.
+ *
+ * Nothing is collected unless Enable() has been called; until then every
+ * hook costs a branch on a flag.
+ */
+class Stats {
+ public:
+  /**
+   * What was seen in the log, filled in by whoever sees it.
+   */
+  struct Counts {
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+    uint64_t compile_commands = 0;
+    uint64_t link_commands = 0;
+    uint64_t ar_commands = 0;
+    uint64_t skipped_commands = 0;
+    uint64_t targets = 0;
+    uint64_t dependency_groups = 0;
+  };
+
+  /**
+   * Returns the stats of the whole program, or nullptr if they aren't being
+   * collected.
+   */
+  static Stats* Active() { return enabled_ ? &Global() : nullptr; }
+
+  /**
+   * Starts collecting stats. This should be called before any threads are
+   * started.
+   */
+  static void Enable();
+
+  /**
+   * Adds the time and allocations of one run of a main-thread phase.
+   */
+  void AddPhase(Phase phase, int64_t wall_ns, int64_t cpu_ns,
+                uint64_t allocations);
+
+  /**
+   * Adds time spent by a thread in a per-line phase.
+   */
+  void AddThreadTime(Phase phase, int64_t ns);
+
+  Counts& counts() { return counts_; }
+
+  /**
+   * Prints everything collected so far as aligned text.
+   */
+  void PrintText(FILE* out) const;
+
+  /**
+   * Prints everything collected so far as one JSON object.
+   */
+  void PrintJson(FILE* out) const;
+
+  /**
+   * Counts a call to operator new for 'size' bytes, if stats are enabled.
+   *
+   * The reverse-make binary replaces operator new with one that calls this
+   * (see stats_alloc.cpp). libreverse-make doesn't, so a program that embeds
+   * it keeps its own allocator, and no allocations are counted.
+   */
+  static void CountAllocation(size_t size) {
+    if (count_allocations_.load(memory_order_relaxed)) {
+      allocation_count_.fetch_add(1, memory_order_relaxed);
+      allocation_bytes_.fetch_add(size, memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Returns the number of calls to operator new since Enable() was called.
+   */
+  static uint64_t allocations() { return allocation_count_; }
+
+  /**
+   * Returns the number of bytes asked of operator new since Enable() was
+   * called.
+   */
+  static uint64_t allocated_bytes() { return allocation_bytes_; }
+
+  /**
+   * Returns the CPU time used so far by every thread of the process.
+   */
+  static int64_t process_cpu_ns();
+
+ private:
+  static Stats& Global();
+  Stats();
+
+  struct PhaseStats {
+    atomic<int64_t> wall_ns{0};
+    atomic<int64_t> cpu_ns{0};
+    atomic<uint64_t> allocations{0};
+  };
+
+  inline static bool enabled_ = false;
+  // Only counted once stats are enabled, so that operator new costs nothing
+  // more than a load and a branch otherwise.
+  inline static atomic<bool> count_allocations_{false};
+  inline static atomic<uint64_t> allocation_count_{0};
+  inline static atomic<uint64_t> allocation_bytes_{0};
+  chrono::steady_clock::time_point start_;
+  PhaseStats phases_[kNumPhases];
+  Counts counts_;
+};
+
+/**
+ * Times a main-thread phase from construction to destruction, if stats are
+ * being collected.
+ */
+class ScopedPhase {
+ public:
+  explicit ScopedPhase(Phase phase) : phase_(phase), stats_(Stats::Active()) {
+    if (stats_ != nullptr) {
+      allocations_ = Stats::allocations();
+      cpu_ns_ = Stats::process_cpu_ns();
+      start_ = chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedPhase() {
+    if (stats_ != nullptr) {
+      chrono::nanoseconds wall = chrono::steady_clock::now() - start_;
+      stats_->AddPhase(phase_, wall.count(), Stats::process_cpu_ns() - cpu_ns_,
+                       Stats::allocations() - allocations_);
+    }
+  }
+
+  ScopedPhase(const ScopedPhase&) = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+ private:
+  Phase phase_;
+  Stats* stats_;
+  chrono::steady_clock::time_point start_;
+  int64_t cpu_ns_ = 0;
+  uint64_t allocations_ = 0;
+};
+
+/**
+ * Splits one thread's time between the per-line phases, if stats are being
+ * collected. Each call to Lap() charges the time since the previous one (or
+ * since construction) to a phase. The totals are added to the Stats when the
+ * timer is destroyed, so the shared counters are only touched once per timer.
+ */
+class PhaseTimer {
+ public:
+  PhaseTimer() : stats_(Stats::Active()) {
+    if (stats_ != nullptr) {
+      last_ = chrono::steady_clock::now();
+    }
+  }
+
+  ~PhaseTimer() {
+    if (stats_ != nullptr) {
+      for (size_t phase = 0; phase < kNumPhases; phase++) {
+        if (ns_[phase] > 0) {
+          stats_->AddThreadTime(Phase(phase), ns_[phase]);
+        }
+      }
+    }
+  }
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  void Lap(Phase phase) {
+    if (stats_ != nullptr) {
+      auto now = chrono::steady_clock::now();
+      ns_[size_t(phase)] += chrono::nanoseconds(now - last_).count();
+      last_ = now;
+    }
+  }
+
+ private:
+  Stats* stats_;
+  chrono::steady_clock::time_point last_;
+  int64_t ns_[kNumPhases] = {};
+};
+
+#endif  // REVERSE_MAKE_STATS_H__
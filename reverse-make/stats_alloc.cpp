@@ -0,0 +1,22 @@
+#include <cstdlib>
+#include <new>
+
+#include "reverse-make/stats.h"
+
+// The reverse-make binary's operator new, which counts allocations for
+// --stats. This file is linked into the binary only, not into
+// libreverse-make, so that programs embedding the library keep their own
+// allocator.
+
+void* operator new(size_t size) {
+  Stats::CountAllocation(size);
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
@@ -0,0 +1,329 @@
+#include "reverse-make/target_graph.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include "reverse-make/parallel.h"
+
+namespace {
+
+using RowId = CommandTable::RowId;
+
+const vector<RowId> kNoRows;
+
+/**
+ * Sorts 'rows' and removes duplicates.
+ */
+void sort_unique(vector<RowId>* rows) {
+  sort(rows->begin(), rows->end());
+  rows->erase(unique(rows->begin(), rows->end()), rows->end());
+}
+
+}  // namespace
+
+TargetGraph::TargetGraph(const CommandTable& commands,
+                         const FlagGroups& flag_groups, int jobs)
+    : commands_(commands),
+      flag_groups_(flag_groups),
+      component_of_(commands.size(), kNoComponent),
+      uses_(commands.size()) {
+  PathTable& paths = PathTable::Global();
+
+  vector<RowId> targets;
+  // The targets by output path, for finding the libraries -l flags name.
+  // Output paths are canonical already.
+  unordered_map<string_view, RowId> libraries;
+  for (RowId row = 0; row < commands.size(); row++) {
+    if (commands.kind(row) != CommandKind::COMPILE) {
+      targets.push_back(row);
+      libraries.emplace(paths.Lookup(commands.output(row)), row);
+    }
+  }
+
+  // The objects and targets each target uses directly.
+  vector<vector<RowId>> objects(targets.size());
+  parallel_for(targets.size(), jobs, [&](size_t i) {
+    RowId target = targets[i];
+    vector<RowId>& uses = uses_[target];
+    string scratch;
+    for (PathId input : commands.inputs(target)) {
+      RowId object = commands.Find(CommandKind::COMPILE, input);
+      if (object != CommandTable::kNoRow) {
+        objects[i].push_back(object);
+        continue;
+      }
+      for (CommandKind kind : {CommandKind::AR, CommandKind::LINK}) {
+        RowId used = commands.Find(kind, input);
+        if (used != CommandTable::kNoRow && used != target) {
+          uses.push_back(used);
+        }
+      }
+    }
+    if (commands.kind(target) == CommandKind::LINK) {
+      // The -L flags in the order the command gave them, which is the order
+      // the linker searches them in.
+      const vector<uint32_t>& dir_set =
+          commands.flag_set(target, FlagField::LINK_SEARCH_DIRS).ids();
+      vector<uint32_t> dirs;
+      for (uint32_t flag : commands.flag_list(target).ids()) {
+        if (binary_search(dir_set.begin(), dir_set.end(), flag)) {
+          dirs.push_back(flag);
+        }
+      }
+      for (uint32_t lib : commands.flag_set(target, FlagField::LINK_LIBS)
+                              .ids()) {
+        // "-lfoo" is the first of libfoo.so and libfoo.a in the -L
+        // directories.
+        string_view name = FlagInterner::Global().Lookup(lib).substr(2);
+        for (uint32_t dir_flag : dirs) {
+          string_view dir = FlagInterner::Global().Lookup(dir_flag).substr(2);
+          if (dir.empty()) {
+            dir = ".";
+          }
+          auto it = libraries.find(normalize_path(
+              fmt::format("{}/lib{}.so", dir, name), &scratch));
+          if (it == libraries.end()) {
+            it = libraries.find(normalize_path(
+                fmt::format("{}/lib{}.a", dir, name), &scratch));
+          }
+          if (it != libraries.end() && it->second != target) {
+            uses.push_back(it->second);
+            break;
+          }
+        }
+      }
+    }
+    sort_unique(&uses);
+  });
+
+  // Tarjan's algorithm finds the cycles, and hands out every set of targets
+  // in a cycle (or lone target) after the ones it uses.
+  constexpr uint32_t kUnvisited = ~uint32_t(0);
+  vector<uint32_t> index_of(commands.size(), kUnvisited);
+  vector<uint32_t> low(commands.size());
+  vector<bool> on_stack(commands.size(), false);
+  vector<RowId> stack;
+  // The targets being searched, with the next of their uses to follow.
+  vector<pair<RowId, size_t>> calls;
+  uint32_t next_index = 0;
+  for (size_t i = 0; i < targets.size(); i++) {
+    if (index_of[targets[i]] != kUnvisited) {
+      continue;
+    }
+    calls.emplace_back(targets[i], 0);
+    while (!calls.empty()) {
+      auto [target, next] = calls.back();
+      if (next == 0) {
+        index_of[target] = low[target] = next_index++;
+        stack.push_back(target);
+        on_stack[target] = true;
+      }
+      if (next < uses_[target].size()) {
+        calls.back().second++;
+        RowId used = uses_[target][next];
+        if (index_of[used] == kUnvisited) {
+          calls.emplace_back(used, 0);
+        } else if (on_stack[used]) {
+          low[target] = min(low[target], index_of[used]);
+        }
+        continue;
+      }
+      calls.pop_back();
+      if (!calls.empty()) {
+        RowId caller = calls.back().first;
+        low[caller] = min(low[caller], low[target]);
+      }
+      if (low[target] != index_of[target]) {
+        continue;
+      }
+      uint32_t component = components_.size();
+      components_.emplace_back();
+      RowId member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        on_stack[member] = false;
+        component_of_[member] = component;
+        components_[component].members.push_back(member);
+      } while (member != target);
+    }
+  }
+
+  // What each component uses, and its level. A component only uses
+  // components handed out before it.
+  uint32_t num_levels = 0;
+  for (uint32_t c = 0; c < components_.size(); c++) {
+    Component& component = components_[c];
+    sort(component.members.begin(), component.members.end());
+    for (RowId member : component.members) {
+      order_.push_back(member);
+      for (RowId used : uses_[member]) {
+        if (component_of_[used] != c) {
+          component.uses.push_back(component_of_[used]);
+        }
+      }
+    }
+    sort(component.uses.begin(), component.uses.end());
+    component.uses.erase(unique(component.uses.begin(), component.uses.end()),
+                         component.uses.end());
+    for (uint32_t used : component.uses) {
+      component.level = max(component.level, components_[used].level + 1);
+    }
+    num_levels = max(num_levels, component.level + 1);
+    if (component.members.size() > 1) {
+      cycles_.push_back(component.members);
+    }
+  }
+
+  // Work out the transitive targets and objects a level at a time; the
+  // components of a level don't use each other.
+  vector<vector<uint32_t>> levels(num_levels);
+  for (uint32_t c = 0; c < components_.size(); c++) {
+    levels[components_[c].level].push_back(c);
+  }
+  vector<size_t> target_index(commands.size());
+  for (size_t i = 0; i < targets.size(); i++) {
+    target_index[targets[i]] = i;
+  }
+  for (const vector<uint32_t>& level : levels) {
+    parallel_for(level.size(), jobs, [&](size_t i) {
+      Component& component = components_[level[i]];
+      if (component.members.size() > 1) {
+        component.targets = component.members;
+      }
+      for (RowId member : component.members) {
+        const vector<RowId>& own = objects[target_index[member]];
+        component.objects.insert(component.objects.end(), own.begin(),
+                                 own.end());
+      }
+      for (uint32_t c : component.uses) {
+        const Component& used = components_[c];
+        component.targets.insert(component.targets.end(),
+                                 used.members.begin(), used.members.end());
+        component.targets.insert(component.targets.end(),
+                                 used.targets.begin(), used.targets.end());
+        component.objects.insert(component.objects.end(),
+                                 used.objects.begin(), used.objects.end());
+      }
+      sort_unique(&component.targets);
+      sort_unique(&component.objects);
+    });
+  }
+
+  // The final artifacts are the targets nothing outside their cycle uses.
+  vector<bool> used(components_.size(), false);
+  for (const Component& component : components_) {
+    for (uint32_t c : component.uses) {
+      used[c] = true;
+    }
+  }
+  for (RowId target : targets) {
+    if (!used[component_of_[target]]) {
+      finals_.push_back(target);
+    }
+  }
+  sort(finals_.begin(), finals_.end(), [&](RowId a, RowId b) {
+    return paths.Lookup(commands.output(a)) < paths.Lookup(commands.output(b));
+  });
+}
+
+const vector<TargetGraph::RowId>& TargetGraph::uses(RowId target) const {
+  return uses_[target];
+}
+
+const vector<TargetGraph::RowId>& TargetGraph::transitive_targets(
+    RowId target) const {
+  uint32_t component = component_of_[target];
+  return component == kNoComponent ? kNoRows : components_[component].targets;
+}
+
+const vector<TargetGraph::RowId>& TargetGraph::transitive_objects(
+    RowId target) const {
+  uint32_t component = component_of_[target];
+  return component == kNoComponent ? kNoRows : components_[component].objects;
+}
+
+vector<PathId> TargetGraph::TransitiveSources(RowId target) const {
+  PathTable& paths = PathTable::Global();
+  vector<pair<string_view, PathId>> keyed;
+  for (RowId object : transitive_objects(target)) {
+    for (PathId source : commands_.inputs(object)) {
+      keyed.emplace_back(paths.Lookup(source), source);
+    }
+  }
+  sort(keyed.begin(), keyed.end());
+  vector<PathId> sources;
+  for (auto& [path, id] : keyed) {
+    if (sources.empty() || sources.back() != id) {
+      sources.push_back(id);
+    }
+  }
+  return sources;
+}
+
+vector<FlagGroups::GroupId> TargetGraph::TransitiveGroups(RowId target) const {
+  vector<FlagGroups::GroupId> groups;
+  for (RowId object : transitive_objects(target)) {
+    groups.push_back(flag_groups_.group(object));
+  }
+  sort(groups.begin(), groups.end());
+  groups.erase(unique(groups.begin(), groups.end()), groups.end());
+  return groups;
+}
+
+void print_target_graph(const CommandTable& commands, const TargetGraph& graph,
+                        FILE* out) {
+  PathTable& paths = PathTable::Global();
+  auto outputs = [&](const vector<RowId>& rows) {
+    vector<string_view> outputs;
+    for (RowId row : rows) {
+      outputs.push_back(paths.Lookup(commands.output(row)));
+    }
+    return outputs;
+  };
+
+  for (const vector<RowId>& cycle : graph.cycles()) {
+    fmt::print(out, "WARNING: Targets {} use each other in a cycle.\n",
+               outputs(cycle));
+  }
+
+  for (RowId target : graph.finals()) {
+    const vector<RowId>& objects = graph.transitive_objects(target);
+    vector<FlagGroups::GroupId> groups = graph.TransitiveGroups(target);
+    fmt::print(out, "----------------------------------------------------\n");
+    fmt::print(out,
+               "Final artifact: {} is built from {} sources in {} flag "
+               "groups, through {} other targets: {}\n",
+               paths.Lookup(commands.output(target)),
+               graph.TransitiveSources(target).size(), groups.size(),
+               graph.transitive_targets(target).size(),
+               outputs(graph.transitive_targets(target)));
+    fmt::print(out, "----------------------------------------------------\n");
+    // The sources of each group, in order of path.
+    unordered_map<FlagGroups::GroupId, vector<PathId>> sources_of;
+    for (RowId object : objects) {
+      PathList inputs = commands.inputs(object);
+      sources_of[graph.flag_groups().group(object)].insert(
+          sources_of[graph.flag_groups().group(object)].end(), inputs.begin(),
+          inputs.end());
+    }
+    for (FlagGroups::GroupId group : groups) {
+      vector<string_view> sources;
+      for (PathId source : sources_of[group]) {
+        sources.push_back(paths.Lookup(source));
+      }
+      sort(sources.begin(), sources.end());
+      sources.erase(unique(sources.begin(), sources.end()), sources.end());
+      fmt::print(out, "  Flag group {}: {} sources: {}\n", group,
+                 sources.size(), sources);
+    }
+  }
+}
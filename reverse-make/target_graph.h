@@ -0,0 +1,125 @@
+#ifndef REVERSE_MAKE_TARGET_GRAPH_H__
+#define REVERSE_MAKE_TARGET_GRAPH_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/paths.h"
+
+using namespace std;
+
+/**
+ * The graph of the ar and link targets of a build, through the objects and
+ * libraries each one is made from.
+ *
+ * A target uses the objects and the other targets among its inputs, and the
+ * libraries its -l flags name that the build made in one of its -L
+ * directories, searched in the order the command gave them. Shared libraries count like archives: a program that links one
+ * depends on every source in it.
+ *
+ * Targets that use each other in a cycle, which a sane build doesn't have,
+ * are treated as one, so each of them depends on everything any of them does.
+ *
+ * The transitive objects of every target are worked out once, when the graph
+ * is built: targets are evaluated a level at a time, in parallel within each
+ * level, and each target reuses the results of the targets it uses rather
+ * than walking them again.
+ */
+class TargetGraph {
+ public:
+  using RowId = CommandTable::RowId;
+
+  /**
+   * Builds the graph of the ar and link rows of 'commands'.
+   *
+   * @param commands The commands of the build.
+   * @param flag_groups The flag groups of 'commands'.
+   * @param jobs The number of threads to evaluate targets on.
+   */
+  TargetGraph(const CommandTable& commands, const FlagGroups& flag_groups,
+              int jobs);
+
+  /**
+   * Returns every target, each after the targets it uses. The targets of a
+   * cycle are next to each other, in no particular order.
+   */
+  const vector<RowId>& order() const { return order_; }
+
+  /**
+   * Returns the targets that no other target uses: the build's final
+   * artifacts, ordered by output path.
+   */
+  const vector<RowId>& finals() const { return finals_; }
+
+  /**
+   * Returns each set of targets that use each other in a cycle.
+   */
+  const vector<vector<RowId>>& cycles() const { return cycles_; }
+
+  /**
+   * Returns the targets 'target' uses directly, ordered by row.
+   */
+  const vector<RowId>& uses(RowId target) const;
+
+  /**
+   * Returns every target 'target' uses, directly or not, ordered by row. A
+   * target in a cycle is among its own.
+   */
+  const vector<RowId>& transitive_targets(RowId target) const;
+
+  /**
+   * Returns the compile command of every object 'target' is made from,
+   * directly or through the targets it uses, ordered by row.
+   */
+  const vector<RowId>& transitive_objects(RowId target) const;
+
+  /**
+   * Returns the sources of transitive_objects(), ordered by path.
+   */
+  vector<PathId> TransitiveSources(RowId target) const;
+
+  /**
+   * Returns the distinct flag groups of transitive_objects(), in order of
+   * their number.
+   */
+  vector<FlagGroups::GroupId> TransitiveGroups(RowId target) const;
+
+  const FlagGroups& flag_groups() const { return flag_groups_; }
+
+ private:
+  // Everything known about a set of targets that use each other in a cycle,
+  // or, far more often, about a single target.
+  struct Component {
+    vector<RowId> members;
+    // The other components the members use.
+    vector<uint32_t> uses;
+    // The length of the longest chain of components below this one.
+    uint32_t level = 0;
+    vector<RowId> targets;
+    vector<RowId> objects;
+  };
+
+  const CommandTable& commands_;
+  const FlagGroups& flag_groups_;
+  // The component of each row, or kNoComponent if it isn't a target.
+  static constexpr uint32_t kNoComponent = ~uint32_t(0);
+  vector<uint32_t> component_of_;
+  // Each after the components it uses.
+  vector<Component> components_;
+  vector<RowId> order_;
+  vector<RowId> finals_;
+  vector<vector<RowId>> cycles_;
+  vector<vector<RowId>> uses_;
+};
+
+/**
+ * Prints the final artifacts of 'graph' with every source and flag group
+ * they depend on, and warns about cycles.
+ */
+void print_target_graph(const CommandTable& commands, const TargetGraph& graph,
+                        FILE* out = stdout);
+
+#endif  // REVERSE_MAKE_TARGET_GRAPH_H__
@@ -0,0 +1,293 @@
+#include "reverse-make/timing_report.h"
+
+#include <algorithm>
+#include <queue>
+#include <string>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "reverse-make/flag_groups.h"
+
+namespace {
+
+using RowId = CommandTable::RowId;
+
+/**
+ * Returns the row that builds 'path', or kNoRow if nothing does.
+ */
+RowId producer(const CommandTable& commands, PathId path) {
+  for (CommandKind kind :
+       {CommandKind::COMPILE, CommandKind::AR, CommandKind::LINK}) {
+    RowId row = commands.Find(kind, path);
+    if (row != CommandTable::kNoRow) {
+      return row;
+    }
+  }
+  return CommandTable::kNoRow;
+}
+
+string seconds_string(double seconds) {
+  return fmt::format("{:.2f}s", seconds);
+}
+
+}  // namespace
+
+TimingReport build_timing_report(const CommandTable& commands,
+                                 const CommandTimings& timings, int jobs,
+                                 size_t top_n) {
+  TimingReport report;
+  report.jobs = max(jobs, 1);
+  size_t n = commands.size();
+
+  vector<double> own(n, 0);
+  for (RowId row = 0; row < n; row++) {
+    double seconds = timings.seconds(commands.output(row));
+    if (seconds >= 0) {
+      own[row] = seconds;
+      report.timed++;
+    } else {
+      report.untimed++;
+    }
+    report.cpu += own[row];
+  }
+
+  // The commands each command depends on, back to back.
+  vector<uint32_t> dep_offsets(n + 1);
+  vector<RowId> deps;
+  for (RowId row = 0; row < n; row++) {
+    dep_offsets[row] = deps.size();
+    for (PathId input : commands.inputs(row)) {
+      RowId dep = producer(commands, input);
+      if (dep != CommandTable::kNoRow && dep != row) {
+        deps.push_back(dep);
+      }
+    }
+  }
+  dep_offsets[n] = deps.size();
+
+  // Depth-first search for when each command would finish with unlimited
+  // jobs. An edge back to a command still being searched closes a cycle, and
+  // is dropped.
+  enum : uint8_t { UNVISITED, ACTIVE, DONE };
+  vector<uint8_t> state(n, UNVISITED);
+  vector<bool> kept(deps.size(), false);
+  vector<double> finish(n, 0);
+  // The dependency each command waits for longest, if any.
+  vector<RowId> via(n, CommandTable::kNoRow);
+  // Every command after the commands it depends on.
+  vector<RowId> order;
+  order.reserve(n);
+  // The commands being searched, with the next of their edges to follow.
+  vector<pair<RowId, uint32_t>> stack;
+  for (RowId root = 0; root < n; root++) {
+    if (state[root] != UNVISITED) {
+      continue;
+    }
+    state[root] = ACTIVE;
+    stack.emplace_back(root, dep_offsets[root]);
+    while (!stack.empty()) {
+      auto [row, edge] = stack.back();
+      if (edge < dep_offsets[row + 1]) {
+        stack.back().second++;
+        RowId dep = deps[edge];
+        if (state[dep] == ACTIVE) {
+          continue;
+        }
+        kept[edge] = true;
+        if (state[dep] == UNVISITED) {
+          state[dep] = ACTIVE;
+          stack.emplace_back(dep, dep_offsets[dep]);
+        }
+        continue;
+      }
+      stack.pop_back();
+      double start = 0;
+      for (uint32_t e = dep_offsets[row]; e < dep_offsets[row + 1]; e++) {
+        if (kept[e] && (via[row] == CommandTable::kNoRow ||
+                        finish[deps[e]] > start)) {
+          start = finish[deps[e]];
+          via[row] = deps[e];
+        }
+      }
+      finish[row] = start + own[row];
+      state[row] = DONE;
+      order.push_back(row);
+    }
+  }
+
+  if (n > 0) {
+    RowId last = max_element(finish.begin(), finish.end()) - finish.begin();
+    report.critical_path = finish[last];
+    for (RowId row = last; row != CommandTable::kNoRow; row = via[row]) {
+      report.critical_commands.push_back({row, own[row], finish[row]});
+    }
+    reverse(report.critical_commands.begin(), report.critical_commands.end());
+  }
+  report.best_wall = max(report.cpu / report.jobs, report.critical_path);
+
+  // The longest chain of commands from each command to the end of the build,
+  // including it, and the commands that depend on each command.
+  vector<double> tail(own);
+  vector<uint32_t> dependent_offsets(n + 1, 0);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    RowId row = *it;
+    for (uint32_t e = dep_offsets[row]; e < dep_offsets[row + 1]; e++) {
+      if (kept[e]) {
+        RowId dep = deps[e];
+        tail[dep] = max(tail[dep], own[dep] + tail[row]);
+        dependent_offsets[dep + 1]++;
+      }
+    }
+  }
+  for (size_t row = 0; row < n; row++) {
+    dependent_offsets[row + 1] += dependent_offsets[row];
+  }
+  vector<RowId> dependents(dependent_offsets[n]);
+  vector<uint32_t> fill(dependent_offsets.begin(), dependent_offsets.end() - 1);
+  vector<uint32_t> waiting(n, 0);
+  for (RowId row = 0; row < n; row++) {
+    for (uint32_t e = dep_offsets[row]; e < dep_offsets[row + 1]; e++) {
+      if (kept[e]) {
+        dependents[fill[deps[e]]++] = row;
+        waiting[row]++;
+      }
+    }
+  }
+
+  // Schedule the build on 'jobs' jobs, starting the ready command with the
+  // longest tail whenever a job frees up.
+  priority_queue<pair<double, RowId>> ready;
+  for (RowId row = 0; row < n; row++) {
+    if (waiting[row] == 0) {
+      ready.emplace(tail[row], row);
+    }
+  }
+  priority_queue<pair<double, RowId>, vector<pair<double, RowId>>,
+                 greater<pair<double, RowId>>>
+      running;
+  double now = 0;
+  while (!ready.empty() || !running.empty()) {
+    while (!ready.empty() && running.size() < size_t(report.jobs)) {
+      RowId row = ready.top().second;
+      ready.pop();
+      running.emplace(now + own[row], row);
+    }
+    auto [end, row] = running.top();
+    running.pop();
+    now = end;
+    for (uint32_t i = dependent_offsets[row]; i < dependent_offsets[row + 1];
+         i++) {
+      RowId dependent = dependents[i];
+      if (--waiting[dependent] == 0) {
+        ready.emplace(tail[dependent], dependent);
+      }
+    }
+  }
+  report.scheduled_wall = now;
+
+  // The slowest compiles and the latest targets.
+  for (RowId row = 0; row < n; row++) {
+    TimingReport::Entry entry{row, own[row], finish[row]};
+    if (commands.kind(row) == CommandKind::COMPILE) {
+      if (own[row] > 0) {
+        report.slowest_compiles.push_back(entry);
+      }
+    } else {
+      report.latest_targets.push_back(entry);
+    }
+  }
+  auto top = [&](vector<TimingReport::Entry>* entries, auto key) {
+    size_t keep = min(top_n, entries->size());
+    partial_sort(entries->begin(), entries->begin() + keep, entries->end(),
+                 [&](const TimingReport::Entry& a,
+                     const TimingReport::Entry& b) {
+                   return key(a) != key(b) ? key(a) > key(b) : a.row < b.row;
+                 });
+    entries->resize(keep);
+  };
+  top(&report.slowest_compiles,
+      [](const TimingReport::Entry& entry) { return entry.seconds; });
+  top(&report.latest_targets,
+      [](const TimingReport::Entry& entry) { return entry.finish; });
+
+  // The time of each flag group.
+  FlagGroups flag_groups(commands);
+  report.groups.resize(flag_groups.size());
+  for (RowId row = n; row-- > 0;) {
+    FlagGroups::GroupId group = flag_groups.group(row);
+    if (group != FlagGroups::kNoGroup) {
+      report.groups[group].example = row;
+      report.groups[group].compiles++;
+      report.groups[group].seconds += own[row];
+    }
+  }
+  stable_sort(report.groups.begin(), report.groups.end(),
+              [](const TimingReport::GroupTime& a,
+                 const TimingReport::GroupTime& b) {
+                return a.seconds > b.seconds;
+              });
+  report.groups.resize(min(top_n, report.groups.size()));
+  return report;
+}
+
+void print_timing_report(const CommandTable& commands,
+                         const TimingReport& report, FILE* out) {
+  PathTable& paths = PathTable::Global();
+  auto output = [&](RowId row) { return paths.Lookup(commands.output(row)); };
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "Build timings: {} of {} commands timed, {} of CPU time:\n",
+             report.timed, report.timed + report.untimed,
+             seconds_string(report.cpu));
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "  critical path: {} through {} commands:\n",
+             seconds_string(report.critical_path),
+             report.critical_commands.size());
+  for (const TimingReport::Entry& entry : report.critical_commands) {
+    fmt::print(out, "    {:>10} {}\n", seconds_string(entry.seconds),
+               output(entry.row));
+  }
+  if (report.critical_path > 0) {
+    fmt::print(out, "  parallelism:   {:.1f} (CPU time / critical path)\n",
+               report.cpu / report.critical_path);
+  }
+  fmt::print(out, "  on {} jobs:    at least {}", report.jobs,
+             seconds_string(report.best_wall));
+  if (report.best_wall > 0) {
+    fmt::print(out, " ({:.2f}x)", report.cpu / report.best_wall);
+  }
+  fmt::print(out, ", {} scheduling the longest chains first",
+             seconds_string(report.scheduled_wall));
+  if (report.scheduled_wall > 0) {
+    fmt::print(out, " ({:.2f}x)", report.cpu / report.scheduled_wall);
+  }
+  fmt::print(out, "\n");
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "Slowest compiles:\n");
+  fmt::print(out, "----------------------------------------------------\n");
+  for (const TimingReport::Entry& entry : report.slowest_compiles) {
+    fmt::print(out, "  {:>10} {}\n", seconds_string(entry.seconds),
+               output(entry.row));
+  }
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "Latest targets, finishing with unlimited jobs after:\n");
+  fmt::print(out, "----------------------------------------------------\n");
+  for (const TimingReport::Entry& entry : report.latest_targets) {
+    fmt::print(out, "  {:>10} {} (itself {})\n", seconds_string(entry.finish),
+               output(entry.row), seconds_string(entry.seconds));
+  }
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "CPU time by group of compiles with matching flags:\n");
+  fmt::print(out, "----------------------------------------------------\n");
+  for (const TimingReport::GroupTime& group : report.groups) {
+    fmt::print(out, "  {:>10} {:>5.1f}% {} compiles with the flags of {}\n",
+               seconds_string(group.seconds),
+               report.cpu > 0 ? 100 * group.seconds / report.cpu : 0,
+               group.compiles, output(group.example));
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef REVERSE_MAKE_TIMING_REPORT_H__
+#define REVERSE_MAKE_TIMING_REPORT_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/timings.h"
+
+using namespace std;
+
+/**
+ * Where the time of a build went, and how far running more jobs could cut it.
+ */
+struct TimingReport {
+  // A command, how long it took, and when it finished if the build had
+  // unlimited jobs.
+  struct Entry {
+    CommandTable::RowId row;
+    double seconds;
+    double finish;
+  };
+
+  // The number of commands with a timing, and without. Untimed commands count
+  // as taking no time.
+  size_t timed = 0;
+  size_t untimed = 0;
+  // The time of every command added up, in seconds.
+  double cpu = 0;
+  // The longest chain of commands that each use the output of the one before,
+  // in seconds, and its commands, first to last. No number of jobs can build
+  // faster than this.
+  double critical_path = 0;
+  vector<Entry> critical_commands;
+  // The number of jobs predicted for.
+  int jobs = 1;
+  // The least wall time possible on 'jobs' jobs: the larger of the CPU time
+  // shared evenly between them and the critical path.
+  double best_wall = 0;
+  // The wall time on 'jobs' jobs when, whenever a job is free, it starts the
+  // ready command with the longest chain of commands waiting on it.
+  double scheduled_wall = 0;
+  // The slowest compile commands, slowest first, and the link and ar targets
+  // that finish last, latest first.
+  vector<Entry> slowest_compiles;
+  vector<Entry> latest_targets;
+  // The CPU time spent on the groups of compiles with matching flags that
+  // took most, most first.
+  struct GroupTime {
+    // The first compile of the group; its flags are the group's.
+    CommandTable::RowId example = 0;
+    size_t compiles = 0;
+    double seconds = 0;
+  };
+  vector<GroupTime> groups;
+};
+
+/**
+ * Works out the critical path of a build, and where its time went.
+ *
+ * Commands form a graph through their inputs: a command depends on the
+ * commands that build its inputs. A cycle, which a sane build doesn't have,
+ * is broken at an arbitrary edge.
+ *
+ * @param commands The commands of the build.
+ * @param timings How long the commands took.
+ * @param jobs The number of jobs to predict the wall time for.
+ * @param top_n How many of the slowest compiles, latest targets and most
+ * expensive flag groups to list.
+ */
+TimingReport build_timing_report(const CommandTable& commands,
+                                 const CommandTimings& timings, int jobs,
+                                 size_t top_n);
+
+/**
+ * Prints a report built by build_timing_report() from 'commands'.
+ */
+void print_timing_report(const CommandTable& commands,
+                         const TimingReport& report, FILE* out = stdout);
+
+#endif  // REVERSE_MAKE_TIMING_REPORT_H__
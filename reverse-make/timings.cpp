@@ -0,0 +1,278 @@
+#include "reverse-make/timings.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+namespace {
+
+constexpr string_view kNinjaLogHeader = "# ninja log v";
+
+/**
+ * Splits 'line' at tabs into at most 'max_fields' fields.
+ *
+ * @return The number of fields.
+ */
+size_t split_tabs(string_view line, string_view* fields, size_t max_fields) {
+  size_t n = 0;
+  while (n < max_fields) {
+    size_t tab = line.find('\t');
+    fields[n++] = line.substr(0, tab);
+    if (tab == string_view::npos) {
+      break;
+    }
+    line.remove_prefix(tab + 1);
+  }
+  return n;
+}
+
+bool parse_int(string_view str, long long* value) {
+  if (str.empty()) {
+    return false;
+  }
+  string copy(str);
+  char* end;
+  *value = strtoll(copy.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+bool take_char(string_view* str, char c) {
+  if (str->empty() || (*str)[0] != c) {
+    return false;
+  }
+  str->remove_prefix(1);
+  return true;
+}
+
+/**
+ * Reads between 'min' and 'max' digits from the front of 'str'.
+ */
+bool take_digits(string_view* str, size_t min, size_t max, long long* value) {
+  size_t n = 0;
+  *value = 0;
+  while (n < max && n < str->size() && (*str)[n] >= '0' && (*str)[n] <= '9') {
+    *value = *value * 10 + ((*str)[n] - '0');
+    n++;
+  }
+  if (n < min) {
+    return false;
+  }
+  str->remove_prefix(n);
+  return true;
+}
+
+/**
+ * Reads a fraction of a second, like ".25", from the front of 'str', if it
+ * starts with one.
+ */
+double take_fraction(string_view* str) {
+  if (str->size() < 2 || ((*str)[0] != '.' && (*str)[0] != ',') ||
+      (*str)[1] < '0' || (*str)[1] > '9') {
+    return 0;
+  }
+  str->remove_prefix(1);
+  double fraction = 0;
+  double scale = 0.1;
+  while (!str->empty() && (*str)[0] >= '0' && (*str)[0] <= '9') {
+    fraction += ((*str)[0] - '0') * scale;
+    scale /= 10;
+    str->remove_prefix(1);
+  }
+  return fraction;
+}
+
+/**
+ * Reads "HH:MM:SS[.frac]" from the front of 'str'.
+ */
+bool take_time_of_day(string_view* str, double* seconds) {
+  long long hours, minutes, secs;
+  if (!take_digits(str, 1, 2, &hours) || !take_char(str, ':') ||
+      !take_digits(str, 2, 2, &minutes) || !take_char(str, ':') ||
+      !take_digits(str, 2, 2, &secs)) {
+    return false;
+  }
+  *seconds = hours * 3600 + minutes * 60 + secs + take_fraction(str);
+  return true;
+}
+
+/**
+ * Returns the number of days from 1970-01-01 to the given date.
+ */
+long long days_from_civil(long long year, long long month, long long day) {
+  year -= month <= 2;
+  long long era = (year >= 0 ? year : year - 399) / 400;
+  long long year_of_era = year - era * 400;
+  long long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 +
+                          day - 1;
+  long long day_of_era = year_of_era * 365 + year_of_era / 4 -
+                         year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+bool take_month(string_view* str, long long* month) {
+  static constexpr string_view kMonths[] = {"Jan", "Feb", "Mar", "Apr",
+                                            "May", "Jun", "Jul", "Aug",
+                                            "Sep", "Oct", "Nov", "Dec"};
+  for (long long i = 0; i < 12; i++) {
+    if (str->substr(0, 3) == kMonths[i]) {
+      str->remove_prefix(3);
+      *month = i + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool take_timestamp(string_view* str, double* seconds) {
+  string_view rest = *str;
+  long long year, month, day;
+  double time;
+  if (take_month(&rest, &month)) {
+    // "Oct 16 12:00:01", as ts writes by default. The year doesn't matter
+    // unless the build ran over new year.
+    if (!take_char(&rest, ' ')) {
+      return false;
+    }
+    take_char(&rest, ' ');
+    if (!take_digits(&rest, 1, 2, &day) || !take_char(&rest, ' ') ||
+        !take_time_of_day(&rest, &time)) {
+      return false;
+    }
+    *seconds = days_from_civil(2001, month, day) * 86400.0 + time;
+    *str = rest;
+    return true;
+  }
+
+  string_view digits = rest;
+  long long number;
+  if (!take_digits(&rest, 1, 20, &number)) {
+    return false;
+  }
+  size_t num_digits = digits.size() - rest.size();
+  if (num_digits == 4 && take_char(&rest, '-')) {
+    // "2023-10-16T12:00:01".
+    year = number;
+    if (!take_digits(&rest, 2, 2, &month) || !take_char(&rest, '-') ||
+        !take_digits(&rest, 2, 2, &day) ||
+        (!take_char(&rest, 'T') && !take_char(&rest, ' ')) ||
+        !take_time_of_day(&rest, &time)) {
+      return false;
+    }
+    take_char(&rest, 'Z');
+    *seconds = days_from_civil(year, month, day) * 86400.0 + time;
+    *str = rest;
+    return true;
+  }
+  if (num_digits <= 2) {
+    // "12:00:01".
+    rest = digits;
+    if (!take_time_of_day(&rest, &time)) {
+      return false;
+    }
+    *seconds = time;
+    *str = rest;
+    return true;
+  }
+  if (num_digits >= 9) {
+    // "1697457601.25".
+    *seconds = number + take_fraction(&rest);
+    *str = rest;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+bool strip_timestamp(string_view* line, double* seconds) {
+  string_view rest = *line;
+  bool bracketed = take_char(&rest, '[');
+  double time;
+  if (!take_timestamp(&rest, &time) ||
+      (bracketed && !take_char(&rest, ']'))) {
+    return false;
+  }
+  // The timestamp must be a word of its own.
+  if (!rest.empty() && rest[0] != ' ' && rest[0] != '\t') {
+    return false;
+  }
+  while (!rest.empty() && (rest[0] == ' ' || rest[0] == '\t')) {
+    rest.remove_prefix(1);
+  }
+  *line = rest;
+  *seconds = time;
+  return true;
+}
+
+bool CommandTimings::ReadFile(const string& filename, string* error) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) {
+    *error = fmt::format("Unable to open file: {}", filename);
+    return false;
+  }
+  string contents;
+  char block[1 << 16];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+    contents.append(block, n);
+  }
+  fclose(file);
+
+  if (contents.compare(0, kNinjaLogHeader.size(), kNinjaLogHeader) == 0) {
+    if (!ReadNinjaLog(contents, error)) {
+      *error = fmt::format("{}: {}", filename, *error);
+      return false;
+    }
+    return true;
+  }
+  *error = fmt::format("{} isn't a timings file that can be read", filename);
+  return false;
+}
+
+bool CommandTimings::ReadNinjaLog(string_view contents, string* error) {
+  // After the header, each line is
+  // "<start ms>\t<end ms>\t<mtime>\t<output>\t<command hash>".
+  PathTable& paths = PathTable::Global();
+  string scratch;
+  int line_number = 0;
+  while (!contents.empty()) {
+    size_t newline = contents.find('\n');
+    string_view line = contents.substr(0, newline);
+    contents.remove_prefix(newline == string_view::npos ? contents.size()
+                                                        : newline + 1);
+    line_number++;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    string_view fields[5];
+    long long start_ms, end_ms;
+    if (split_tabs(line, fields, 5) != 5 || !parse_int(fields[0], &start_ms) ||
+        !parse_int(fields[1], &end_ms) || end_ms < start_ms) {
+      *error = fmt::format("malformed line {}", line_number);
+      return false;
+    }
+    // Ninja writes outputs relative to the build directory, as a build log
+    // does, and they are canonicalized the same way.
+    Add(paths.Intern(normalize_path(fields[3], &scratch)),
+        (end_ms - start_ms) / 1000.0);
+  }
+  return true;
+}
+
+void CommandTimings::AddStart(PathId output, double seconds) {
+  if (has_pending_) {
+    double elapsed = seconds - pending_start_;
+    if (elapsed < 0) {
+      // Times of day go back to 0 at midnight; anything else going backwards
+      // is a clock that was set back, and can't be timed.
+      elapsed = seconds < 86400 && pending_start_ < 86400 ? elapsed + 86400
+                                                          : 0;
+    }
+    Add(pending_output_, elapsed);
+  }
+  has_pending_ = !PathTable::Global().Lookup(output).empty();
+  pending_output_ = output;
+  pending_start_ = seconds;
+}
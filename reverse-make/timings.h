@@ -0,0 +1,91 @@
+#ifndef REVERSE_MAKE_TIMINGS_H__
+#define REVERSE_MAKE_TIMINGS_H__
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "reverse-make/paths.h"
+
+using namespace std;
+
+/**
+ * If 'line' starts with a timestamp, as written by moreutils' ts or by most
+ * CI systems, removes it and the whitespace after it.
+ *
+ * These forms are recognized, optionally in square brackets, and with or
+ * without fractions of a second:
+ * - seconds since the epoch, of at least 9 digits: "1697457601.25";
+ * - a time of day, or a time since the build started: "12:00:01";
+ * - ts's default format: "Oct 16 12:00:01";
+ * - ISO 8601: "2023-10-16T12:00:01", "2023-10-16 12:00:01" or with a
+ * trailing "Z".
+ *
+ * @param line The line, which is advanced past the timestamp.
+ * @param seconds Set to the time, in seconds since some fixed point.
+ *
+ * @return false, leaving 'line' alone, if it doesn't start with a timestamp.
+ */
+bool strip_timestamp(string_view* line, double* seconds);
+
+/**
+ * How long the commands of a build took, by the path of the file each one
+ * built.
+ */
+class CommandTimings {
+ public:
+  /**
+   * Reads the timings in a .ninja_log file. When ninja rebuilt an output
+   * several times, its last build counts.
+   *
+   * @param filename The file to read.
+   * @param error Set to why the file couldn't be read, if it couldn't.
+   *
+   * @return false if the file couldn't be read.
+   */
+  bool ReadFile(const string& filename, string* error);
+
+  /**
+   * Records that building 'output' took 'seconds', replacing any earlier
+   * timing of it.
+   */
+  void Add(PathId output, double seconds) { seconds_[output] = seconds; }
+
+  /**
+   * Records that a line of a timestamped build log started at 'seconds', and
+   * that it built 'output', or nothing if 'output' is the empty path.
+   *
+   * The command of the line before, if it built anything, is timed as lasting
+   * until this line started. Commands are logged as they start, so this is
+   * only exact when the build ran one command at a time; the log's last
+   * command is left untimed.
+   */
+  void AddStart(PathId output, double seconds);
+
+  /**
+   * Returns how long building 'output' took, in seconds, or a negative number
+   * if it wasn't timed.
+   */
+  double seconds(PathId output) const {
+    auto it = seconds_.find(output);
+    return it == seconds_.end() ? -1 : it->second;
+  }
+
+  /**
+   * Returns the number of outputs timed.
+   */
+  size_t size() const { return seconds_.size(); }
+
+ private:
+  bool ReadNinjaLog(string_view contents, string* error);
+
+  unordered_map<PathId, double> seconds_;
+  // The output and start of the last line passed to AddStart(), if it built
+  // anything.
+  bool has_pending_ = false;
+  PathId pending_output_ = 0;
+  double pending_start_ = 0;
+};
+
+#endif  // REVERSE_MAKE_TIMINGS_H__
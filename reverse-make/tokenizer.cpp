@@ -0,0 +1,119 @@
+#include "reverse-make/tokenizer.h"
+
+#include "reverse-make/scan.h"
+
+namespace {
+
+/**
+ * Returns the position of the first character at or after 'from' that ends a
+ * run of regular characters: a quote, a backslash, or (outside of a quoted
+ * string) a space. Returns line.size() if there is none.
+ */
+size_t find_run_end(string_view line, size_t from, bool in_quote) {
+  const char* begin = line.data() + from;
+  const char* end = line.data() + line.size();
+  const char* p = in_quote ? scan_any_of(begin, end, '"', '\\')
+                           : scan_any_of(begin, end, '"', '\\', ' ');
+  return p - line.data();
+}
+
+}  // namespace
+
+const vector<string_view>& CommandTokenizer::Tokenize(string_view line) {
+  parts_.clear();
+  arena_.clear();
+  // Unescaping never produces more bytes than it consumes, so this is enough
+  // room for every materialized argument of the line; arena_ is never
+  // reallocated below and views into it stay valid.
+  arena_.reserve(line.size());
+
+  // The argument being built is line[arg_begin, arg_begin + arg_len) for as
+  // long as it is a verbatim copy of its source, and arena_[arg_begin, ...)
+  // once it isn't.
+  size_t arg_begin = 0;
+  size_t arg_len = 0;
+  bool in_arena = false;
+
+  // Appends line[src, src + len) to the argument.
+  auto append = [&](size_t src, size_t len) {
+    if (!in_arena) {
+      if (arg_len == 0) {
+        arg_begin = src;
+        arg_len = len;
+        return;
+      }
+      if (src == arg_begin + arg_len) {
+        arg_len += len;
+        return;
+      }
+      // Not contiguous any more; move the argument to the arena.
+      size_t at = arena_.size();
+      arena_.append(line.data() + arg_begin, arg_len);
+      arg_begin = at;
+      in_arena = true;
+    }
+    arena_.append(line.data() + src, len);
+    arg_len += len;
+  };
+
+  auto push = [&]() {
+    if (arg_len > 0) {
+      parts_.push_back(in_arena ? string_view(arena_.data() + arg_begin, arg_len)
+                                : line.substr(arg_begin, arg_len));
+    }
+    arg_len = 0;
+    in_arena = false;
+  };
+
+  bool in_quote = false;
+  bool is_escaped = false;
+  size_t i = 0;
+  while (i < line.size()) {
+    char c = line[i];
+    if (c == '"' && !is_escaped) {
+      in_quote = !in_quote;
+      if (!in_quote) {  // end of a quoted string
+        push();
+      }
+      i++;
+    } else if (c == '\\' && !is_escaped) {  // start of an escape sequence
+      is_escaped = true;
+      i++;
+    } else if (c == ' ' && !in_quote) {  // a space outside of a quoted string
+      push();
+      is_escaped = false;
+      i++;
+    } else if (c == '\n' && is_escaped) {
+      // a line continuation; like the shell, drop it, and carry on with the
+      // same argument
+      is_escaped = false;
+      i++;
+    } else if (is_escaped) {
+      // keep the escape character unless it's for a quote. It's the
+      // character right before this one, so this stays contiguous.
+      if (c != '"') {
+        append(i - 1, 1);
+      }
+      append(i, 1);
+      is_escaped = false;
+      i++;
+    } else {
+      // a run of regular characters, with spaces if inside a quoted string
+      size_t end = find_run_end(line, i, in_quote);
+      append(i, end - i);
+      i = end;
+    }
+  }
+  // add the last argument if it's not empty
+  push();
+
+  // Strip out the outer quotes
+  for (auto& argument : parts_) {
+    if (argument.front() == '"' && argument.back() == '"') {
+      argument = argument.size() > 1 ? argument.substr(1, argument.size() - 2)
+                                     : string_view();
+    }
+  }
+
+  return parts_;
+}
@@ -0,0 +1,55 @@
+#ifndef REVERSE_MAKE_TOKENIZER_H__
+#define REVERSE_MAKE_TOKENIZER_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Splits command lines into arguments based on spaces, respecting quoted
+ * substrings and escape sequences.
+ *
+ * A space splits arguments unless it is within a quoted substring. A backslash
+ * escapes the following character: an escaped quote loses its backslash and
+ * doesn't open or close a quoted substring, while any other escaped character
+ * keeps its backslash. A backslash before a space outside of quotes is dropped
+ * and the space still splits. A backslash before a newline continues the
+ * command onto the next line; as in the shell, both are dropped and the
+ * argument goes on, so "-O\\\n2" is "-O2". Closing a quoted substring ends
+ * the current argument.
+ * At the end, outer quotes are removed from each argument if present.
+ *
+ * The arguments are returned as views. An argument that is a verbatim run of
+ * the input (the common case) points straight into the line. Only arguments
+ * that actually needed unescaping or quote removal in the middle are
+ * materialized, into an arena owned by the tokenizer. The arena and the
+ * argument vector are reused from one line to the next, so in steady state
+ * tokenizing doesn't allocate.
+ *
+ * Example:
+ * Tokenize("hello world") returns {"hello", "world"}
+ * Tokenize("\"hello world\"") returns {"hello world"}
+ * Tokenize("hello\\ world") returns {"hello", "world"}
+ * Tokenize("\"hello\\\" world\"") returns {"hello\" world"}
+ */
+class CommandTokenizer {
+ public:
+  /**
+   * Splits 'line' into arguments.
+   *
+   * @param line The command line to split. It must outlive the returned
+   * views.
+   *
+   * @return The arguments of 'line'. The vector and the views in it stay valid
+   * until the next call to Tokenize().
+   */
+  const vector<string_view>& Tokenize(string_view line);
+
+ private:
+  vector<string_view> parts_;
+  string arena_;
+};
+
+#endif  // REVERSE_MAKE_TOKENIZER_H__
@@ -0,0 +1,366 @@
+#include "reverse-make/unity.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string_view>
+#include <utility>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include "reverse-make/files.h"
+
+namespace {
+
+enum class Language : uint8_t { C, CXX, OTHER };
+
+Language language_of(string_view source) {
+  size_t slash = source.rfind('/');
+  size_t dot = source.rfind('.');
+  if (dot == string_view::npos ||
+      (slash != string_view::npos && dot < slash)) {
+    return Language::OTHER;
+  }
+  string_view extension = source.substr(dot + 1);
+  if (extension == "c") {
+    return Language::C;
+  }
+  if (extension == "cc" || extension == "cpp" || extension == "cxx" ||
+      extension == "c++" || extension == "C") {
+    return Language::CXX;
+  }
+  return Language::OTHER;
+}
+
+/**
+ * What the sources of a batch must all have in common.
+ */
+struct BatchKey {
+  GccCommand::Compiler compiler;
+  Language language;
+  array<FlagSetId, kNumFlagFields> flags;
+  // The indices of the targets the objects go into.
+  vector<uint32_t> targets;
+
+  bool operator<(const BatchKey& other) const {
+    return tie(compiler, language, flags, targets) <
+           tie(other.compiler, other.language, other.flags, other.targets);
+  }
+};
+
+/**
+ * Returns how long running every job of 'costs' takes on 'jobs' jobs, when
+ * they are started most expensive first on whichever job frees up first.
+ */
+double makespan(vector<double> costs, int jobs) {
+  sort(costs.begin(), costs.end(), greater<double>());
+  priority_queue<double, vector<double>, greater<double>> loads;
+  for (int i = 0; i < jobs; i++) {
+    loads.push(0);
+  }
+  double longest = 0;
+  for (double cost : costs) {
+    double load = loads.top() + cost;
+    loads.pop();
+    loads.push(load);
+    longest = max(longest, load);
+  }
+  return longest;
+}
+
+/**
+ * Returns how a unity file in 'dir', relative to the build root, should
+ * include 'source', which is relative to it too unless absolute. Where 'dir'
+ * leads can't always be told from its name, and then the source is included
+ * by its absolute path, under 'absolute_root'.
+ */
+string include_path(string_view source, const string& dir,
+                    const string& absolute_root) {
+  if (source.empty() || source[0] == '/') {
+    return string(source);
+  }
+  string absolute = absolute_root + "/" + string(source);
+  if (dir.empty() || dir[0] == '/') {
+    return absolute;
+  }
+  string up;
+  size_t start = 0;
+  while (start <= dir.size()) {
+    size_t slash = dir.find('/', start);
+    if (slash == string::npos) {
+      slash = dir.size();
+    }
+    string_view component(dir.data() + start, slash - start);
+    if (component == "..") {
+      return absolute;
+    }
+    if (!component.empty() && component != ".") {
+      up += "../";
+    }
+    start = slash + 1;
+  }
+  return up + string(source);
+}
+
+/**
+ * Returns where 'path', relative to 'root' unless absolute, is from here.
+ */
+string under_root(const string& path, const string& root) {
+  if (path.empty() || path[0] == '/' || root.empty() || root == ".") {
+    return path;
+  }
+  return root + "/" + path;
+}
+
+}  // namespace
+
+UnityPlan plan_unity(const CommandTable& commands, const Report& report,
+                     const CommandTimings* timings,
+                     const UnityOptions& options) {
+  PathTable& paths = PathTable::Global();
+  UnityPlan plan;
+  plan.jobs = max(options.jobs, 1);
+
+  // The targets each compile goes into, and the compiles in order of their
+  // first target and group.
+  vector<vector<uint32_t>> targets_of(commands.size());
+  vector<CommandTable::RowId> order;
+  uint32_t target_index = 0;
+  for (auto* targets : {&report.ar_targets, &report.link_targets}) {
+    for (const TargetReport& target : *targets) {
+      for (const DependencyGroup& group : target.groups) {
+        for (CommandTable::RowId row : group.rows) {
+          if (targets_of[row].empty()) {
+            order.push_back(row);
+          }
+          if (targets_of[row].empty() ||
+              targets_of[row].back() != target_index) {
+            targets_of[row].push_back(target_index);
+          }
+        }
+      }
+      target_index++;
+    }
+  }
+
+  // What each compile costs.
+  vector<double> costs(commands.size(), 1);
+  if (timings != nullptr) {
+    vector<double> measured;
+    for (CommandTable::RowId row : order) {
+      double seconds = timings->seconds(commands.output(row));
+      if (seconds >= 0) {
+        measured.push_back(seconds);
+      }
+    }
+    if (!measured.empty()) {
+      plan.measured = true;
+      nth_element(measured.begin(), measured.begin() + measured.size() / 2,
+                  measured.end());
+      double median = measured[measured.size() / 2];
+      for (CommandTable::RowId row : order) {
+        double seconds = timings->seconds(commands.output(row));
+        costs[row] = seconds >= 0 ? seconds : median;
+      }
+    }
+  }
+
+  // Split the compiles into sets that could share a unity file.
+  vector<size_t> position(commands.size());
+  map<BatchKey, size_t> set_of_key;
+  vector<vector<CommandTable::RowId>> sets;
+  vector<double> costs_after;
+  for (size_t i = 0; i < order.size(); i++) {
+    CommandTable::RowId row = order[i];
+    position[row] = i;
+    PathList inputs = commands.inputs(row);
+    Language language = inputs.size() == 1
+                            ? language_of(paths.Lookup(inputs[0]))
+                            : Language::OTHER;
+    if (language == Language::OTHER) {
+      costs_after.push_back(costs[row]);
+      continue;
+    }
+    BatchKey key{commands.compiler(row), language, {}, targets_of[row]};
+    for (size_t field = 0; field < kNumFlagFields; field++) {
+      key.flags[field] = commands.flags(row, FlagField(field));
+    }
+    auto [it, is_new] = set_of_key.emplace(move(key), sets.size());
+    if (is_new) {
+      sets.emplace_back();
+    }
+    sets[it->second].push_back(row);
+  }
+
+  for (size_t i = 0; i < sets.size(); i++) {
+    vector<CommandTable::RowId>& rows = sets[i];
+    size_t num_batches =
+        (rows.size() + options.max_sources - 1) / options.max_sources;
+
+    vector<vector<CommandTable::RowId>> batches(num_batches);
+    if (!plan.measured) {
+      // Every source costs the same, so split them evenly, keeping
+      // neighbouring sources together since they tend to share headers.
+      for (size_t j = 0; j < rows.size(); j++) {
+        batches[j * num_batches / rows.size()].push_back(rows[j]);
+      }
+    } else {
+      // Hand out the sources most expensive first, each to the cheapest
+      // batch that still has room.
+      stable_sort(rows.begin(), rows.end(),
+                  [&](CommandTable::RowId a, CommandTable::RowId b) {
+                    return costs[a] > costs[b];
+                  });
+      // The batches with room, cheapest on top, by (cost, index).
+      priority_queue<pair<double, size_t>, vector<pair<double, size_t>>,
+                     greater<pair<double, size_t>>>
+          open;
+      for (size_t b = 0; b < num_batches; b++) {
+        open.emplace(0, b);
+      }
+      for (CommandTable::RowId row : rows) {
+        auto [cost, cheapest] = open.top();
+        open.pop();
+        batches[cheapest].push_back(row);
+        if (batches[cheapest].size() < options.max_sources) {
+          open.emplace(cost + costs[row], cheapest);
+        }
+      }
+    }
+
+    for (auto& batch_rows : batches) {
+      if (batch_rows.size() < 2) {
+        for (CommandTable::RowId row : batch_rows) {
+          costs_after.push_back(costs[row]);
+        }
+        continue;
+      }
+      UnityBatch batch;
+      double cheapest = costs[batch_rows[0]];
+      for (CommandTable::RowId row : batch_rows) {
+        batch.cost += costs[row];
+        cheapest = min(cheapest, costs[row]);
+      }
+      batch.cost -= (batch_rows.size() - 1) * options.overhead * cheapest;
+      sort(batch_rows.begin(), batch_rows.end(),
+           [&](CommandTable::RowId a, CommandTable::RowId b) {
+             return position[a] < position[b];
+           });
+      batch.rows = move(batch_rows);
+      costs_after.push_back(batch.cost);
+      plan.batches.push_back(move(batch));
+    }
+  }
+
+  // Number the batches in order of their first source.
+  sort(plan.batches.begin(), plan.batches.end(),
+       [&](const UnityBatch& a, const UnityBatch& b) {
+         return position[a.rows[0]] < position[b.rows[0]];
+       });
+  for (size_t i = 0; i < plan.batches.size(); i++) {
+    UnityBatch& batch = plan.batches[i];
+    PathId source = commands.inputs(batch.rows[0])[0];
+    bool is_c = language_of(paths.Lookup(source)) == Language::C;
+    batch.filename =
+        fmt::format("{}/unity-{}.{}", options.dir, i, is_c ? "c" : "cpp");
+  }
+
+  vector<double> costs_before;
+  for (CommandTable::RowId row : order) {
+    costs_before.push_back(costs[row]);
+    plan.cpu_before += costs[row];
+  }
+  for (double cost : costs_after) {
+    plan.cpu_after += cost;
+  }
+  plan.compiles_before = costs_before.size();
+  plan.compiles_after = costs_after.size();
+  plan.wall_before = makespan(move(costs_before), plan.jobs);
+  plan.wall_after = makespan(move(costs_after), plan.jobs);
+  return plan;
+}
+
+bool write_unity_files(const CommandTable& commands, const UnityPlan& plan,
+                       const UnityOptions& options) {
+  PathTable& paths = PathTable::Global();
+  if (plan.batches.empty()) {
+    return true;
+  }
+  char* absolute_root = realpath(options.root.c_str(), nullptr);
+  if (absolute_root == nullptr) {
+    return false;
+  }
+  string root = absolute_root;
+  free(absolute_root);
+  if (!make_directories(under_root(options.dir, options.root))) {
+    return false;
+  }
+  for (const UnityBatch& batch : plan.batches) {
+    FILE* file =
+        fopen(under_root(batch.filename, options.root).c_str(), "w");
+    if (file == nullptr) {
+      return false;
+    }
+    fmt::print(file,
+               "/* Generated by reverse-make --suggest-unity: {} sources "
+               "compiled with the same flags. */\n",
+               batch.rows.size());
+    for (CommandTable::RowId row : batch.rows) {
+      fmt::print(file, "#include \"{}\"\n",
+                 include_path(paths.Lookup(commands.inputs(row)[0]),
+                              options.dir, root));
+    }
+    if (ferror(file) || fclose(file) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void print_unity_plan(const CommandTable& commands, const UnityPlan& plan,
+                      FILE* out) {
+  PathTable& paths = PathTable::Global();
+  auto cost = [&](double value) {
+    return plan.measured ? fmt::format("{:.2f}s", value)
+                         : fmt::format("{:.1f} compiles", value);
+  };
+
+  size_t merged = 0;
+  for (const UnityBatch& batch : plan.batches) {
+    merged += batch.rows.size();
+  }
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "Unity files: {} sources merged into {} unity files:\n",
+             merged, plan.batches.size());
+  fmt::print(out, "----------------------------------------------------\n");
+  for (const UnityBatch& batch : plan.batches) {
+    vector<string_view> sources;
+    for (CommandTable::RowId row : batch.rows) {
+      sources.push_back(paths.Lookup(commands.inputs(row)[0]));
+    }
+    fmt::print(out, "  {}: {} sources, costing {}: {}\n", batch.filename,
+               sources.size(), cost(batch.cost), sources);
+  }
+
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "Predicted compile time on {} jobs, {}:\n", plan.jobs,
+             plan.measured ? "from measured times"
+                           : "with every compile costing the same");
+  fmt::print(out, "----------------------------------------------------\n");
+  fmt::print(out, "  compiles:  {} now, {} with unity files\n",
+             plan.compiles_before, plan.compiles_after);
+  fmt::print(out, "  CPU time:  {} now, {} with unity files\n",
+             cost(plan.cpu_before), cost(plan.cpu_after));
+  fmt::print(out, "  wall time: {} now, {} with unity files\n",
+             cost(plan.wall_before), cost(plan.wall_after));
+  if (plan.wall_after > 0) {
+    fmt::print(out, "  speedup:   {:.2f}x\n",
+               plan.wall_before / plan.wall_after);
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef REVERSE_MAKE_UNITY_H__
+#define REVERSE_MAKE_UNITY_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "reverse-make/command_table.h"
+#include "reverse-make/report.h"
+#include "reverse-make/timings.h"
+
+using namespace std;
+
+/**
+ * How --suggest-unity batches sources.
+ */
+struct UnityOptions {
+  // The most sources one unity file may include.
+  size_t max_sources = 8;
+  // The number of compiles the build runs at once.
+  int jobs = 1;
+  // The fraction of the cheapest compile of a batch that every compile in it
+  // spends on the same work (starting the compiler, parsing common headers),
+  // and that merging saves for all but one of them.
+  double overhead = 0.5;
+  // Where the unity files go, relative to 'root'.
+  string dir = "unity";
+  // The directory the build ran in, which 'dir' and the sources are relative
+  // to.
+  string root = ".";
+};
+
+/**
+ * Sources that can be compiled together as one unity translation unit.
+ */
+struct UnityBatch {
+  // The compile commands merged, in the order of the report.
+  vector<CommandTable::RowId> rows;
+  // The predicted cost of compiling the unity file.
+  double cost = 0;
+  // The path of the unity file, relative to UnityOptions::root.
+  string filename;
+};
+
+/**
+ * The unity files suggested for a build, and what they are predicted to save.
+ */
+struct UnityPlan {
+  // Every batch of two or more sources, in order of the first target and
+  // group they come from.
+  vector<UnityBatch> batches;
+  // True if costs are measured times, in seconds; otherwise every compile
+  // costs 1.
+  bool measured = false;
+  // The number of compiles now, and with the unity files.
+  size_t compiles_before = 0;
+  size_t compiles_after = 0;
+  // The total cost of every compile, now and with the unity files.
+  double cpu_before = 0;
+  double cpu_after = 0;
+  // The predicted wall time of every compile on 'jobs' jobs, now and with the
+  // unity files.
+  double wall_before = 0;
+  double wall_after = 0;
+  int jobs = 1;
+};
+
+/**
+ * Works out how the sources of a report could be merged into unity files.
+ *
+ * The report's dependency groups are split further, so that every batch's
+ * sources are compiled by the same compiler, in the same language, with
+ * exactly the same flags (optimizations included), and go into exactly the
+ * same targets; the merged object can then stand in for all of them. Sources
+ * that aren't C or C++ are left alone.
+ *
+ * Each set of mergeable sources is split into as few batches as
+ * 'options.max_sources' allows. With measured costs, sources are handed out
+ * most expensive first to the cheapest batch so far, which balances the
+ * batches' costs; otherwise neighbouring sources are kept together. A
+ * source's cost is its measured compile time if 'timings' has one, the median
+ * measured time if 'timings' has others, and 1 otherwise.
+ *
+ * Wall times are predicted by scheduling every compile, most expensive first,
+ * onto whichever of 'options.jobs' jobs frees up first.
+ *
+ * @param commands The commands of the build.
+ * @param report The report built from 'commands'.
+ * @param timings How long commands took, or nullptr.
+ * @param options How to batch.
+ *
+ * @return The suggested batches, with their filenames under 'options.dir'.
+ */
+UnityPlan plan_unity(const CommandTable& commands, const Report& report,
+                     const CommandTimings* timings,
+                     const UnityOptions& options);
+
+/**
+ * Writes a unity file for every batch of 'plan', which includes the batch's
+ * sources in order. The files go in 'options.dir' under 'options.root'.
+ * Relative sources, which are relative to the root, are included relative to
+ * the unity file, or by absolute path if 'options.dir' is absolute or leads
+ * out of the root with "..".
+ *
+ * @return false if a file couldn't be written.
+ */
+bool write_unity_files(const CommandTable& commands, const UnityPlan& plan,
+                       const UnityOptions& options);
+
+/**
+ * Prints the batches of 'plan' and the predicted speedup.
+ */
+void print_unity_plan(const CommandTable& commands, const UnityPlan& plan,
+                      FILE* out = stdout);
+
+#endif  // REVERSE_MAKE_UNITY_H__
@@ -0,0 +1,60 @@
+#!/bin/bash
+# Checks that reverse-make's output doesn't depend on --jobs: a synthetic log
+# is reported on with -j 1 and then a few times with -j 8, and what each run
+# prints and writes must be byte for byte the same. With several threads, the
+# IDs of interned paths and flags differ from run to run, so output that
+# depends on them shows up here.
+#
+# Usage: check-jobs.sh <reverse-make> <gen-build-log> <work dir>
+
+set -e
+
+reverse_make=$1
+gen_build_log=$2
+dir=$3
+mkdir -p "$dir"
+
+log=$dir/jobs.build.log
+"$gen_build_log" --commands 20000 --flag-sets 16 --libtool --quoting 0.5 \
+  -o "$log"
+
+# Runs reverse-make on the log with -j $1 and the other arguments, in which
+# @OUT@ stands for a directory of the run's own, and leaves what it printed
+# and wrote in that directory. Every run writes to the same path, so that
+# paths written into the output match, and its directory is then renamed.
+run() {
+  local out=$dir/out
+  rm -rf "$out" "$dir/jobs-$1"
+  mkdir -p "$out"
+  local args=("${@:2}")
+  "$reverse_make" -f "$log" -j "$1" "${args[@]//@OUT@/$out}" \
+    > "$out/stdout" 2> /dev/null
+  mv "$out" "$dir/jobs-$1"
+}
+
+status=0
+check() {
+  if ! run 1 "$@"; then
+    echo "FAIL: $*: reverse-make failed"
+    status=1
+    return
+  fi
+  for i in 1 2 3; do
+    if ! run 8 "$@" ||
+       ! diff -r -q "$dir/jobs-1" "$dir/jobs-8" > /dev/null; then
+      echo "FAIL: $*: -j 8 differs from -j 1"
+      status=1
+      return
+    fi
+  done
+  echo "ok: $*"
+}
+
+check --format text
+check --format json
+check --format binary
+check --format binary --fold-pic
+check --transitive
+check --write-compdb @OUT@/compile_commands.json
+check --write-compdb @OUT@/compile_commands.json --compdb-flag-files @OUT@/flags
+exit $status
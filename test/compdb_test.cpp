@@ -0,0 +1,198 @@
+#include "reverse-make/compdb.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "reverse-make/parse.h"
+#include "test/test.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Reads every entry of a compilation database with the given contents.
+ *
+ * @return false if the reader stopped at an error, which is stored in 'error'.
+ */
+bool read_entries(const string& dir, const string& json,
+                  vector<CompileDbEntry>* entries, string* error) {
+  string filename = dir + "/compile_commands.json";
+  write_test_file(filename, json);
+  auto reader = CompileDbReader::Open(filename);
+  EXPECT_TRUE(reader != nullptr);
+  CompileDbEntry entry;
+  while (reader->Next(&entry)) {
+    entries->push_back(entry);
+  }
+  *error = reader->error();
+  return error->empty();
+}
+
+/**
+ * Returns the one string a database holding it as a "file" reads as, or
+ * "(error)" if it is rejected.
+ */
+string read_json_string(const string& dir, const string& json_string) {
+  vector<CompileDbEntry> entries;
+  string error;
+  if (!read_entries(dir,
+                    "[{\"command\": \"cc\", \"file\": \"" + json_string +
+                        "\"}]",
+                    &entries, &error)) {
+    return "(error)";
+  }
+  EXPECT_EQ(entries.size(), size_t(1));
+  return entries.empty() ? "" : entries[0].file;
+}
+
+void test_reader(const string& dir) {
+  vector<CompileDbEntry> entries;
+  string error;
+  EXPECT_TRUE(read_entries(dir,
+                           "[\n"
+                           "  {\"directory\": \"/src\", \"file\": \"a.c\",\n"
+                           "   \"command\": \"gcc -c a.c\",\n"
+                           "   \"extra\": {\"x\": [1, -2.5e3, true, null, "
+                           "\"]\"]}},\n"
+                           "  {\"arguments\": [\"gcc\", \"-DM=\\\"a\\tb\\\"\", "
+                           "\"-c\", \"b.c\"],\n"
+                           "   \"file\": \"b.c\", \"output\": \"b.o\"}\n"
+                           "]\n",
+                           &entries, &error));
+  EXPECT_EQ(error, "");
+  EXPECT_EQ(entries.size(), size_t(2));
+  if (entries.size() == 2) {
+    EXPECT_EQ(entries[0].line, 2);
+    EXPECT_EQ(entries[0].directory, "/src");
+    EXPECT_EQ(entries[0].file, "a.c");
+    EXPECT_EQ(entries[0].command, "gcc -c a.c");
+    EXPECT_TRUE(!entries[0].has_arguments);
+    EXPECT_EQ(entries[1].line, 5);
+    EXPECT_EQ(entries[1].output, "b.o");
+    EXPECT_TRUE(entries[1].has_arguments);
+    EXPECT_EQ(entries[1].arguments,
+              (vector<string>{"gcc", "-DM=\"a\tb\"", "-c", "b.c"}));
+  }
+
+  EXPECT_EQ(read_json_string(dir, "a\\/b\\\\c\\n"), "a/b\\c\n");
+  EXPECT_EQ(read_json_string(dir, "\\u00e9"), "\xc3\xa9");
+  EXPECT_EQ(read_json_string(dir, "\\u20AC"), "\xe2\x82\xac");
+  EXPECT_EQ(read_json_string(dir, "\\ud83d\\ude00"), "\xf0\x9f\x98\x80");
+  // Surrogates only come in high-low pairs.
+  EXPECT_EQ(read_json_string(dir, "\\ud800\\u0041"), "(error)");
+  EXPECT_EQ(read_json_string(dir, "\\ud800x"), "(error)");
+  EXPECT_EQ(read_json_string(dir, "\\ude00"), "(error)");
+  EXPECT_EQ(read_json_string(dir, "\\u12g4"), "(error)");
+  EXPECT_EQ(read_json_string(dir, "\\q"), "(error)");
+
+  for (const char* bad : {"", "{}", "[{\"file\": \"a.c\"} {}]",
+                          "[{\"file\": \"a.c\"}", "[{\"file\": \"a.c}]",
+                          "[{\"file\" \"a.c\"}]", "[{\"arguments\": \"x\"}]"}) {
+    entries.clear();
+    EXPECT_TRUE(!read_entries(dir, bad, &entries, &error));
+  }
+}
+
+vector<string> split(string_view contents) {
+  vector<string> args;
+  split_response_file(contents, &args);
+  return args;
+}
+
+void test_split_response_file() {
+  EXPECT_EQ(split(""), vector<string>());
+  EXPECT_EQ(split(" \n\t "), vector<string>());
+  EXPECT_EQ(split("-Ia -DX=1\r\n\t-O2\n"),
+            (vector<string>{"-Ia", "-DX=1", "-O2"}));
+  EXPECT_EQ(split("'a b' \"c d\" e\\ f"),
+            (vector<string>{"a b", "c d", "e f"}));
+  EXPECT_EQ(split("a\"b c\"d 'x\"y' \"x'y\""),
+            (vector<string>{"ab cd", "x\"y", "x'y"}));
+  EXPECT_EQ(split("\"\" ''"), (vector<string>{"", ""}));
+  EXPECT_EQ(split("a\\\"b \"c\\\"d\" \\\\"),
+            (vector<string>{"a\"b", "c\"d", "\\"}));
+}
+
+void test_writer(const string& dir) {
+  // a.o and b.o have the same flags in different orders, which compilers
+  // don't take to be the same, and e.o repeats a.o's.
+  ParsedChunk parsed = parse_chunk(
+      "gcc -Ib -Ia -DX=2 -UX -isystem /sys -O2 -c -o a.o a.c\n"
+      "gcc -Ia -Ib -DX=2 -UX -isystem /sys -O2 -c -o b.o b.c\n"
+      "gcc -c -o c.o c.c\n"
+      "gcc \"-DMSG=a b\" -c -o d.o d.c\n"
+      "gcc -Ib -Ia -DX=2 -UX -isystem /sys -O2 -c -o e.o e.c\n"
+      "gcc -o app a.o b.o\n");
+  const CommandTable& commands = parsed.commands;
+  EXPECT_EQ(commands.size(), size_t(6));
+
+  vector<CompileDbEntry> entries;
+  string error;
+  EXPECT_TRUE(write_compdb(commands, dir + "/inline.json", "/build", ""));
+  EXPECT_TRUE(read_entries(dir, read_test_file(dir + "/inline.json"),
+                           &entries, &error));
+  EXPECT_EQ(entries.size(), size_t(5));
+  if (entries.size() == 5) {
+    EXPECT_EQ(entries[0].directory, "/build");
+    EXPECT_EQ(entries[0].file, "a.c");
+    EXPECT_EQ(entries[0].output, "a.o");
+    EXPECT_EQ(entries[0].arguments,
+              (vector<string>{"gcc", "-Ib", "-Ia", "-DX=2", "-UX", "-isystem",
+                              "/sys", "-O2", "-c", "-o", "a.o", "a.c"}));
+    EXPECT_EQ(entries[1].arguments,
+              (vector<string>{"gcc", "-Ia", "-Ib", "-DX=2", "-UX", "-isystem",
+                              "/sys", "-O2", "-c", "-o", "b.o", "b.c"}));
+    EXPECT_EQ(entries[2].arguments,
+              (vector<string>{"gcc", "-c", "-o", "c.o", "c.c"}));
+    EXPECT_EQ(entries[3].arguments,
+              (vector<string>{"gcc", "-DMSG=a b", "-c", "-o", "d.o", "d.c"}));
+  }
+
+  // With response files, one per distinct list of flags, numbered in the
+  // order they are first used.
+  string flags = dir + "/flags";
+  entries.clear();
+  EXPECT_TRUE(write_compdb(commands, dir + "/rsp.json", "/build", flags));
+  EXPECT_TRUE(read_entries(dir, read_test_file(dir + "/rsp.json"), &entries,
+                           &error));
+  EXPECT_EQ(entries.size(), size_t(5));
+  if (entries.size() == 5) {
+    EXPECT_EQ(entries[0].arguments,
+              (vector<string>{"gcc", "@" + flags + "/flags-0.rsp", "-c", "-o",
+                              "a.o", "a.c"}));
+    EXPECT_EQ(entries[1].arguments[1], "@" + flags + "/flags-1.rsp");
+    EXPECT_EQ(entries[2].arguments,
+              (vector<string>{"gcc", "-c", "-o", "c.o", "c.c"}));
+    EXPECT_EQ(entries[3].arguments[1], "@" + flags + "/flags-2.rsp");
+    EXPECT_EQ(entries[4].arguments[1], "@" + flags + "/flags-0.rsp");
+  }
+  EXPECT_EQ(split(read_test_file(flags + "/flags-0.rsp")),
+            (vector<string>{"-Ib", "-Ia", "-DX=2", "-UX", "-isystem", "/sys",
+                            "-O2"}));
+  EXPECT_EQ(split(read_test_file(flags + "/flags-2.rsp")),
+            vector<string>{"-DMSG=a b"});
+
+  // Reading either database back gives every command its flags in the same
+  // order.
+  for (const char* name : {"/inline.json", "/rsp.json"}) {
+    CommandTable read;
+    vector<SkippedCommand> skipped;
+    EXPECT_TRUE(parse_compdb(dir + name, 1, &read, &skipped, &error));
+    EXPECT_EQ(read.size(), size_t(5));
+    for (CommandTable::RowId row = 0; row < read.size(); row++) {
+      EXPECT_EQ(read.flag_list(row).ids(), commands.flag_list(row).ids());
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  string dir = test_directory();
+  test_reader(dir);
+  test_split_response_file();
+  test_writer(dir);
+  return test_result();
+}
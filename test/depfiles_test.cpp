@@ -0,0 +1,99 @@
+#include "reverse-make/depfiles.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "reverse-make/parse.h"
+#include "test/test.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Returns the paths of 'headers'.
+ */
+vector<string_view> lookup(const vector<PathId>& headers) {
+  vector<string_view> paths;
+  for (PathId header : headers) {
+    paths.push_back(PathTable::Global().Lookup(header));
+  }
+  sort(paths.begin(), paths.end());
+  return paths;
+}
+
+vector<string> parse(string_view contents) {
+  vector<string> prerequisites;
+  parse_depfile(contents, &prerequisites);
+  return prerequisites;
+}
+
+void test_parse_depfile() {
+  EXPECT_EQ(parse(""), vector<string>());
+  EXPECT_EQ(parse("a.o: a.c a.h\n"), (vector<string>{"a.c", "a.h"}));
+  EXPECT_EQ(parse("a.o: a.c"), vector<string>{"a.c"});
+  EXPECT_EQ(parse("a.o a.d: a.c\n"), vector<string>{"a.c"});
+  EXPECT_EQ(parse("a.o:\ta.c\t\ta.h\n"), (vector<string>{"a.c", "a.h"}));
+  // Continuations.
+  EXPECT_EQ(parse("a.o: a.c \\\n  a.h \\\n b.h\n"),
+            (vector<string>{"a.c", "a.h", "b.h"}));
+  EXPECT_EQ(parse("a.o: \\\n a.c\\\nb.h\n"), (vector<string>{"a.c", "b.h"}));
+  // Escaped spaces and hashes, and dollars.
+  EXPECT_EQ(parse("a.o: my\\ file.h x\\#y.h cost$$.h\n"),
+            (vector<string>{"my file.h", "x#y.h", "cost$.h"}));
+  // Other backslashes are kept.
+  EXPECT_EQ(parse("a.o: dir\\a.h\n"), vector<string>{"dir\\a.h"});
+  // CRLF line ends.
+  EXPECT_EQ(parse("a.o: a.c \\\r\n a.h\r\nb.o: b.c\r\n"),
+            (vector<string>{"a.c", "a.h", "b.c"}));
+  // The phony rules of -MP have no prerequisites.
+  EXPECT_EQ(parse("a.o: a.c a.h b.h\n\na.h:\n\nb.h:\n"),
+            (vector<string>{"a.c", "a.h", "b.h"}));
+  // A colon inside a word, as after a drive letter, isn't a rule's.
+  EXPECT_EQ(parse("C:\\obj\\a.o: C:\\src\\a.c C:/inc/a.h\n"),
+            (vector<string>{"C:\\src\\a.c", "C:/inc/a.h"}));
+  // Prerequisites are appended.
+  vector<string> prerequisites = {"x.h"};
+  parse_depfile("a.o: a.c\n", &prerequisites);
+  EXPECT_EQ(prerequisites, (vector<string>{"x.h", "a.c"}));
+}
+
+void test_read_depfiles_in_subdirectory() {
+  // gcc writes prerequisites as seen from the directory it ran in, which
+  // isn't the build root here.
+  const string& dir = test_directory();
+  mkdir((dir + "/sub").c_str(), 0777);
+  write_test_file(dir + "/sub/a.d",
+                  "a.o: a.c common.h ../top.h /usr/include/stdio.h\n");
+  write_test_file(dir + "/sub/b.d", "b.o: b.c common.h\n");
+  string log = fmt::format(
+      "make: Entering directory '{0}'\n"
+      "make[1]: Entering directory '{0}/sub'\n"
+      "gcc -c -MD -MF a.d -o a.o a.c\n"
+      "gcc -c -MD -MF b.d -o b.o b.c\n"
+      "gcc -c -MD -MF missing.d -o c.o c.c\n",
+      dir);
+  ParsedChunk parsed = parse_chunk(log);
+
+  vector<string> missing;
+  HeaderGraph graph = read_depfiles(parsed.commands, dir, 1, &missing);
+  PathTable& paths = PathTable::Global();
+  EXPECT_EQ(lookup(graph.headers(paths.Intern("sub/a.c"))),
+            (vector<string_view>{"/usr/include/stdio.h", "sub/common.h",
+                                 "top.h"}));
+  EXPECT_EQ(lookup(graph.headers(paths.Intern("sub/b.c"))),
+            vector<string_view>{"sub/common.h"});
+  EXPECT_EQ(graph.num_sources(), size_t(2));
+  EXPECT_EQ(missing, vector<string>{"sub/missing.d"});
+}
+
+}  // namespace
+
+int main() {
+  test_parse_depfile();
+  test_read_depfiles_in_subdirectory();
+  return test_result();
+}
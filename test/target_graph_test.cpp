@@ -0,0 +1,64 @@
+#include "reverse-make/target_graph.h"
+
+#include <vector>
+
+#include "reverse-make/flag_groups.h"
+#include "reverse-make/parse.h"
+#include "test/test.h"
+
+using namespace std;
+
+namespace {
+
+using RowId = CommandTable::RowId;
+
+/**
+ * Returns the output paths of the targets 'target' uses directly.
+ */
+vector<string_view> uses(const CommandTable& commands,
+                         const TargetGraph& graph, RowId target) {
+  vector<string_view> outputs;
+  for (RowId used : graph.uses(target)) {
+    outputs.push_back(PathTable::Global().Lookup(commands.output(used)));
+  }
+  return outputs;
+}
+
+void test_link_search_order() {
+  // Both a/ and b/ have a libfoo.a; the linker takes the one in the first -L
+  // directory, whatever order the directories were first seen in.
+  ParsedChunk parsed = parse_chunk(
+      "gcc -c -o a/foo.o a/foo.c\n"
+      "ar cr a/libfoo.a a/foo.o\n"
+      "gcc -c -o b/foo.o b/foo.c\n"
+      "ar cr b/libfoo.a b/foo.o\n"
+      "gcc -c -o main.o main.c\n"
+      "gcc -o a-first main.o -La -Lb -lfoo\n"
+      "gcc -o b-first main.o -Lb -La -lfoo\n"
+      "gcc -o b-only main.o -Lc -Lb -lfoo\n"
+      "gcc -o shared main.o -Lb -La -Lb -lfoo\n");
+  const CommandTable& commands = parsed.commands;
+  FlagGroups flag_groups(commands);
+  for (int jobs : {1, 4}) {
+    TargetGraph graph(commands, flag_groups, jobs);
+    PathTable& paths = PathTable::Global();
+    auto link = [&](const char* output) {
+      return commands.Find(CommandKind::LINK, paths.Intern(output));
+    };
+    EXPECT_EQ(uses(commands, graph, link("a-first")),
+              vector<string_view>{"a/libfoo.a"});
+    EXPECT_EQ(uses(commands, graph, link("b-first")),
+              vector<string_view>{"b/libfoo.a"});
+    EXPECT_EQ(uses(commands, graph, link("b-only")),
+              vector<string_view>{"b/libfoo.a"});
+    EXPECT_EQ(uses(commands, graph, link("shared")),
+              vector<string_view>{"b/libfoo.a"});
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_link_search_order();
+  return test_result();
+}
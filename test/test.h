@@ -0,0 +1,110 @@
+#ifndef REVERSE_MAKE_TEST_TEST_H__
+#define REVERSE_MAKE_TEST_TEST_H__
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+using namespace std;
+
+/**
+ * Just enough of a test harness for the checks in this directory: each test
+ * program is a main() that runs EXPECT checks and returns test_result(). A
+ * failed check prints where it is and what it got, and the program carries
+ * on, so one run shows every failure.
+ */
+inline int& test_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define EXPECT_TRUE(cond)                                                 \
+  do {                                                                    \
+    if (!(cond)) {                                                        \
+      fmt::print(stderr, "{}:{}: expected {}\n", __FILE__, __LINE__,      \
+                 #cond);                                                  \
+      test_failures()++;                                                  \
+    }                                                                     \
+  } while (false)
+
+#define EXPECT_EQ(actual, expected)                                       \
+  do {                                                                    \
+    const auto& actual_ = (actual);                                       \
+    const auto& expected_ = (expected);                                   \
+    if (!(actual_ == expected_)) {                                        \
+      fmt::print(stderr, "{}:{}: {} is {}, expected {}\n", __FILE__,      \
+                 __LINE__, #actual, actual_, expected_);                  \
+      test_failures()++;                                                  \
+    }                                                                     \
+  } while (false)
+
+/**
+ * Returns a fresh directory for a test to write files in, which test_result()
+ * removes.
+ */
+inline const string& test_directory() {
+  static const string dir = [] {
+    char dir[] = "/tmp/reverse-make-test.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+      perror("mkdtemp");
+      abort();
+    }
+    return string(dir);
+  }();
+  return dir;
+}
+
+/**
+ * Writes 'contents' to 'filename'.
+ */
+inline void write_test_file(const string& filename, const string& contents) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == nullptr ||
+      fwrite(contents.data(), 1, contents.size(), file) != contents.size() ||
+      fclose(file) != 0) {
+    perror(filename.c_str());
+    abort();
+  }
+}
+
+/**
+ * Returns the contents of 'filename'.
+ */
+inline string read_test_file(const string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) {
+    perror(filename.c_str());
+    abort();
+  }
+  string contents;
+  char block[4096];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+    contents.append(block, n);
+  }
+  fclose(file);
+  return contents;
+}
+
+/**
+ * Returns the exit status of a test program.
+ */
+inline int test_result() {
+  if (system(("rm -rf " + test_directory()).c_str()) != 0) {
+    fmt::print(stderr, "couldn't remove {}\n", test_directory());
+  }
+  if (test_failures() > 0) {
+    fmt::print(stderr, "{} check(s) failed\n", test_failures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif  // REVERSE_MAKE_TEST_TEST_H__
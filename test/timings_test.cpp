@@ -0,0 +1,135 @@
+#include "reverse-make/timings.h"
+
+#include <string>
+
+#include "test/test.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Returns the time strip_timestamp() reads at the start of 'line', and what
+ * it leaves of the line in 'rest', or -1 if it finds no timestamp.
+ */
+double strip(string_view line, string_view* rest = nullptr) {
+  double seconds = 0;
+  string_view stripped = line;
+  if (!strip_timestamp(&stripped, &seconds)) {
+    // The line is left alone.
+    EXPECT_EQ(stripped, line);
+    return -1;
+  }
+  if (rest != nullptr) {
+    *rest = stripped;
+  }
+  return seconds;
+}
+
+void test_strip_timestamp() {
+  string_view rest;
+  // Seconds since the epoch.
+  EXPECT_EQ(strip("1697457601.25 gcc -c a.c", &rest), 1697457601.25);
+  EXPECT_EQ(rest, "gcc -c a.c");
+  EXPECT_EQ(strip("[1697457601] gcc", &rest), 1697457601.0);
+  EXPECT_EQ(rest, "gcc");
+  EXPECT_EQ(strip("1697457601,5\tgcc"), 1697457601.5);
+
+  // Times of day, or since the build started.
+  EXPECT_EQ(strip("12:00:01 gcc", &rest), 43201.0);
+  EXPECT_EQ(rest, "gcc");
+  EXPECT_EQ(strip("[1:02:03.5]  \t gcc", &rest), 3723.5);
+  EXPECT_EQ(rest, "gcc");
+
+  // ts's default format, with the day padded or not.
+  EXPECT_EQ(strip("Oct 16 12:00:02 gcc") - strip("Oct 16 12:00:01 gcc"), 1.0);
+  EXPECT_EQ(strip("Nov  1 00:00:00 gcc") - strip("Oct 31 23:59:59 gcc"), 1.0);
+  EXPECT_EQ(strip("Oct 6 00:00:00 gcc"), strip("Oct  6 00:00:00 gcc"));
+  EXPECT_TRUE(strip("Oct  6 00:00:00 gcc", &rest) > 0);
+  EXPECT_EQ(rest, "gcc");
+
+  // ISO 8601, which counts from the epoch.
+  EXPECT_EQ(strip("2023-10-16T12:00:01 gcc", &rest), 1697457601.0);
+  EXPECT_EQ(rest, "gcc");
+  EXPECT_EQ(strip("2023-10-16 12:00:01 gcc"), 1697457601.0);
+  EXPECT_EQ(strip("[2023-10-16T12:00:01.250Z] gcc"), 1697457601.25);
+  EXPECT_EQ(strip("2000-02-29T00:00:00 gcc"), 951782400.0);
+
+  // A timestamp on its own is stripped to nothing.
+  EXPECT_EQ(strip("12:00:01", &rest), 43201.0);
+  EXPECT_EQ(rest, "");
+
+  // Not timestamps.
+  EXPECT_EQ(strip("gcc -c a.c"), -1.0);
+  EXPECT_EQ(strip(""), -1.0);
+  EXPECT_EQ(strip("12345 gcc"), -1.0);
+  EXPECT_EQ(strip("12:00:01gcc"), -1.0);
+  EXPECT_EQ(strip("12:0:01 gcc"), -1.0);
+  EXPECT_EQ(strip("[12:00:01 gcc"), -1.0);
+  EXPECT_EQ(strip("Oct 16 gcc"), -1.0);
+  EXPECT_EQ(strip("Octopus gcc"), -1.0);
+  EXPECT_EQ(strip("2023-10-16 gcc"), -1.0);
+  EXPECT_EQ(strip("2023-10-16X12:00:01 gcc"), -1.0);
+}
+
+/**
+ * Reads a .ninja_log with the given contents.
+ */
+bool read_ninja_log(const string& contents, CommandTimings* timings,
+                    string* error) {
+  string filename = test_directory() + "/.ninja_log";
+  write_test_file(filename, contents);
+  return timings->ReadFile(filename, error);
+}
+
+void test_read_ninja_log() {
+  PathTable& paths = PathTable::Global();
+  CommandTimings timings;
+  string error;
+  EXPECT_TRUE(read_ninja_log("# ninja log v5\n"
+                             "0\t1500\t0\tobj/a.o\t1a2b\n"
+                             "100\t350\t0\t./obj/b.o\t3c4d\n"
+                             "# a comment\n"
+                             "\n"
+                             "2000\t2600\t0\tobj/a.o\t1a2b\n",
+                             &timings, &error));
+  EXPECT_EQ(error, "");
+  EXPECT_EQ(timings.size(), size_t(2));
+  // The last build of an output counts, and outputs are canonicalized.
+  EXPECT_EQ(timings.seconds(paths.Intern("obj/a.o")), 0.6);
+  EXPECT_EQ(timings.seconds(paths.Intern("obj/b.o")), 0.25);
+  EXPECT_EQ(timings.seconds(paths.Intern("obj/c.o")), -1.0);
+
+  for (const char* bad : {"# ninja log v5\n0\t1\t0\n",
+                          "# ninja log v5\nx\t1\t0\ta.o\th\n",
+                          "# ninja log v5\n10\t5\t0\ta.o\th\n"}) {
+    CommandTimings bad_timings;
+    EXPECT_TRUE(!read_ninja_log(bad, &bad_timings, &error));
+    EXPECT_TRUE(error.find("malformed line 2") != string::npos);
+  }
+  CommandTimings other;
+  EXPECT_TRUE(!read_ninja_log("0\t1\t0\ta.o\th\n", &other, &error));
+  EXPECT_TRUE(!other.ReadFile(test_directory() + "/missing", &error));
+}
+
+void test_add_start() {
+  PathTable& paths = PathTable::Global();
+  CommandTimings timings;
+  PathId a = paths.Intern("a.o"), b = paths.Intern("b.o");
+  timings.AddStart(a, 86398);
+  timings.AddStart(paths.Intern(""), 86399);
+  timings.AddStart(b, 1);
+  timings.AddStart(a, 0);
+  EXPECT_EQ(timings.seconds(a), 1.0);
+  // Times of day wrap at midnight.
+  EXPECT_EQ(timings.seconds(b), 86400.0 - 1);
+}
+
+}  // namespace
+
+int main() {
+  test_strip_timestamp();
+  test_read_ninja_log();
+  test_add_start();
+  return test_result();
+}
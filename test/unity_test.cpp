@@ -0,0 +1,65 @@
+#include "reverse-make/unity.h"
+
+#include <sys/stat.h>
+
+#include <string>
+
+#include "reverse-make/parse.h"
+#include "reverse-make/report.h"
+#include "test/test.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Plans and writes the unity files of a small build under 'root', and returns
+ * what the first one holds.
+ */
+string write_first_unity_file(const string& root, const string& dir) {
+  ParsedChunk parsed = parse_chunk(
+      "gcc -O2 -c -o src/a.o src/a.c\n"
+      "gcc -O2 -c -o src/b.o src/b.c\n"
+      "gcc -o app src/a.o src/b.o\n");
+  Report report = build_report(&parsed.commands);
+  UnityOptions options;
+  options.dir = dir;
+  options.root = root;
+  UnityPlan plan = plan_unity(parsed.commands, report, nullptr, options);
+  EXPECT_EQ(plan.batches.size(), size_t(1));
+  if (plan.batches.empty()) {
+    return "";
+  }
+  EXPECT_EQ(plan.batches[0].filename, dir + "/unity-0.c");
+  EXPECT_TRUE(write_unity_files(parsed.commands, plan, options));
+  string contents = read_test_file(
+      dir[0] == '/' ? plan.batches[0].filename
+                    : root + "/" + plan.batches[0].filename);
+  // Just the includes.
+  return contents.substr(contents.find('\n') + 1);
+}
+
+void test_unity_dir_is_under_root() {
+  // The build ran in root/, not here.
+  string root = test_directory() + "/root";
+  mkdir(root.c_str(), 0777);
+  EXPECT_EQ(write_first_unity_file(root, "gen/unity"),
+            "#include \"../../src/a.c\"\n#include \"../../src/b.c\"\n");
+  // Where ".." or an absolute directory leads can't be told from its name.
+  char* absolute_root = realpath(root.c_str(), nullptr);
+  string absolute = absolute_root;
+  free(absolute_root);
+  string expected = fmt::format("#include \"{0}/src/a.c\"\n"
+                                "#include \"{0}/src/b.c\"\n",
+                                absolute);
+  EXPECT_EQ(write_first_unity_file(root, "../up"), expected);
+  EXPECT_EQ(write_first_unity_file(root, test_directory() + "/abs"),
+            expected);
+}
+
+}  // namespace
+
+int main() {
+  test_unity_dir_is_under_root();
+  return test_result();
+}
@@ -0,0 +1,163 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#define FMT_HEADER_ONLY
+#include <fmt/core.h>
+
+#include "reverse-make/sockets.h"
+
+using namespace std;
+
+/**
+ * A connection to a reverse-make --serve socket, which sends one query at a
+ * time and waits for its answer.
+ */
+class QueryClient {
+ public:
+  ~QueryClient() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /**
+   * Connects to the socket at 'path'.
+   *
+   * @return false, with 'error' set, if it can't.
+   */
+  bool Connect(const string& path, string* error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+      *error = fmt::format("Socket path is too long: {}", path);
+      return false;
+    }
+    memcpy(address.sun_path, path.data(), path.size());
+    fd_ = open_unix_socket(false);
+    if (fd_ < 0 || connect(fd_, reinterpret_cast<sockaddr*>(&address),
+                           sizeof(address)) != 0) {
+      *error = fmt::format("Unable to connect to {}: {}", path,
+                           strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Sends 'query' and waits for its answer.
+   *
+   * @return false if the connection failed.
+   */
+  bool Ask(const string& query, string* answer) {
+    string line = query + "\n";
+    for (size_t sent = 0; sent < line.size();) {
+      ssize_t n = send_no_sigpipe(fd_, line.data() + sent, line.size() - sent);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      sent += n;
+    }
+    size_t end;
+    while ((end = buffer_.find('\n')) == string::npos) {
+      char chunk[64 * 1024];
+      ssize_t n = read(fd_, chunk, sizeof(chunk));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      buffer_.append(chunk, n);
+    }
+    answer->assign(buffer_, 0, end);
+    buffer_.erase(0, end + 1);
+    return true;
+  }
+
+ private:
+  int fd_ = -1;
+  // What was read past the end of the last answer.
+  string buffer_;
+};
+
+int main(int argc, const char** argv) {
+  string socket_path;
+  vector<string> queries;
+  int repeat = 1;
+  bool timing = false;
+
+  CLI::App app{
+      "reverse-make-query: ask a reverse-make --serve socket questions, one "
+      "JSON query per argument or, without any, per line of stdin, and print "
+      "the answers."};
+  app.add_option("-s,--socket", socket_path, "The socket reverse-make serves.")
+      ->required();
+  app.add_option("queries", queries, "The queries.");
+  app.add_option("--repeat", repeat,
+                 "Ask each query this many times, printing the answer once.")
+      ->check(CLI::Range(1, 1 << 30));
+  app.add_flag("--time", timing,
+               "Print the average round trip of each query to stderr.");
+  try {
+    app.parse(argc, argv);
+  } catch (const CLI::ParseError& e) {
+    return app.exit(e);
+  }
+
+  QueryClient client;
+  string error;
+  if (!client.Connect(socket_path, &error)) {
+    fmt::print(stderr, "{}\n", error);
+    return 1;
+  }
+
+  auto ask = [&](const string& query) {
+    string answer;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) {
+      if (!client.Ask(query, &answer)) {
+        fmt::print(stderr, "The connection to {} failed.\n", socket_path);
+        return false;
+      }
+    }
+    auto elapsed = chrono::steady_clock::now() - start;
+    fmt::print("{}\n", answer);
+    if (timing) {
+      fmt::print(stderr, "{:.1f} us\n",
+                 chrono::duration<double, micro>(elapsed).count() / repeat);
+    }
+    return true;
+  };
+  if (!queries.empty()) {
+    for (const string& query : queries) {
+      if (!ask(query)) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  string line;
+  while (getline(cin, line)) {
+    if (!line.empty() && !ask(line)) {
+      return 1;
+    }
+  }
+  return 0;
+}